@@ -0,0 +1,218 @@
+#ifndef PEDRODB_CACHE_BLOCK_ARENA_H
+#define PEDRODB_CACHE_BLOCK_ARENA_H
+
+#include <sys/mman.h>
+#include <atomic>
+#include <memory>
+#include <string_view>
+#include "pedrodb/defines.h"
+#include "pedrodb/logger/logger.h"
+
+namespace pedrodb {
+
+// BlockArena preallocates the blocks of the read cache in one mapping, so a
+// miss takes a block from the free list instead of the heap. The blocks are
+// reference counted in place, and go back to the free list when the last
+// reference is dropped. If all blocks are in use, such as being held by
+// readers after eviction, the blocks are allocated from the heap.
+class BlockArena : noncopyable, nonmovable {
+ public:
+  class Block {
+    friend class BlockArena;
+
+    std::atomic<uint32_t> refs_{};
+
+    // the next free block plus one, 0 is the end of the free list.
+    std::atomic<uint32_t> next_{};
+    char* data_{};
+    size_t size_{};
+
+    // null if the block is allocated from the heap.
+    BlockArena* arena_{};
+
+   public:
+    char* data() noexcept { return data_; }
+
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+
+    std::string_view substr(size_t left, size_t length) const noexcept {
+      return {data_ + left, length};
+    }
+  };
+
+  // Ptr is an intrusive shared pointer of blocks.
+  class Ptr {
+    Block* block_{};
+
+    void Release() noexcept {
+      if (block_ != nullptr &&
+          block_->refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        BlockArena::Free(block_);
+      }
+      block_ = nullptr;
+    }
+
+   public:
+    Ptr() noexcept = default;
+
+    Ptr(std::nullptr_t) noexcept {}
+
+    explicit Ptr(Block* block) noexcept : block_(block) {}
+
+    Ptr(const Ptr& other) noexcept : block_(other.block_) {
+      if (block_ != nullptr) {
+        block_->refs_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    Ptr(Ptr&& other) noexcept : block_(other.block_) {
+      other.block_ = nullptr;
+    }
+
+    Ptr& operator=(const Ptr& other) noexcept {
+      if (this != &other) {
+        Ptr(other).Swap(*this);
+      }
+      return *this;
+    }
+
+    Ptr& operator=(Ptr&& other) noexcept {
+      if (this != &other) {
+        Release();
+        std::swap(block_, other.block_);
+      }
+      return *this;
+    }
+
+    ~Ptr() { Release(); }
+
+    void Swap(Ptr& other) noexcept { std::swap(block_, other.block_); }
+
+    Block* operator->() const noexcept { return block_; }
+
+    bool operator==(std::nullptr_t) const noexcept { return !block_; }
+
+    bool operator!=(std::nullptr_t) const noexcept { return block_; }
+  };
+
+ private:
+  const size_t block_size_;
+  size_t n_{};
+  size_t mapped_{};
+  char* memory_{};
+  std::unique_ptr<Block[]> blocks_;
+
+  // the tag in the high 32 bits avoids the ABA problem.
+  std::atomic<uint64_t> free_{};
+
+  void Push(Block* block) noexcept {
+    auto index = static_cast<uint32_t>(block - blocks_.get() + 1);
+    uint64_t head = free_.load(std::memory_order_relaxed);
+    uint64_t next;
+    do {
+      block->next_.store(static_cast<uint32_t>(head),
+                         std::memory_order_relaxed);
+      next = (((head >> 32) + 1) << 32) | index;
+    } while (!free_.compare_exchange_weak(head, next,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+  }
+
+  Block* Pop() noexcept {
+    uint64_t head = free_.load(std::memory_order_acquire);
+    while (static_cast<uint32_t>(head) != 0) {
+      Block* block = &blocks_[static_cast<uint32_t>(head) - 1];
+      uint64_t next = (((head >> 32) + 1) << 32) |
+                      block->next_.load(std::memory_order_relaxed);
+      if (free_.compare_exchange_weak(head, next, std::memory_order_acquire,
+                                      std::memory_order_acquire)) {
+        return block;
+      }
+    }
+    return nullptr;
+  }
+
+  static void Free(Block* block) noexcept {
+    if (block->arena_ != nullptr) {
+      block->arena_->Push(block);
+      return;
+    }
+    delete[] block->data_;
+    delete block;
+  }
+
+  void Map(size_t bytes, bool huge_pages) {
+    constexpr static size_t kHugePageSize = 2 << 20;
+    if (huge_pages) {
+      mapped_ = (bytes + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+      void* p = ::mmap(nullptr, mapped_, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (p != MAP_FAILED) {
+        memory_ = static_cast<char*>(p);
+        return;
+      }
+      PEDRODB_WARN("huge pages are not reserved, fallback to madvise: {}",
+                   Error{errno});
+    }
+
+    mapped_ = bytes;
+    void* p = ::mmap(nullptr, mapped_, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+      PEDRODB_ERROR("failed to map the block arena: {}", Error{errno});
+      mapped_ = 0;
+      return;
+    }
+    memory_ = static_cast<char*>(p);
+    if (huge_pages) {
+      ::madvise(memory_, mapped_, MADV_HUGEPAGE);
+    }
+  }
+
+ public:
+  // preallocates `n` blocks of `block_size` bytes.
+  BlockArena(size_t block_size, size_t n, bool huge_pages = false)
+      : block_size_(block_size) {
+    if (n == 0) {
+      return;
+    }
+
+    Map(n * block_size, huge_pages);
+    if (memory_ == nullptr) {
+      return;
+    }
+
+    n_ = n;
+    blocks_ = std::make_unique<Block[]>(n_);
+    for (size_t i = n_; i > 0; --i) {
+      auto& block = blocks_[i - 1];
+      block.data_ = memory_ + (i - 1) * block_size_;
+      block.size_ = block_size_;
+      block.arena_ = this;
+      Push(&block);
+    }
+  }
+
+  // all blocks must have been released.
+  ~BlockArena() {
+    if (memory_ != nullptr) {
+      ::munmap(memory_, mapped_);
+    }
+  }
+
+  [[nodiscard]] size_t BlockSize() const noexcept { return block_size_; }
+
+  Ptr Allocate() {
+    Block* block = Pop();
+    if (block == nullptr) {
+      block = new Block();
+      block->data_ = new char[block_size_];
+      block->size_ = block_size_;
+    }
+    block->refs_.store(1, std::memory_order_relaxed);
+    return Ptr(block);
+  }
+};
+}  // namespace pedrodb
+
+#endif  // PEDRODB_CACHE_BLOCK_ARENA_H
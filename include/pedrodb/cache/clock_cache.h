@@ -0,0 +1,161 @@
+#ifndef PEDRODB_CACHE_CLOCK_CACHE_H
+#define PEDRODB_CACHE_CLOCK_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <unordered_map>
+
+namespace pedrodb {
+
+// ClockCache approximates LRU by a reference bit. A hit only sets the bit, and
+// the hand gives the referenced entries a second chance before evicting. It
+// has the same interface as LRUCache. The bit is atomic, so the hits only
+// need a shared lock.
+template <typename Key, typename Value>
+class ClockCache {
+  struct Entry {
+    Entry* prev{};
+    Entry* next{};
+
+    Key key{};
+    Value value{};
+    size_t charge{};
+    std::atomic<bool> referenced{};
+  };
+
+  std::unordered_map<Key, Entry*> keys_;
+  const size_t capacity_;
+  size_t usage_{};
+
+  // the ring of entries, the new entries are inserted behind the hand.
+  Entry ring_;
+  Entry* hand_{&ring_};
+
+  void Link(Entry* ptr) {
+    ptr->prev = hand_->prev;
+    ptr->next = hand_;
+    ptr->prev->next = ptr;
+    ptr->next->prev = ptr;
+  }
+
+  void Unlink(Entry* ptr) {
+    if (hand_ == ptr) {
+      hand_ = ptr->next;
+    }
+    ptr->prev->next = ptr->next;
+    ptr->next->prev = ptr->prev;
+  }
+
+ public:
+  using KeyType = Key;
+  using ValueType = Value;
+
+  explicit ClockCache(const size_t capacity) : ClockCache(capacity, capacity) {}
+
+  ClockCache(const size_t capacity, const size_t reserved)
+      : keys_(reserved), capacity_(capacity) {
+    ring_.prev = ring_.next = &ring_;
+  }
+
+  ~ClockCache() {
+    auto node = ring_.next;
+    while (node != &ring_) {
+      auto next = node->next;
+      delete node;
+      node = next;
+    }
+  }
+
+  bool Get(const Key& key, Value& value) { return Lookup(key, value); }
+
+  constexpr static bool kTouchOnHit = false;
+
+  bool Lookup(const Key& key, Value& value) const {
+    auto it = keys_.find(key);
+    if (it == keys_.end()) {
+      return false;
+    }
+
+    it->second->referenced.store(true, std::memory_order_relaxed);
+    value = it->second->value;
+    return true;
+  }
+
+  void Touch(const Key& /*key*/) {}
+
+  bool Remove(const Key& key, Value& value) {
+    auto it = keys_.find(key);
+    if (it == keys_.end()) {
+      return false;
+    }
+
+    Entry* ptr = it->second;
+    value = std::move(ptr->value);
+    Unlink(ptr);
+    usage_ -= ptr->charge;
+    delete ptr;
+
+    keys_.erase(it);
+    return true;
+  }
+
+  void Evict() {
+    if (keys_.empty()) {
+      return;
+    }
+
+    // every entry is visited at most twice.
+    while (hand_ == &ring_ || hand_->referenced) {
+      hand_->referenced = false;
+      hand_ = hand_->next;
+    }
+
+    Entry* ptr = hand_;
+    Unlink(ptr);
+    keys_.erase(ptr->key);
+    usage_ -= ptr->charge;
+    delete ptr;
+  }
+
+  void Put(const Key& key, const Value& value, size_t charge = 1) {
+    if (capacity_ == 0) {
+      return;
+    }
+
+    // never keeps the old value of a key which is put again.
+    if (charge > capacity_) {
+      Value old;
+      Remove(key, old);
+      return;
+    }
+
+    auto it = keys_.find(key);
+    if (it != keys_.end()) {
+      Entry* ptr = it->second;
+      ptr->value = value;
+      ptr->referenced = true;
+      usage_ = usage_ - ptr->charge + charge;
+      ptr->charge = charge;
+      while (usage_ > capacity_) {
+        Evict();
+      }
+      return;
+    }
+
+    while (usage_ + charge > capacity_) {
+      Evict();
+    }
+
+    auto ptr = new Entry();
+    ptr->key = key;
+    ptr->value = value;
+    ptr->charge = charge;
+    Link(ptr);
+    usage_ += charge;
+    keys_[key] = ptr;
+  }
+};
+
+}  // namespace pedrodb
+
+#endif  // PEDRODB_CACHE_CLOCK_CACHE_H
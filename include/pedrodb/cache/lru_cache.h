@@ -8,6 +8,8 @@
 
 namespace pedrodb {
 
+// LRUCache holds entries up to `capacity` charges, an entry is charged 1 by
+// default.
 template <typename Key, typename Value>
 class LRUCache {
   struct Entry {
@@ -16,10 +18,12 @@ class LRUCache {
 
     Key key{};
     Value value{};
+    size_t charge{};
   };
 
   std::unordered_map<Key, Entry*> keys_;
   const size_t capacity_;
+  size_t usage_{};
 
   Entry lru_;
 
@@ -31,8 +35,12 @@ class LRUCache {
   using KeyType = Key;
   using ValueType = Value;
 
+  // `reserved` is the expected number of entries.
   explicit LRUCache(const size_t capacity)
-      : capacity_(capacity), keys_(capacity) {
+      : LRUCache(capacity, capacity) {}
+
+  LRUCache(const size_t capacity, const size_t reserved)
+      : keys_(reserved), capacity_(capacity) {
     lru_.prev = lru_.next = &lru_;
   }
 
@@ -46,6 +54,19 @@ class LRUCache {
   }
 
   bool Get(const Key& key, Value& value) {
+    if (!Lookup(key, value)) {
+      return false;
+    }
+    Touch(key);
+    return true;
+  }
+
+  // a hit reorders the list, so Touch() needs the exclusive lock.
+  constexpr static bool kTouchOnHit = true;
+
+  // finds `key` without updating the recency, the lookups may run
+  // concurrently.
+  bool Lookup(const Key& key, Value& value) const {
     if (capacity_ == 0) {
       return false;
     }
@@ -55,10 +76,18 @@ class LRUCache {
       return false;
     }
 
-    Entry* ptr = it->second;
+    value = it->second->value;
+    return true;
+  }
 
-    value = ptr->value;
+  // makes `key` the most recently used.
+  void Touch(const Key& key) {
+    auto it = keys_.find(key);
+    if (it == keys_.end()) {
+      return;
+    }
 
+    Entry* ptr = it->second;
     ptr->next->prev = ptr->prev;
     ptr->prev->next = ptr->next;
 
@@ -67,7 +96,6 @@ class LRUCache {
 
     ptr->prev->next = ptr;
     ptr->next->prev = ptr;
-    return true;
   }
 
   bool Remove(const Key& key, Value& value) {
@@ -85,6 +113,7 @@ class LRUCache {
 
     ptr->prev->next = ptr->next;
     ptr->next->prev = ptr->prev;
+    usage_ -= ptr->charge;
     Free(ptr);
 
     keys_.erase(it);
@@ -92,30 +121,36 @@ class LRUCache {
   }
 
   void Evict() {
-    if (!keys_.empty()) {
-      return;
-    }
-
     Entry* ptr = lru_.next;
     if (ptr == &lru_) {
       return;
     }
 
     keys_.erase(keys_.find(ptr->key));
+    usage_ -= ptr->charge;
 
     ptr->prev->next = ptr->next;
     ptr->next->prev = ptr->prev;
     Free(ptr);
   }
 
-  void Put(const Key& key, const Value& value) {
+  void Put(const Key& key, const Value& value, size_t charge = 1) {
     if (capacity_ == 0) {
       return;
     }
 
+    // never keeps the old value of a key which is put again.
+    if (charge > capacity_) {
+      Value old;
+      Remove(key, old);
+      return;
+    }
+
     auto it = keys_.find(key);
     if (it != keys_.end()) {
       auto ptr = it->second;
+      usage_ = usage_ - ptr->charge + charge;
+      ptr->charge = charge;
       ptr->prev->next = ptr->next;
       ptr->next->prev = ptr->prev;
 
@@ -126,10 +161,15 @@ class LRUCache {
       ptr->next->prev = ptr;
 
       ptr->value = value;
+
+      // the updated entry is the most recently used, it is never evicted.
+      while (usage_ > capacity_) {
+        Evict();
+      }
       return;
     }
 
-    if (keys_.size() + 1 == capacity_) {
+    while (usage_ + charge > capacity_) {
       Evict();
     }
 
@@ -142,6 +182,8 @@ class LRUCache {
 
     ptr->key = key;
     ptr->value = value;
+    ptr->charge = charge;
+    usage_ += charge;
     keys_[key] = ptr;
   }
 };
@@ -0,0 +1,91 @@
+#ifndef PEDRODB_CACHE_POLICY_CACHE_H
+#define PEDRODB_CACHE_POLICY_CACHE_H
+
+#include <variant>
+#include "pedrodb/cache/clock_cache.h"
+#include "pedrodb/cache/lru_cache.h"
+#include "pedrodb/cache/s3fifo_cache.h"
+#include "pedrodb/cache/segment_cache.h"
+#include "pedrodb/options.h"
+
+namespace pedrodb {
+
+// PolicyCache is a SegmentCache whose replacement policy is picked at
+// runtime. It has the same interface as SegmentCache.
+template <class Key, class Value>
+class PolicyCache {
+  using Caches = std::variant<SegmentCache<LRUCache<Key, Value>>,
+                              SegmentCache<ClockCache<Key, Value>>,
+                              SegmentCache<S3FIFOCache<Key, Value>>>;
+
+  Caches caches_;
+
+  // the segment caches are not movable, they are constructed in place.
+  static Caches Make(CachePolicy policy, size_t segments) {
+    switch (policy) {
+      case CachePolicy::kClock:
+        return Caches{std::in_place_index<1>, segments};
+      case CachePolicy::kS3FIFO:
+        return Caches{std::in_place_index<2>, segments};
+      default:
+        return Caches{std::in_place_index<0>, segments};
+    }
+  }
+
+ public:
+  PolicyCache(CachePolicy policy, size_t segments)
+      : caches_(Make(policy, segments)) {}
+
+  [[nodiscard]] size_t SegmentSize() const noexcept {
+    return std::visit([](auto& cache) { return cache.SegmentSize(); },
+                      caches_);
+  }
+
+  template <typename... Args>
+  void SegmentAdd(Args&&... args) {
+    std::visit([&](auto& cache) { cache.SegmentAdd(args...); }, caches_);
+  }
+
+  bool Get(const Key& key, Value& value) {
+    return std::visit([&](auto& cache) { return cache.Get(key, value); },
+                      caches_);
+  }
+
+  bool Remove(const Key& key, Value& value) {
+    return std::visit([&](auto& cache) { return cache.Remove(key, value); },
+                      caches_);
+  }
+
+  void Put(const Key& key, const Value& value, size_t charge = 1) {
+    std::visit([&](auto& cache) { cache.Put(key, value, charge); }, caches_);
+  }
+
+  using Flight = CacheFlight<Value>;
+
+  CacheSource Acquire(const Key& key, Value& value,
+                      std::shared_ptr<Flight>* flight) {
+    return std::visit(
+        [&](auto& cache) { return cache.Acquire(key, value, flight); },
+        caches_);
+  }
+
+  void Complete(const Key& key, Flight& flight, Status status,
+                const Value& value) {
+    std::visit(
+        [&](auto& cache) { cache.Complete(key, flight, status, value); },
+        caches_);
+  }
+
+  template <class Supplier>
+  Status GetOrCompute(const Key& key, Value& value, Supplier&& supplier,
+                      CacheSource* source = nullptr) {
+    return std::visit(
+        [&](auto& cache) {
+          return cache.GetOrCompute(key, value, supplier, source);
+        },
+        caches_);
+  }
+};
+}  // namespace pedrodb
+
+#endif  // PEDRODB_CACHE_POLICY_CACHE_H
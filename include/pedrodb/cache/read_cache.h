@@ -1,63 +1,56 @@
 #ifndef PEDRODB_CACHE_READ_CACHE_H
 #define PEDRODB_CACHE_READ_CACHE_H
 
-#include <variant>
-#include "pedrodb/cache/lru_cache.h"
-#include "pedrodb/cache/segment_cache.h"
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include "pedrodb/cache/block_arena.h"
+#include "pedrodb/cache/policy_cache.h"
 #include "pedrodb/file/readable_file.h"
 #include "pedrodb/format/record_format.h"
 #include "pedrodb/options.h"
+#include "pedrodb/perf_context.h"
+#include "pedrodb/statistics.h"
 
 namespace pedrodb {
 
-class ReadableView final {
-  const char* buf_;
-
-  size_t read_index_;
-  size_t write_index_;
-
- public:
-  ReadableView(const char* buf, size_t length)
-      : buf_(buf), read_index_(0), write_index_(length) {}
-
-  [[nodiscard]] size_t ReadableBytes() const noexcept {
-    return write_index_ - read_index_;
-  }
-  [[nodiscard]] const char* ReadIndex() const noexcept {
-    return read_index_ + buf_;
-  }
-  void Retrieve(size_t n) noexcept { read_index_ += n; }
-};
-
 class ReadCache {
 
   struct Block {
-    constexpr static size_t kBit = 12;
-    using Ptr = std::shared_ptr<Block>;
-
-    std::array<char, (1 << kBit)> data_;
+    using Ptr = BlockArena::Ptr;
+  };
 
-    std::string_view substr(size_t left, size_t length) {
-      return {data_.data() + left, length};
-    }
+  using BlockCache = PolicyCache<uint64_t, Block::Ptr>;
 
-    char* data() noexcept { return data_.data(); }
-    [[nodiscard]] size_t size() const noexcept { return data_.size(); }
-  };
+  // the blocks may be held by readers after evicted.
+  constexpr static size_t kArenaSlackPercent = 10;
+  constexpr static size_t kMinBlockBit = 9;
+  constexpr static size_t kMaxBlockBit = 20;
 
-  static uint32_t GetOffset(uint64_t block_idx) {
-    return static_cast<uint32_t>(block_idx << Block::kBit);
+  [[nodiscard]] uint32_t GetOffset(uint64_t block_idx) const noexcept {
+    return static_cast<uint32_t>(block_idx << block_bit_);
   }
 
-  static file_id_t GetFile(uint64_t block_idx) {
-    return static_cast<uint32_t>((block_idx << Block::kBit) >> 32);
+  [[nodiscard]] file_id_t GetFile(uint64_t block_idx) const noexcept {
+    return static_cast<uint32_t>((block_idx << block_bit_) >> 32);
   }
 
-  static uint64_t GetBlockIdx(file_id_t file_idx, uint32_t offset) {
-    return ((static_cast<uint64_t>(file_idx) << 32) | offset) >> Block::kBit;
+  [[nodiscard]] uint64_t GetBlockIdx(file_id_t file_idx,
+                                     uint32_t offset) const noexcept {
+    return ((static_cast<uint64_t>(file_idx) << 32) | offset) >> block_bit_;
   }
 
  public:
+  // the bits of the block size, which is rounded up to a power of two in
+  // [512 B, 1 MiB].
+  static size_t BlockBitOf(size_t block_size) {
+    size_t bit = kMinBlockBit;
+    while (bit < kMaxBlockBit && (size_t{1} << bit) < block_size) {
+      bit++;
+    }
+    return bit;
+  }
+
   class Context {
     friend class ReadCache;
 
@@ -94,33 +87,130 @@ class ReadCache {
     [[nodiscard]] auto GetEntry() const noexcept { return entry_; }
   };
 
-  Status Get(uint64_t block_idx, Context& ctx) {
-    Block::Ptr block = std::make_shared<Block>();
-    Status stat =
-        block_cache_.GetOrCompute(block_idx, block, [block_idx, &ctx, this] {
-          auto block = std::make_shared<Block>();
-          if (ctx.file_ == nullptr) {
-            if (Status stat = file_opener_(GetFile(block_idx), &ctx.file_);
-                stat != Status::kOk) {
-              return std::pair{stat, block};
-            }
+ private:
+  [[nodiscard]] uint64_t FirstBlock(const Context& ctx) const noexcept {
+    return GetBlockIdx(ctx.file_idx_, ctx.begin_);
+  }
+
+  [[nodiscard]] uint64_t LastBlock(const Context& ctx) const noexcept {
+    return GetBlockIdx(ctx.file_idx_, ctx.end_ - 1);
+  }
+
+  // the records above `bypass_bytes_` are read without the cache.
+  [[nodiscard]] bool Bypass(const Context& ctx) const noexcept {
+    return bypass_bytes_ != 0 && ctx.Size() > bypass_bytes_;
+  }
+
+  void RecordRead(ssize_t r) noexcept {
+    auto bytes = static_cast<uint64_t>(std::max<ssize_t>(r, 0));
+    RecordTick(statistics_, Ticker::kDiskBytesRead, bytes);
+    PerfCount(&PerfContext::block_read_count);
+    PerfCount(&PerfContext::block_read_bytes, bytes);
+  }
+
+  void RecordLookup(size_t hits, size_t misses) noexcept {
+    RecordTick(statistics_, Ticker::kBlockCacheHits, hits);
+    RecordTick(statistics_, Ticker::kBlockCacheMisses, misses);
+    PerfCount(&PerfContext::block_cache_hit_count, hits);
+    PerfCount(&PerfContext::block_cache_miss_count, misses);
+  }
+
+  // a miss which waits for the same block loaded by another reader.
+  void RecordWait() noexcept {
+    RecordTick(statistics_, Ticker::kBlockCacheWaits);
+    PerfCount(&PerfContext::block_cache_wait_count);
+  }
+
+  Status OpenFile(Context& ctx) {
+    if (ctx.file_ != nullptr) {
+      return Status::kOk;
+    }
+    return file_opener_(ctx.file_idx_, &ctx.file_);
+  }
+
+  // only the last block of a file is short.
+  static bool Complete(const ReadableFile::Ptr& file, uint64_t offset,
+                       ssize_t r, size_t n) {
+    return r == static_cast<ssize_t>(n) ||
+           (r >= 0 && offset + r == file->Size());
+  }
+
+  Status ReadDirectly(Context& ctx) {
+    if (Status stat = OpenFile(ctx); stat != Status::kOk) {
+      return stat;
+    }
+
+    ctx.buf_.resize(ctx.Size());
+    PerfTimer timer(&PerfContext::block_read_nanos);
+    ssize_t r = ctx.file_->Read(ctx.begin_, ctx.buf_.data(), ctx.Size());
+    timer.Stop();
+    RecordRead(r);
+    if (r != static_cast<ssize_t>(ctx.Size())) {
+      return Status::kIOError;
+    }
+    return ctx.Build();
+  }
+
+  Status Fetch(uint64_t block_idx, Context& ctx, Block::Ptr& block) {
+    CacheSource source;
+    Status stat = block_cache_.GetOrCompute(
+        block_idx, block,
+        [block_idx, &ctx, this] {
+          auto block = arena_.Allocate();
+          if (Status stat = OpenFile(ctx); stat != Status::kOk) {
+            return std::pair{stat, block};
           }
 
-          ssize_t r = ctx.file_->Read(GetOffset(block_idx), block->data(),
-                                      block->size());
-          if (r != block->size()) {
+          uint64_t offset = GetOffset(block_idx);
+          PerfTimer timer(&PerfContext::block_read_nanos);
+          ssize_t r = ctx.file_->Read(offset, block->data(), block->size());
+          timer.Stop();
+          RecordRead(r);
+          if (!Complete(ctx.file_, offset, r, block->size())) {
             return std::pair{Status::kIOError, block};
           }
 
           return std::pair{Status::kOk, block};
-        });
+        },
+        &source);
+    if (source == CacheSource::kWaited) {
+      RecordWait();
+    } else {
+      RecordLookup(source == CacheSource::kHit, source == CacheSource::kLoaded);
+    }
+    return stat;
+  }
 
-    if (stat != Status::kOk) {
+  // reads the blocks in [first, last] by one ReadV.
+  Status Load(uint64_t first, uint64_t last, Context& ctx,
+              Block::Ptr* blocks) {
+    if (Status stat = OpenFile(ctx); stat != Status::kOk) {
       return stat;
     }
 
+    std::vector<iovec> iov(last - first + 1);
+    for (uint64_t i = first; i <= last; ++i) {
+      auto& block = blocks[i - first] = arena_.Allocate();
+      iov[i - first].iov_base = block->data();
+      iov[i - first].iov_len = block->size();
+    }
+
+    uint64_t offset = GetOffset(first);
+    PerfTimer timer(&PerfContext::block_read_nanos);
+    ssize_t r = ctx.file_->ReadV(offset, iov.data(), iov.size());
+    timer.Stop();
+    RecordRead(r);
+    if (!Complete(ctx.file_, offset, r, iov.size() << block_bit_)) {
+      return Status::kIOError;
+    }
+    return Status::kOk;
+  }
+
+  void Slice(uint64_t block_idx, const Block::Ptr& block, Context& ctx) {
     uint32_t begin = std::max(GetOffset(block_idx), ctx.begin_);
-    uint32_t end = std::min(GetOffset(block_idx + 1), ctx.end_);
+    uint32_t end = static_cast<uint32_t>(
+        std::min(uint64_t{GetOffset(block_idx)} + block->size(),
+                 uint64_t{ctx.end_}));
 
     std::string_view slice =
         block->substr(begin - GetOffset(block_idx), end - begin);
@@ -133,39 +223,218 @@ class ReadCache {
       }
       ctx.buf_.append(slice);
     }
-    return Status::kOk;
   }
 
  public:
-  ReadCache(size_t segments, size_t capacity) : block_cache_(segments) {
-    size_t segment_capacity = (capacity + segments - 1) / segments;
-    for (size_t i = 0; i < segments; ++i) {
-      block_cache_.SegmentAdd(segment_capacity >> Block::kBit);
+  explicit ReadCache(const ReadCacheOptions& options)
+      : block_bit_(BlockBitOf(options.block_size)),
+        bypass_bytes_(options.bypass_bytes),
+        arena_(size_t{1} << block_bit_,
+               ((options.read_cache_bytes + options.segments - 1) /
+                    options.segments >>
+                block_bit_) *
+                   options.segments * (100 + kArenaSlackPercent) / 100,
+               options.huge_pages),
+        block_cache_(options.policy, options.segments) {
+    size_t segment_capacity =
+        (options.read_cache_bytes + options.segments - 1) / options.segments;
+    for (size_t i = 0; i < options.segments; ++i) {
+      block_cache_.SegmentAdd(segment_capacity >> block_bit_);
     }
   }
 
-  explicit ReadCache(const ReadCacheOptions& options)
-      : ReadCache(options.segments, options.read_cache_bytes) {}
-
+  // A block is loaded once by concurrent misses. Each run of the blocks
+  // missed by this reader is read by one ReadV, the blocks loaded by other
+  // readers are waited after.
   Status Get(Context& ctx) {
-    uint64_t blockIdx = GetBlockIdx(ctx.file_idx_, ctx.begin_);
-    for (uint64_t i = blockIdx; GetOffset(i) < ctx.end_; ++i) {
-      if (auto stat = Get(i, ctx); stat != Status::kOk) {
+    if (Bypass(ctx)) {
+      return ReadDirectly(ctx);
+    }
+
+    uint64_t first = FirstBlock(ctx);
+    uint64_t last = LastBlock(ctx);
+    if (first == last) {
+      Block::Ptr block;
+      if (Status stat = Fetch(first, ctx, block); stat != Status::kOk) {
         return stat;
       }
+      Slice(first, block, ctx);
+      return ctx.Build();
     }
 
+    size_t n = last - first + 1;
+    std::vector<Block::Ptr> blocks(n);
+    std::vector<std::shared_ptr<BlockCache::Flight>> flights(n);
+    std::vector<CacheSource> sources(n);
+    size_t hits = 0, misses = 0;
+    for (size_t k = 0; k < n; ++k) {
+      sources[k] = block_cache_.Acquire(first + k, blocks[k], &flights[k]);
+      hits += sources[k] == CacheSource::kHit;
+      misses += sources[k] == CacheSource::kLoaded;
+    }
+    RecordLookup(hits, misses);
+
+    // the own flights are completed even on errors, their waiters go on.
+    Status stat = Status::kOk;
+    for (size_t k = 0; k < n;) {
+      if (sources[k] != CacheSource::kLoaded) {
+        k++;
+        continue;
+      }
+
+      size_t j = k + 1;
+      while (j < n && sources[j] == CacheSource::kLoaded) {
+        j++;
+      }
+
+      Status load = Load(first + k, first + j - 1, ctx, blocks.data() + k);
+      for (; k < j; ++k) {
+        block_cache_.Complete(first + k, *flights[k], load, blocks[k]);
+      }
+      stat = stat == Status::kOk ? load : stat;
+    }
+
+    for (size_t k = 0; k < n; ++k) {
+      if (sources[k] == CacheSource::kWaited) {
+        RecordWait();
+        Status wait = flights[k]->Await(blocks[k]);
+        stat = stat == Status::kOk ? wait : stat;
+      }
+    }
+    if (stat != Status::kOk) {
+      return stat;
+    }
+
+    for (uint64_t i = first; i <= last; ++i) {
+      Slice(i, blocks[i - first], ctx);
+    }
     return ctx.Build();
   }
 
+  // Gets several records at once, `ctxs` should be sorted by location. Each
+  // distinct block is looked up only once, and the blocks of a file missed
+  // by this reader are read by one MultiRead, the blocks loaded by other
+  // readers are waited after. The status of each record is written to
+  // `stats`.
+  void Get(std::vector<Context>& ctxs, std::vector<Status>* stats) {
+    stats->assign(ctxs.size(), Status::kOk);
+
+    std::vector<uint64_t> indices;
+    for (size_t i = 0; i < ctxs.size(); ++i) {
+      auto& ctx = ctxs[i];
+      if (Bypass(ctx)) {
+        (*stats)[i] = ReadDirectly(ctx);
+        continue;
+      }
+
+      for (uint64_t k = FirstBlock(ctx); k <= LastBlock(ctx); ++k) {
+        if (indices.empty() || indices.back() < k) {
+          indices.emplace_back(k);
+        }
+      }
+    }
+
+    std::vector<Block::Ptr> blocks(indices.size());
+    std::vector<std::shared_ptr<BlockCache::Flight>> flights(indices.size());
+    std::vector<size_t> misses, waits;
+    for (size_t i = 0; i < indices.size(); ++i) {
+      switch (block_cache_.Acquire(indices[i], blocks[i], &flights[i])) {
+        case CacheSource::kLoaded:
+          misses.emplace_back(i);
+          break;
+        case CacheSource::kWaited:
+          waits.emplace_back(i);
+          break;
+        default:
+          break;
+      }
+    }
+    RecordLookup(indices.size() - misses.size() - waits.size(),
+                 misses.size());
+
+    std::vector<Status> block_stats(indices.size(), Status::kOk);
+    std::vector<ReadRequest> requests;
+    for (size_t i = 0, j = 0; i < misses.size(); i = j) {
+      file_id_t id = GetFile(indices[misses[i]]);
+
+      requests.clear();
+      for (; j < misses.size() && GetFile(indices[misses[j]]) == id; ++j) {
+        auto& block = blocks[misses[j]] = arena_.Allocate();
+        auto& r = requests.emplace_back();
+        r.offset = GetOffset(indices[misses[j]]);
+        r.buf = block->data();
+        r.n = block->size();
+      }
+
+      ReadableFile::Ptr file;
+      Status stat = file_opener_(id, &file);
+      if (stat == Status::kOk) {
+        PerfTimer timer(&PerfContext::block_read_nanos);
+        file->MultiRead(requests.data(), requests.size());
+      }
+
+      for (size_t k = i; k < j; ++k) {
+        size_t idx = misses[k];
+        auto& r = requests[k - i];
+        if (stat == Status::kOk) {
+          RecordRead(r.result);
+          if (!Complete(file, r.offset, r.result, r.n)) {
+            block_stats[idx] = Status::kIOError;
+          }
+        } else {
+          block_stats[idx] = stat;
+        }
+        block_cache_.Complete(indices[idx], *flights[idx], block_stats[idx],
+                              blocks[idx]);
+      }
+    }
+
+    for (size_t idx : waits) {
+      RecordWait();
+      block_stats[idx] = flights[idx]->Await(blocks[idx]);
+    }
+
+    for (size_t i = 0; i < ctxs.size(); ++i) {
+      auto& ctx = ctxs[i];
+      if (Bypass(ctx)) {
+        continue;
+      }
+
+      uint64_t first = FirstBlock(ctx);
+      size_t k = std::lower_bound(indices.begin(), indices.end(), first) -
+                 indices.begin();
+
+      Status stat = Status::kOk;
+      for (uint64_t j = first; j <= LastBlock(ctx); ++j, ++k) {
+        if (stat = block_stats[k]; stat != Status::kOk) {
+          break;
+        }
+        Slice(j, blocks[k], ctx);
+      }
+
+      (*stats)[i] = stat == Status::kOk ? ctx.Build() : stat;
+    }
+  }
+
   void SetFileOpener(
       std::function<Status(file_id_t, ReadableFile::Ptr*)> opener) {
     file_opener_ = std::move(opener);
   }
 
+  // the statistics outlive the cache, null means disabled.
+  void SetStatistics(Statistics* statistics) noexcept {
+    statistics_ = statistics;
+  }
+
  private:
-  SegmentCache<LRUCache<uint64_t, Block::Ptr>> block_cache_;
+  const size_t block_bit_;
+  const size_t bypass_bytes_;
+
+  // the arena outlives the cached blocks.
+  BlockArena arena_;
+  BlockCache block_cache_;
   std::function<Status(file_id_t, ReadableFile::Ptr*)> file_opener_;
+  Statistics* statistics_{};
 };
 }  // namespace pedrodb
 
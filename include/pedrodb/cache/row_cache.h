@@ -0,0 +1,94 @@
+#ifndef PEDRODB_CACHE_ROW_CACHE_H
+#define PEDRODB_CACHE_ROW_CACHE_H
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include "pedrodb/cache/policy_cache.h"
+#include "pedrodb/format/record_format.h"
+#include "pedrodb/options.h"
+
+namespace pedrodb {
+
+// RowCache caches the uncompressed values of records by key. A row is tagged
+// by the location of its record, and it is a hit only if the index still
+// points there. Locations are never reused, so a stale row is never returned
+// even if it is put after the key is updated.
+//
+// The rows are keyed by the hashes of keys, so a lookup never copies the
+// key. Two keys of the same hash share a row, which is a hit only for the
+// key whose record is at its location.
+class RowCache {
+  struct Row {
+    record::Location loc;
+    std::string value;
+  };
+
+  // the memory of a row besides its key and value.
+  constexpr static size_t kRowOverhead = 64;
+
+  // the expected charge of rows, to presize the hash tables.
+  constexpr static size_t kExpectedRowBytes = 256;
+
+  PolicyCache<uint64_t, Row> cache_;
+  size_t max_row_bytes_{};
+
+  static uint64_t Hash(std::string_view key) noexcept {
+    return std::hash<std::string_view>()(key);
+  }
+
+ public:
+  RowCache(size_t segments, size_t capacity,
+           CachePolicy policy = CachePolicy::kLRU)
+      : cache_(policy, segments) {
+    if (capacity == 0) {
+      return;
+    }
+
+    size_t segment_capacity = (capacity + segments - 1) / segments;
+    for (size_t i = 0; i < segments; ++i) {
+      cache_.SegmentAdd(segment_capacity,
+                        segment_capacity / kExpectedRowBytes);
+    }
+
+    // a large row would flush the segment.
+    max_row_bytes_ = segment_capacity / 8;
+  }
+
+  explicit RowCache(const ReadCacheOptions& options)
+      : RowCache(options.segments, options.row_cache_bytes, options.policy) {}
+
+  [[nodiscard]] bool Enabled() const noexcept { return max_row_bytes_ != 0; }
+
+  bool Get(std::string_view key, record::Location loc, std::string* value) {
+    Row row;
+    if (!Enabled() || !cache_.Get(Hash(key), row)) {
+      return false;
+    }
+    if (!(row.loc == loc)) {
+      return false;
+    }
+    *value = std::move(row.value);
+    return true;
+  }
+
+  void Put(std::string_view key, record::Location loc,
+           std::string_view value) {
+    size_t charge = key.size() + value.size() + kRowOverhead;
+    if (charge > max_row_bytes_) {
+      Remove(key);
+      return;
+    }
+    cache_.Put(Hash(key), Row{loc, std::string(value)}, charge);
+  }
+
+  void Remove(std::string_view key) {
+    Row row;
+    if (Enabled()) {
+      cache_.Remove(Hash(key), row);
+    }
+  }
+};
+}  // namespace pedrodb
+
+#endif  // PEDRODB_CACHE_ROW_CACHE_H
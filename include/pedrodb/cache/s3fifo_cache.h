@@ -0,0 +1,233 @@
+#ifndef PEDRODB_CACHE_S3FIFO_CACHE_H
+#define PEDRODB_CACHE_S3FIFO_CACHE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace pedrodb {
+
+// S3FIFOCache keeps the new entries in a small FIFO, which holds about 10% of
+// the capacity. Only the entries hit again before leaving it are moved to
+// the main FIFO, so a scan touching every entry once is evicted quickly and
+// never flushes the main FIFO. The keys evicted from the small FIFO are
+// remembered by a ghost FIFO, they go to the main FIFO directly if they come
+// back soon. It has the same interface as LRUCache. The frequencies are
+// atomic, so the hits only need a shared lock.
+template <typename Key, typename Value>
+class S3FIFOCache {
+  constexpr static uint8_t kMaxFrequency = 3;
+  constexpr static size_t kSmallPercent = 10;
+
+  struct Entry {
+    Entry* prev{};
+    Entry* next{};
+
+    Key key{};
+    Value value{};
+    size_t charge{};
+    std::atomic<uint8_t> frequency{};
+    bool main{};
+  };
+
+  struct Queue {
+    Entry head;
+    size_t usage{};
+
+    Queue() { head.prev = head.next = &head; }
+
+    [[nodiscard]] bool Empty() const noexcept { return head.next == &head; }
+
+    void Push(Entry* ptr) {
+      ptr->prev = head.prev;
+      ptr->next = &head;
+      ptr->prev->next = ptr;
+      ptr->next->prev = ptr;
+      usage += ptr->charge;
+    }
+
+    Entry* Pop() {
+      Entry* ptr = head.next;
+      Erase(ptr);
+      return ptr;
+    }
+
+    void Erase(Entry* ptr) {
+      ptr->prev->next = ptr->next;
+      ptr->next->prev = ptr->prev;
+      usage -= ptr->charge;
+    }
+
+    void Clear() {
+      while (!Empty()) {
+        delete Pop();
+      }
+    }
+  };
+
+  std::unordered_map<Key, Entry*> keys_;
+  const size_t capacity_;
+
+  Queue small_;
+  Queue main_;
+
+  // the ghost FIFO holds at most as many keys as the cache.
+  std::unordered_set<Key> ghost_;
+  std::deque<Key> ghost_order_;
+
+  Queue& QueueOf(Entry* ptr) { return ptr->main ? main_ : small_; }
+
+  void AddGhost(const Key& key) {
+    if (ghost_.insert(key).second) {
+      ghost_order_.emplace_back(key);
+    }
+    while (ghost_order_.size() > std::max<size_t>(keys_.size(), 1)) {
+      ghost_.erase(ghost_order_.front());
+      ghost_order_.pop_front();
+    }
+  }
+
+  void Free(Entry* ptr) {
+    keys_.erase(ptr->key);
+    delete ptr;
+  }
+
+  // returns true if an entry is freed.
+  bool EvictSmall() {
+    while (!small_.Empty()) {
+      Entry* ptr = small_.Pop();
+      if (ptr->frequency > 0) {
+        ptr->frequency = 0;
+        ptr->main = true;
+        main_.Push(ptr);
+        continue;
+      }
+
+      AddGhost(ptr->key);
+      Free(ptr);
+      return true;
+    }
+    return false;
+  }
+
+  bool EvictMain() {
+    while (!main_.Empty()) {
+      Entry* ptr = main_.Pop();
+      if (ptr->frequency > 0) {
+        ptr->frequency--;
+        main_.Push(ptr);
+        continue;
+      }
+
+      Free(ptr);
+      return true;
+    }
+    return false;
+  }
+
+ public:
+  using KeyType = Key;
+  using ValueType = Value;
+
+  explicit S3FIFOCache(const size_t capacity)
+      : S3FIFOCache(capacity, capacity) {}
+
+  S3FIFOCache(const size_t capacity, const size_t reserved)
+      : keys_(reserved), capacity_(capacity) {}
+
+  ~S3FIFOCache() {
+    small_.Clear();
+    main_.Clear();
+  }
+
+  bool Get(const Key& key, Value& value) { return Lookup(key, value); }
+
+  constexpr static bool kTouchOnHit = false;
+
+  // a concurrent hit may be lost, the frequency is only a hint.
+  bool Lookup(const Key& key, Value& value) const {
+    auto it = keys_.find(key);
+    if (it == keys_.end()) {
+      return false;
+    }
+
+    Entry* ptr = it->second;
+    uint8_t frequency = ptr->frequency.load(std::memory_order_relaxed);
+    if (frequency < kMaxFrequency) {
+      ptr->frequency.store(frequency + 1, std::memory_order_relaxed);
+    }
+    value = ptr->value;
+    return true;
+  }
+
+  void Touch(const Key& /*key*/) {}
+
+  bool Remove(const Key& key, Value& value) {
+    auto it = keys_.find(key);
+    if (it == keys_.end()) {
+      return false;
+    }
+
+    Entry* ptr = it->second;
+    value = std::move(ptr->value);
+    QueueOf(ptr).Erase(ptr);
+    Free(ptr);
+    return true;
+  }
+
+  void Evict() {
+    if (small_.usage * 100 >= capacity_ * kSmallPercent || main_.Empty()) {
+      if (EvictSmall()) {
+        return;
+      }
+    }
+    EvictMain();
+  }
+
+  void Put(const Key& key, const Value& value, size_t charge = 1) {
+    if (capacity_ == 0) {
+      return;
+    }
+
+    // never keeps the old value of a key which is put again.
+    if (charge > capacity_) {
+      Value old;
+      Remove(key, old);
+      return;
+    }
+
+    auto it = keys_.find(key);
+    if (it != keys_.end()) {
+      Entry* ptr = it->second;
+      Queue& queue = QueueOf(ptr);
+      queue.Erase(ptr);
+      ptr->value = value;
+      ptr->charge = charge;
+      queue.Push(ptr);
+      while (small_.usage + main_.usage > capacity_) {
+        Evict();
+      }
+      return;
+    }
+
+    while (!keys_.empty() && small_.usage + main_.usage + charge > capacity_) {
+      Evict();
+    }
+
+    auto ptr = new Entry();
+    ptr->key = key;
+    ptr->value = value;
+    ptr->charge = charge;
+    ptr->main = ghost_.erase(key) != 0;
+    QueueOf(ptr).Push(ptr);
+    keys_[key] = ptr;
+  }
+};
+
+}  // namespace pedrodb
+
+#endif  // PEDRODB_CACHE_S3FIFO_CACHE_H
@@ -2,11 +2,43 @@
 #define PEDRODB_CACHE_SEGMENT_CACHE_H
 
 #include <pedrolib/collection/static_vector.h>
+#include <pedrolib/concurrent/latch.h>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
 #include "pedrodb/defines.h"
 #include "pedrodb/status.h"
 
 namespace pedrodb {
-template <class Cache, class Mutex = std::mutex,
+
+// where GetOrCompute() got the value from.
+enum class CacheSource {
+  kHit,
+  // computed by the caller.
+  kLoaded,
+  // computed by a concurrent miss of the same key.
+  kWaited,
+};
+
+// a value being computed, the concurrent misses of the key wait for it.
+template <class Value>
+struct CacheFlight {
+  pedrolib::Latch done{1};
+  Status status{Status::kOk};
+  Value value{};
+
+  Status Await(Value& out) {
+    done.Await();
+    out = value;
+    return status;
+  }
+};
+
+// The hits take the segment lock shared, the policies update their state on
+// a hit by atomics. The LRU policy reorders its list only if the segment is
+// not locked, so a hit never waits for a writer to move the entry.
+template <class Cache, class Mutex = std::shared_mutex,
           class KeyHash = std::hash<typename Cache::KeyType>>
 class SegmentCache {
   template <class T>
@@ -14,10 +46,12 @@ class SegmentCache {
 
   using KeyType = typename Cache::KeyType;
   using ValueType = typename Cache::ValueType;
+  using Flight = CacheFlight<ValueType>;
 
   struct alignas(64) Segment {
     Cache cache_;
     Mutex mu_;
+    std::unordered_map<KeyType, std::shared_ptr<Flight>, KeyHash> flights_;
 
     template <class... Args>
     explicit Segment(Args&&... args) : cache_(std::forward<Args>(args)...) {}
@@ -30,6 +64,23 @@ class SegmentCache {
     return hash_(key) % segments_.size();
   }
 
+  static bool Lookup(Segment& seg, const KeyType& key, ValueType& value) {
+    {
+      std::shared_lock lock{seg.mu_};
+      if (!seg.cache_.Lookup(key, value)) {
+        return false;
+      }
+    }
+
+    if constexpr (Cache::kTouchOnHit) {
+      std::unique_lock lock{seg.mu_, std::try_to_lock};
+      if (lock.owns_lock()) {
+        seg.cache_.Touch(key);
+      }
+    }
+    return true;
+  }
+
  public:
   explicit SegmentCache(size_t segments) : segments_(segments) {}
 
@@ -47,9 +98,7 @@ class SegmentCache {
   }
 
   bool Get(const KeyType& key, ValueType& value) {
-    auto& seg = segments_[locate(key)];
-    std::lock_guard guard{seg.mu_};
-    return seg.cache_.Get(key, value);
+    return Lookup(segments_[locate(key)], key, value);
   }
 
   bool Remove(const KeyType& key, ValueType& value) {
@@ -58,26 +107,79 @@ class SegmentCache {
     return seg.cache_.Remove(key, value);
   }
 
-  void Put(const KeyType& key, const ValueType& value) {
+  void Put(const KeyType& key, const ValueType& value, size_t charge = 1) {
     auto& seg = segments_[locate(key)];
     std::lock_guard guard{seg.mu_};
-    seg.cache_.Put(key, value);
+    seg.cache_.Put(key, value, charge);
   }
 
-  template <class Supplier>
-  Status GetOrCompute(const KeyType& key, ValueType& value,
-                      Supplier&& supplier) {
+  // Gets the value of `key` on a hit. On a miss, the caller either computes
+  // the value and passes it to Complete() if it gets kLoaded, or waits for
+  // another miss by `flight` if it gets kWaited. A caller loading several
+  // keys completes its own flights before waiting for the others.
+  CacheSource Acquire(const KeyType& key, ValueType& value,
+                      std::shared_ptr<Flight>* flight) {
     auto& seg = segments_[locate(key)];
-    std::lock_guard guard{seg.mu_};
+    if (Lookup(seg, key, value)) {
+      return CacheSource::kHit;
+    }
+
+    // the value may be put between the locks.
+    std::unique_lock lock{seg.mu_};
     if (seg.cache_.Get(key, value)) {
+      return CacheSource::kHit;
+    }
+
+    if (auto it = seg.flights_.find(key); it != seg.flights_.end()) {
+      *flight = it->second;
+      return CacheSource::kWaited;
+    }
+
+    *flight = std::make_shared<Flight>();
+    seg.flights_.emplace(key, *flight);
+    return CacheSource::kLoaded;
+  }
+
+  // publishes the value of a flight got by Acquire(), it is cached if the
+  // status is ok.
+  void Complete(const KeyType& key, Flight& flight, Status status,
+                const ValueType& value) {
+    flight.status = status;
+    flight.value = value;
+
+    auto& seg = segments_[locate(key)];
+    {
+      std::lock_guard guard{seg.mu_};
+      if (status == Status::kOk) {
+        seg.cache_.Put(key, value);
+      }
+      seg.flights_.erase(key);
+    }
+    flight.done.CountDown();
+  }
+
+  // Gets the value of `key`, or computes it by `supplier` on a miss. The
+  // segment is not locked while computing, so the other keys of the segment
+  // are not blocked, and the concurrent misses of the key wait for the same
+  // computation. `source` tells where the value came from.
+  template <class Supplier>
+  Status GetOrCompute(const KeyType& key, ValueType& value,
+                      Supplier&& supplier, CacheSource* source = nullptr) {
+    CacheSource ignored;
+    source = source != nullptr ? source : &ignored;
+
+    std::shared_ptr<Flight> flight;
+    *source = Acquire(key, value, &flight);
+    if (*source == CacheSource::kHit) {
       return Status::kOk;
     }
+    if (*source == CacheSource::kWaited) {
+      return flight->Await(value);
+    }
 
     Status status;
     std::tie(status, value) = supplier();
-    if (status == Status::kOk) {
-      seg.cache_.Put(key, value);
-    }
+    Complete(key, *flight, status, value);
     return status;
   }
 };
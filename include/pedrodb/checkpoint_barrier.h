@@ -0,0 +1,82 @@
+#ifndef PEDRODB_CHECKPOINT_BARRIER_H
+#define PEDRODB_CHECKPOINT_BARRIER_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "pedrodb/defines.h"
+
+namespace pedrodb {
+
+// CheckpointBarrier lets a checkpoint wait until the writes in progress are
+// indexed. The writes hold it shared and a checkpoint holds it exclusively,
+// by std::shared_lock and std::unique_lock. Once a checkpoint asks for it,
+// the new writes wait behind it, so a stream of writes never starves the
+// checkpoint as it may with std::shared_mutex, which prefers the shared side
+// on glibc. Both sides are free if checkpoints are disabled.
+class CheckpointBarrier : noncopyable, nonmovable {
+  // the high bit is set by a checkpoint, the others count the writes.
+  constexpr static uint32_t kExclusive = 1U << 31;
+
+  const bool enable_;
+  std::atomic<uint32_t> state_{};
+
+  // one checkpoint at a time.
+  std::mutex mu_;
+
+ public:
+  explicit CheckpointBarrier(bool enable) : enable_(enable) {}
+
+  void lock_shared() noexcept {
+    if (!enable_) {
+      return;
+    }
+
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    for (;;) {
+      if (state & kExclusive) {
+        std::this_thread::yield();
+        state = state_.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (state_.compare_exchange_weak(state, state + 1,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        return;
+      }
+    }
+  }
+
+  void unlock_shared() noexcept {
+    if (enable_) {
+      state_.fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  // the checkpoint is short, the writes in progress are waited by spinning.
+  void lock() {
+    if (!enable_) {
+      return;
+    }
+
+    mu_.lock();
+    state_.fetch_or(kExclusive, std::memory_order_relaxed);
+    while (state_.load(std::memory_order_acquire) != kExclusive) {
+      std::this_thread::yield();
+    }
+  }
+
+  void unlock() noexcept {
+    if (!enable_) {
+      return;
+    }
+
+    state_.fetch_and(~kExclusive, std::memory_order_release);
+    mu_.unlock();
+  }
+};
+}  // namespace pedrodb
+
+#endif  // PEDRODB_CHECKPOINT_BARRIER_H
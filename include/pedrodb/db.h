@@ -1,11 +1,14 @@
 #ifndef PEDRODB_DB_H
 #define PEDRODB_DB_H
 
+#include <functional>
 #include "pedrodb/defines.h"
 #include "pedrodb/format/record_format.h"
 #include "pedrodb/iterator/iterator.h"
 #include "pedrodb/options.h"
+#include "pedrodb/perf_context.h"
 #include "pedrodb/status.h"
+#include "pedrodb/write_batch.h"
 
 namespace pedrodb {
 
@@ -13,6 +16,8 @@ using EntryIterator = Iterator<record::EntryView>;
 
 struct DB : pedrolib::noncopyable, pedrolib::nonmovable {
   using Ptr = std::shared_ptr<DB>;
+  using GetCallback = std::function<void(Status, std::string)>;
+  using WriteCallback = std::function<void(Status)>;
 
   static Status Open(const Options& options, const std::string& name, Ptr* db);
 
@@ -22,16 +27,44 @@ struct DB : pedrolib::noncopyable, pedrolib::nonmovable {
   virtual Status Get(const ReadOptions& options, std::string_view key,
                      std::string* value) = 0;
 
+  // Gets several keys at once. `values` and `status` are resized to the
+  // number of keys, and hold the result of each key.
+  virtual Status MultiGet(const ReadOptions& options,
+                          const std::vector<std::string_view>& keys,
+                          std::vector<std::string>* values,
+                          std::vector<Status>* status) = 0;
+
   virtual Status Put(const WriteOptions& options, std::string_view key,
                      std::string_view value) = 0;
 
   virtual Status Delete(const WriteOptions& options, std::string_view key) = 0;
 
+  virtual Status Write(const WriteOptions& options, WriteBatch* batch) = 0;
+
+  // The async APIs return immediately, the callback is invoked on the
+  // `Options::io_executor` when the operation completes.
+  virtual void GetAsync(const ReadOptions& options, std::string key,
+                        GetCallback callback) = 0;
+
+  virtual void PutAsync(const WriteOptions& options, std::string key,
+                        std::string value, WriteCallback callback) = 0;
+
+  virtual void DeleteAsync(const WriteOptions& options, std::string key,
+                           WriteCallback callback) = 0;
+
   virtual Status Flush() = 0;
 
   virtual Status GetIterator(EntryIterator::Ptr*) = 0;
 
   virtual Status Compact() = 0;
+
+  // Gets a property of the database as text, returns kNotFound if the name is
+  // unknown. The properties are:
+  //  "pedrodb.stats": all the tickers and histograms of `Options::statistics`.
+  //  "pedrodb.num-keys", "pedrodb.num-files", "pedrodb.free-bytes",
+  //  "pedrodb.unsynced-bytes": the state of the database.
+  //  the name of a ticker or a histogram, see Statistics::NameOf().
+  virtual Status GetProperty(std::string_view name, std::string* value) = 0;
 };
 }  // namespace pedrodb
 
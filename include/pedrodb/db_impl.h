@@ -3,25 +3,31 @@
 
 #include <pedrolib/concurrent/latch.h>
 #include <pedrolib/executor/thread_pool_executor.h>
-#include <tsl/htrie_map.h>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <unordered_set>
 #include <vector>
 
 #include <pedrolib/concurrent/spinlock.h>
 #include "pedrodb/cache/read_cache.h"
+#include "pedrodb/cache/row_cache.h"
+#include "pedrodb/checkpoint_barrier.h"
 #include "pedrodb/db.h"
 #include "pedrodb/defines.h"
 #include "pedrodb/file/mapping_readwrite_file.h"
 #include "pedrodb/file_manager.h"
+#include "pedrodb/format/checkpoint_format.h"
 #include "pedrodb/format/index_format.h"
 #include "pedrodb/format/record_format.h"
+#include "pedrodb/index/segment_index.h"
 #include "pedrodb/iterator/index_iterator.h"
 #include "pedrodb/iterator/record_iterator.h"
+#include "pedrodb/iterator/sequential_iterator.h"
 #include "pedrodb/logger/logger.h"
 #include "pedrodb/metadata_manager.h"
+#include "pedrodb/perf_context.h"
 
 namespace pedrodb {
 
@@ -34,6 +40,7 @@ enum class CompactState {
 
 struct FileState {
   size_t free_bytes{};
+  size_t total_bytes{kMaxFileBytes};
   CompactState compact_state{CompactState::kNop};
 };
 
@@ -43,39 +50,130 @@ class DBImpl : public DB, public std::enable_shared_from_this<DBImpl> {
   Options options_;
   uint64_t sync_worker_{};
   uint64_t compact_worker_{};
+  uint64_t checkpoint_worker_{};
   std::shared_ptr<Executor> executor_;
+  std::shared_ptr<Executor> io_executor_;
+  RateLimiter::Ptr rate_limiter_;
+
+  // owned by `options_`, null means disabled.
+  Statistics* statistics_{};
   
-  file_id_t max_file_{};
-  tsl::htrie_map<char, record::Dir> indices_;
+  std::atomic<file_id_t> max_file_{};
+  SegmentIndex indices_;
   FileManager::Ptr file_manager_;
   MetadataManager::Ptr metadata_manager_;
   std::atomic_bool readonly_{false};
+  bool recovered_{};
 
   ReadCache read_cache_;
+  RowCache row_cache_;
 
   // for compaction.
   std::vector<file_id_t> compact_tasks_;
   std::unordered_map<file_id_t, FileState> file_states_;
 
-  void Recovery(file_id_t id, index::EntryView entry);
-  Status Recovery(file_id_t id);
+  // recovers an entry of the index, the free bytes of files are collected
+  // into `free_bytes`.
+  void Recovery(file_id_t id, index::EntryView entry,
+                std::unordered_map<file_id_t, size_t>* free_bytes);
+
+  // the index of a file parsed by recovery.
+  struct IndexLog {
+    struct Item {
+      uint32_t key_pos;
+      uint32_t offset;
+      uint32_t len;
+      uint8_t key_size;
+      record::Type type;
+    };
+
+    Status status{Status::kOk};
+    std::string keys;
+    size_t count{};
+
+    // the entries grouped by partitions of keys.
+    std::vector<std::vector<Item>> partitions;
+  };
+
+  Status RebuildIndexLog(file_id_t id, ArrayBuffer* log);
+
+  Status ReadIndexLog(file_id_t id, size_t partitions, IndexLog* log);
+
+  // the ranks of files, only used by recovery.
+  std::unordered_map<file_id_t, file_id_t> ranks_;
+
+  bool IsNewer(record::Location x, record::Location y) const noexcept;
 
-  void Compact(file_id_t id);
+  // moves the live records of `victims` into new output files.
+  void Compact(const std::vector<file_id_t>& victims);
 
   void UpdateUnused(record::Location loc, size_t unused);
 
-  std::vector<file_id_t> PollCompactTask();
+  // picks the files by cost-benefit to bound the space amplification.
+  void PickCompactTask(std::vector<file_id_t>* tasks);
+
+  // groups the tasks into compactions, each of them merges several files.
+  std::vector<std::vector<file_id_t>> PollCompactTask();
 
   Status Recovery();
 
+  // true if a value of `size` bytes in the record may be kept inline after
+  // uncompressed.
+  [[nodiscard]] bool MayInline(size_t size) const noexcept;
+
+  // reads the inline values from the records after the index is recovered.
+  void RecoverInlineValues();
+
+  // writes and compaction commits hold the shared lock, a checkpoint holds
+  // the exclusive lock to find the files whose entries are all indexed.
+  CheckpointBarrier checkpoint_barrier_;
+
+  // the files covered by the latest checkpoint.
+  std::vector<file_id_t> checkpoint_files_;
+
+  // saves the entries of the inactive files into the checkpoint.
+  Status Checkpoint();
+
+  // loads the checkpoint into the index if it is intact, returns the files
+  // covered by it.
+  std::unordered_set<file_id_t> LoadCheckpoint(
+      const std::vector<file_id_t>& files);
+
   auto AcquireLock() const { return std::unique_lock{mu_}; }
 
   Status HandlePut(const WriteOptions& options, std::string_view key,
                    std::string_view value);
 
+  // waits for the rate limiter before HandlePut().
+  Status ThrottlePut(const WriteOptions& options, std::string_view key,
+                     std::string_view value);
+
+  // counts the bytes of a value read by Get().
+  Status RecordRead(Status status, std::string_view value);
+
+  static Status UpdateIndex(std::optional<record::Dir>& dir, record::Type type,
+                            record::Location loc, uint32_t entry_size,
+                            record::Dir* unused);
+
+  void UpdateMaxFile(file_id_t id);
+
   Status HandleGet(const ReadOptions& options, std::string_view key,
                    std::string* value);
 
+  Status ReadValue(const record::EntryView& entry, std::string* value) const;
+
+  // looks up the index, it is timed by the perf context.
+  bool LookupIndex(std::string_view key, record::Dir* dir, std::string* value,
+                   bool* inlined);
+
+  // reads the key of the record at `dir`, for the fingerprint index.
+  bool MatchKey(const record::Dir& dir, std::string_view key);
+
+  // reads the records of one file, which are sorted by offset.
+  void ReadDirectly(const std::vector<std::pair<record::Dir, size_t>>& dirs,
+                    size_t begin, size_t end, std::vector<std::string>* values,
+                    std::vector<Status>* status);
+
  public:
   ~DBImpl() override;
 
@@ -90,12 +188,34 @@ class DBImpl : public DB, public std::enable_shared_from_this<DBImpl> {
   Status Get(const ReadOptions& options, std::string_view key,
              std::string* value) override;
 
+  Status MultiGet(const ReadOptions& options,
+                  const std::vector<std::string_view>& keys,
+                  std::vector<std::string>* values,
+                  std::vector<Status>* status) override;
+
   Status Put(const WriteOptions& options, std::string_view key,
              std::string_view value) override;
 
   Status GetIterator(EntryIterator::Ptr* iterator) override;
 
   Status Delete(const WriteOptions& options, std::string_view key) override;
+
+  Status Write(const WriteOptions& options, WriteBatch* batch) override;
+
+  Status GetProperty(std::string_view name, std::string* value) override;
+
+  // gets a numeric property of this database only, such as
+  // "pedrodb.num-keys".
+  Status GetIntProperty(std::string_view name, uint64_t* value);
+
+  void GetAsync(const ReadOptions& options, std::string key,
+                GetCallback callback) override;
+
+  void PutAsync(const WriteOptions& options, std::string key,
+                std::string value, WriteCallback callback) override;
+
+  void DeleteAsync(const WriteOptions& options, std::string key,
+                   WriteCallback callback) override;
 };
 }  // namespace pedrodb
 
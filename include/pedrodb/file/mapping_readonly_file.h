@@ -2,6 +2,7 @@
 #define PEDRODB_FILE_MAPPING_READONLY_FILE_H
 
 #include <sys/mman.h>
+#include <unistd.h>
 #include "pedrodb/defines.h"
 #include "pedrodb/file/readable_file.h"
 #include "pedrodb/logger/logger.h"
@@ -15,7 +16,7 @@ class MappingReadonlyFile final : public ReadableFile, noncopyable, nonmovable {
  private:
   mutable File file_{};
   const char* data_{};
-  size_t capacity_;
+  size_t capacity_{};
 
  public:
   [[nodiscard]] ReadableBuffer GetReadonlyBuffer() const noexcept {
@@ -40,6 +41,17 @@ class MappingReadonlyFile final : public ReadableFile, noncopyable, nonmovable {
     return file_.Pread(offset, data, length);
   }
 
+  void Prefetch(uint64_t offset, size_t n) override {
+    if (offset >= capacity_) {
+      return;
+    }
+
+    size_t page = ::sysconf(_SC_PAGESIZE);
+    size_t begin = offset / page * page;
+    n = std::min<size_t>(n + (offset - begin), capacity_ - begin);
+    ::madvise((void*)(data_ + begin), n, MADV_WILLNEED);
+  }
+
   uint64_t Size() const noexcept override { return capacity_; }
 
   Error GetError() const noexcept override { return file_.GetError(); }
@@ -54,11 +66,16 @@ class MappingReadonlyFile final : public ReadableFile, noncopyable, nonmovable {
     }
 
     capacity_ = file_.GetSize();
-    if (capacity_ < 0) {
+    if (capacity_ == (size_t)-1) {
       PEDRODB_ERROR("failed to get size of ptr {}: {}", path, file_.GetError());
       return Status::kIOError;
     }
 
+    // an empty file can not be mapped.
+    if (capacity_ == 0) {
+      return Status::kOk;
+    }
+
     data_ = (const char*)::mmap(nullptr, capacity_, PROT_READ, MAP_PRIVATE,
                                 file_.Descriptor(), 0);
     if (data_ == (char*)-1) {
@@ -5,7 +5,9 @@
 #include "pedrodb/file/readwrite_file.h"
 #include "pedrodb/logger/logger.h"
 
+#include <fcntl.h>
 #include <sys/mman.h>
+#include <unistd.h>
 namespace pedrodb {
 
 class MappingReadWriteFile final : public ReadWriteFile,
@@ -14,6 +16,10 @@ class MappingReadWriteFile final : public ReadWriteFile,
  public:
   using Ptr = std::shared_ptr<MappingReadWriteFile>;
 
+  // start the write back every `bytes_per_sync` bytes, 0 means never.
+  explicit MappingReadWriteFile(size_t bytes_per_sync = 0)
+      : bytes_per_sync_(bytes_per_sync) {}
+
   ~MappingReadWriteFile() override {
     if (data_ != nullptr) {
       munmap(data_, length_);
@@ -28,6 +34,8 @@ class MappingReadWriteFile final : public ReadWriteFile,
 
   void SetWriteOffset(size_t offset) noexcept override {
     write_index_ = offset;
+    async_index_ = offset;
+    synced_index_ = std::min(synced_index_, offset);
   }
 
   Status Open(const std::string& path) override { return Open(path, -1); }
@@ -94,10 +102,91 @@ class MappingReadWriteFile final : public ReadWriteFile,
     return buffer;
   }
 
+  // starts the write back once `bytes_per_sync` bytes are appended since the
+  // last one. The range is claimed under the lock, the syscall is made
+  // without it.
+  void WriteBack() override {
+    size_t begin, end;
+    {
+      std::unique_lock lock{mu_};
+      if (bytes_per_sync_ == 0 ||
+          write_index_ - async_index_ < bytes_per_sync_) {
+        return;
+      }
+      begin = async_index_ / GetPageSize() * GetPageSize();
+      end = write_index_;
+      async_index_ = end;
+    }
+
+#ifdef __linux__
+    // msync(MS_ASYNC) is a no-op on linux, so start the write back directly.
+    if (::sync_file_range(file_.Descriptor(), begin, end - begin,
+                          SYNC_FILE_RANGE_WRITE)) {
+      PEDRODB_WARN("failed to write back file {}: {}", file_, Error{errno});
+    }
+#else
+    if (::msync(data_ + begin, end - begin, MS_ASYNC)) {
+      PEDRODB_WARN("failed to write back file {}: {}", file_, Error{errno});
+    }
+#endif
+  }
+
+  // only sync the pages written after the last sync.
   Error Sync() override {
-    if (msync(data_, length_, MS_SYNC) < 0) {
+    size_t begin, end;
+    {
+      std::unique_lock lock{mu_};
+      begin = synced_index_;
+      end = write_index_;
+    }
+
+    if (begin >= end) {
+      return Error::kOk;
+    }
+
+    begin = begin / GetPageSize() * GetPageSize();
+    if (msync(data_ + begin, end - begin, MS_SYNC) < 0) {
       return file_.GetError();
     }
+
+    std::unique_lock lock{mu_};
+    synced_index_ = std::max(synced_index_, end);
+    return Error::kOk;
+  }
+
+  size_t GetUnsyncedBytes() noexcept override {
+    std::unique_lock lock{mu_};
+    return write_index_ > synced_index_ ? write_index_ - synced_index_ : 0;
+  }
+
+  // shrinks the file to the written bytes rounded up to `align` durably,
+  // nothing can be appended after that. The pages past the new end are
+  // unmapped, so they are never accessed beyond the end of file.
+  Error Truncate(size_t align) {
+    std::unique_lock lock{mu_};
+    size_t length = (write_index_ + align - 1) / align * align;
+    if (length >= length_) {
+      write_index_ = length_;
+      return Error::kOk;
+    }
+
+    if (::ftruncate(file_.Descriptor(), length) < 0) {
+      return Error{errno};
+    }
+    if (::fsync(file_.Descriptor()) < 0) {
+      return Error{errno};
+    }
+
+    size_t page = GetPageSize();
+    size_t mapped = (length + page - 1) / page * page;
+    if (mapped < length_) {
+      ::munmap(data_ + mapped, length_ - mapped);
+    }
+
+    length_ = length;
+    write_index_ = length_;
+    async_index_ = length_;
+    synced_index_ = length_;
     return Error::kOk;
   }
 
@@ -106,11 +195,20 @@ class MappingReadWriteFile final : public ReadWriteFile,
   }
 
  private:
+  static size_t GetPageSize() noexcept {
+    static const size_t page_size = ::sysconf(_SC_PAGESIZE);
+    return page_size;
+  }
+
   File file_;
   char* data_{};
   size_t write_index_{};
   size_t length_{};
   std::mutex mu_;
+
+  const size_t bytes_per_sync_{};
+  size_t async_index_{};
+  size_t synced_index_{};
 };
 
 }  // namespace pedrodb
@@ -1,6 +1,7 @@
 #ifndef PEDRODB_FILE_POSIX_READONLY_FILE_H
 #define PEDRODB_FILE_POSIX_READONLY_FILE_H
 
+#include <fcntl.h>
 #include "pedrodb/defines.h"
 #include "pedrodb/file/readable_file.h"
 #include "pedrodb/logger/logger.h"
@@ -23,6 +24,16 @@ class PosixReadonlyFile final : public ReadableFile, noncopyable, nonmovable {
     return file_.Pread(offset, data, length);
   }
 
+  ssize_t ReadV(uint64_t offset, const iovec* iov, size_t n) override {
+    return PReadV(file_.Descriptor(), offset, iov, n);
+  }
+
+  void Prefetch(uint64_t offset, size_t n) override {
+    if (offset < length_) {
+      ::posix_fadvise(file_.Descriptor(), offset, n, POSIX_FADV_WILLNEED);
+    }
+  }
+
   [[nodiscard]] uint64_t Size() const noexcept override { return length_; }
 
   [[nodiscard]] Error GetError() const noexcept override {
@@ -31,7 +31,10 @@ class PosixReadWriteFile final : public ReadWriteFile, noncopyable, nonmovable {
     return static_cast<ssize_t>(end - offset);
   }
 
-  void SetWriteOffset(size_t n) noexcept override { offset_ = n; }
+  void SetWriteOffset(size_t n) noexcept override {
+    offset_ = n;
+    synced_offset_ = std::min(synced_offset_, n);
+  }
 
   WritableBuffer Allocate(size_t n) override {
     if (n > buffer_.size() - offset_) {
@@ -63,7 +66,15 @@ class PosixReadWriteFile final : public ReadWriteFile, noncopyable, nonmovable {
     if (auto err = Flush(true); err != Error::kOk) {
       return err;
     }
-    return file_.Sync();
+    if (auto err = file_.Sync(); err != Error::kOk) {
+      return err;
+    }
+    synced_offset_ = flush_offset_;
+    return Error::kOk;
+  }
+
+  size_t GetUnsyncedBytes() noexcept override {
+    return offset_ - synced_offset_;
   }
 
   Status Open(const std::string& path) override { return Open(path, -1); }
@@ -117,6 +128,7 @@ class PosixReadWriteFile final : public ReadWriteFile, noncopyable, nonmovable {
 
   std::string buffer_;
   size_t flush_offset_{};
+  size_t synced_offset_{};
   size_t offset_{};
   std::mutex mu_;
 };
@@ -1,9 +1,19 @@
 #ifndef PEDRODB_FILE_READABLE_FILE_H
 #define PEDRODB_FILE_READABLE_FILE_H
 #include <pedrolib/noncopyable.h>
+#include <sys/uio.h>
+#include <algorithm>
+#include <climits>
 #include <memory>
 namespace pedrodb {
 
+struct ReadRequest {
+  uint64_t offset{};
+  char* buf{};
+  size_t n{};
+  ssize_t result{};
+};
+
 struct ReadableFile {
   using Ptr = std::shared_ptr<ReadableFile>;
 
@@ -13,6 +23,58 @@ struct ReadableFile {
   [[nodiscard]] virtual Error GetError() const noexcept = 0;
   virtual ssize_t Read(uint64_t offset, char* buf, size_t n) = 0;
   virtual Status Open(const std::string& path) = 0;
+
+  // Reads several ranges at once, the result of each range is the same as
+  // Read. Implementations may submit them together.
+  virtual void MultiRead(ReadRequest* requests, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      auto& r = requests[i];
+      r.result = Read(r.offset, r.buf, r.n);
+    }
+  }
+
+  // Reads a range into several buffers in order, the result is the same as
+  // Read. Implementations may read them by one preadv.
+  virtual ssize_t ReadV(uint64_t offset, const iovec* iov, size_t n) {
+    ssize_t total = 0;
+    for (size_t i = 0; i < n; ++i) {
+      ssize_t r = Read(offset + total, static_cast<char*>(iov[i].iov_base),
+                       iov[i].iov_len);
+      if (r < 0) {
+        return total == 0 ? r : total;
+      }
+      total += r;
+      if (r != static_cast<ssize_t>(iov[i].iov_len)) {
+        break;
+      }
+    }
+    return total;
+  }
+
+  // hints that the range will be read soon, it never blocks.
+  virtual void Prefetch(uint64_t /*offset*/, size_t /*n*/) {}
+
+ protected:
+  // ReadV by preadv on `fd`, at most IOV_MAX buffers per call.
+  static ssize_t PReadV(int fd, uint64_t offset, const iovec* iov, size_t n) {
+    ssize_t total = 0;
+    size_t expected = 0;
+    for (size_t i = 0; i < n; i += IOV_MAX) {
+      size_t count = std::min<size_t>(n - i, IOV_MAX);
+      ssize_t r = ::preadv(fd, iov + i, count, offset + total);
+      if (r < 0) {
+        return total == 0 ? r : total;
+      }
+      total += r;
+      for (size_t k = i; k < i + count; ++k) {
+        expected += iov[k].iov_len;
+      }
+      if (static_cast<size_t>(total) != expected) {
+        break;
+      }
+    }
+    return total;
+  }
 };
 
 class ReadableBuffer {
@@ -43,6 +43,13 @@ struct ReadWriteFile : public ReadableFile {
 
   virtual Error Flush(bool force) = 0;
   virtual Error Sync() = 0;
+
+  // starts writing back the appended pages without waiting for them. It is
+  // called without the lock, so the appends never wait for the syscall.
+  virtual void WriteBack() {}
+
+  // the bytes written but not synced yet.
+  [[nodiscard]] virtual size_t GetUnsyncedBytes() noexcept = 0;
   [[nodiscard]] Error GetError() const noexcept override = 0;
 
   virtual Status Open(const std::string& path, size_t capacity) = 0;
@@ -0,0 +1,179 @@
+#ifndef PEDRODB_FILE_URING_READONLY_FILE_H
+#define PEDRODB_FILE_URING_READONLY_FILE_H
+
+#ifdef PEDRODB_WITH_IO_URING
+
+#include <fcntl.h>
+#include <liburing.h>
+#include "pedrodb/defines.h"
+#include "pedrodb/file/readable_file.h"
+#include "pedrodb/logger/logger.h"
+#include "pedrodb/status.h"
+
+namespace pedrodb {
+
+// UringReadonlyFile submits the ranges of MultiRead by io_uring in one
+// syscall, and reaps the completions in batches. Single reads still use
+// pread, since they gain nothing from the ring.
+class UringReadonlyFile final : public ReadableFile, noncopyable, nonmovable {
+ public:
+  using Ptr = std::shared_ptr<UringReadonlyFile>;
+
+ private:
+  // every thread submits its reads by its own ring.
+  struct Ring {
+    constexpr static unsigned kDepth = 64;
+
+    io_uring ring_{};
+    bool valid_{};
+
+    Ring() {
+      int err = io_uring_queue_init(kDepth, &ring_, 0);
+      valid_ = err == 0;
+      if (!valid_) {
+        PEDRODB_WARN("io_uring is not available, fallback to pread: {}",
+                     Error{-err});
+      }
+    }
+
+    ~Ring() {
+      if (valid_) {
+        io_uring_queue_exit(&ring_);
+      }
+    }
+  };
+
+  static Ring& GetRing() {
+    thread_local static Ring ring;
+    return ring;
+  }
+
+  File file_;
+  size_t length_{};
+
+  // reaps the completions, a short read is completed by pread.
+  size_t Reap(Ring* ring) {
+    unsigned head;
+    unsigned count = 0;
+    io_uring_cqe* cqe;
+    io_uring_for_each_cqe(&ring->ring_, head, cqe) {
+      auto r = static_cast<ReadRequest*>(io_uring_cqe_get_data(cqe));
+      ssize_t res = cqe->res;
+      if (res > 0 && static_cast<size_t>(res) < r->n) {
+        ssize_t rest = Read(r->offset + res, r->buf + res, r->n - res);
+        if (rest > 0) {
+          res += rest;
+        }
+      }
+      r->result = res < 0 ? -1 : res;
+      count++;
+    }
+    io_uring_cq_advance(&ring->ring_, count);
+    return count;
+  }
+
+  // waits for the reads taken by the kernel, then drops the ring with the
+  // others and reads them by pread. The sqes are taken in order, so the ones
+  // left in the ring are the last ones submitted. If the completions are
+  // lost, the reads taken by the kernel stay failed: their buffers may still
+  // be written, so they are never read into again.
+  void Fallback(Ring* ring, ReadRequest* requests, size_t n, size_t submitted,
+                size_t completed) {
+    size_t pending = io_uring_sq_ready(&ring->ring_);
+    size_t taken = submitted - pending;
+    while (completed < taken) {
+      io_uring_cqe* cqe;
+      int err = io_uring_wait_cqe(&ring->ring_, &cqe);
+      if (err < 0 && err != -EINTR && err != -EAGAIN) {
+        PEDRODB_ERROR("failed to wait {} reads of file {}: {}",
+                      taken - completed, file_, Error{-err});
+        break;
+      }
+      completed += Reap(ring);
+    }
+
+    io_uring_queue_exit(&ring->ring_);
+    ring->valid_ = false;
+    ReadableFile::MultiRead(requests + taken, n - taken);
+  }
+
+ public:
+  UringReadonlyFile() = default;
+  ~UringReadonlyFile() override = default;
+
+  ssize_t Read(uint64_t offset, char* data, size_t length) override {
+    return file_.Pread(offset, data, length);
+  }
+
+  ssize_t ReadV(uint64_t offset, const iovec* iov, size_t n) override {
+    return PReadV(file_.Descriptor(), offset, iov, n);
+  }
+
+  void MultiRead(ReadRequest* requests, size_t n) override {
+    auto& ring = GetRing();
+    if (!ring.valid_ || n <= 1) {
+      ReadableFile::MultiRead(requests, n);
+      return;
+    }
+
+    size_t submitted = 0;
+    size_t completed = 0;
+    while (completed < n) {
+      while (submitted < n) {
+        io_uring_sqe* sqe = io_uring_get_sqe(&ring.ring_);
+        if (sqe == nullptr) {
+          break;
+        }
+
+        // a read fails until its completion is reaped.
+        auto& r = requests[submitted++];
+        r.result = -1;
+        io_uring_prep_read(sqe, file_.Descriptor(), r.buf, r.n, r.offset);
+        io_uring_sqe_set_data(sqe, &r);
+      }
+
+      int err = io_uring_submit_and_wait(&ring.ring_, 1);
+      if (err < 0 && err != -EINTR && err != -EAGAIN && err != -EBUSY) {
+        PEDRODB_WARN("failed to submit reads of file {}: {}, fallback to pread",
+                     file_, Error{-err});
+        Fallback(&ring, requests, n, submitted, completed);
+        return;
+      }
+      completed += Reap(&ring);
+    }
+  }
+
+  void Prefetch(uint64_t offset, size_t n) override {
+    if (offset < length_) {
+      ::posix_fadvise(file_.Descriptor(), offset, n, POSIX_FADV_WILLNEED);
+    }
+  }
+
+  [[nodiscard]] uint64_t Size() const noexcept override { return length_; }
+
+  [[nodiscard]] Error GetError() const noexcept override {
+    return file_.GetError();
+  }
+
+  Status Open(const std::string& path) override {
+    File::OpenOption option;
+    option.mode = File::OpenMode::kRead;
+
+    file_ = File::Open(path.c_str(), option);
+    if (!file_.Valid()) {
+      return Status::kIOError;
+    }
+
+    length_ = file_.GetSize();
+    if (length_ == -1) {
+      PEDRODB_ERROR("failed to get size of file {}: {}", path, GetError());
+      return Status::kIOError;
+    }
+    return Status::kOk;
+  }
+};
+}  // namespace pedrodb
+
+#endif  // PEDRODB_WITH_IO_URING
+
+#endif  // PEDRODB_FILE_URING_READONLY_FILE_H
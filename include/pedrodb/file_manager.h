@@ -1,6 +1,8 @@
 #ifndef PEDRODB_FILE_MANAGER_H
 #define PEDRODB_FILE_MANAGER_H
 
+#include <condition_variable>
+
 #include "pedrodb/cache/lru_cache.h"
 #include "pedrodb/cache/segment_cache.h"
 #include "pedrodb/defines.h"
@@ -8,9 +10,14 @@
 #include "pedrodb/file/mapping_readwrite_file.h"
 #include "pedrodb/file/posix_readonly_file.h"
 #include "pedrodb/file/posix_readwrite_file.h"
+#include "pedrodb/file/uring_readonly_file.h"
 #include "pedrodb/format/index_format.h"
+#include "pedrodb/group_commit.h"
 #include "pedrodb/logger/logger.h"
 #include "pedrodb/metadata_manager.h"
+#include "pedrodb/perf_context.h"
+#include "pedrodb/rate_limiter.h"
+#include "pedrodb/statistics.h"
 
 namespace pedrodb {
 
@@ -25,32 +32,111 @@ class FileManager : public std::enable_shared_from_this<FileManager> {
   ReadWriteFile::Ptr active_data_file_;
   file_id_t active_file_id_{};
 
+  // the inactive files which are not synced yet.
+  std::vector<ReadWriteFile::Ptr> unsynced_files_;
+
+  // one leader syncs for all the waiting requests.
+  GroupCommit group_commit_;
+
   std::shared_ptr<Executor> executor_{};
+  RateLimiter::Ptr rate_limiter_{};
+  Statistics::Ptr statistics_{};
+  size_t bytes_per_sync_{};
 
   Status CreateFile(file_id_t id);
 
+  void RemoveStaleFiles(file_id_t id);
+
+  Status WriteIndexFile(file_id_t id, const ArrayBuffer& log);
+
   Status Recovery(file_id_t active);
 
+  Status SyncFiles();
+
   auto AcquireLock() const noexcept { return std::unique_lock(mu_); }
 
  public:
   using Ptr = std::shared_ptr<FileManager>;
 
+  // OutputFile is a data file written by compaction. It is invisible until
+  // it is committed by MetadataManager::CompactFiles.
+  struct OutputFile {
+    file_id_t id{};
+    MappingReadWriteFile::Ptr file;
+    ArrayBuffer index_log;
+    size_t bytes{};
+
+    // appends the longest prefix of `entries` which fits in the file by one
+    // reservation, returns the number of appended entries.
+    size_t Append(const record::EntryView* entries, size_t n,
+                  uint32_t* offsets) {
+      size_t count = 0;
+      size_t length = 0;
+      while (count < n &&
+             length + entries[count].SizeOf() <= file->Size() - bytes) {
+        length += entries[count++].SizeOf();
+      }
+
+      if (count == 0) {
+        return 0;
+      }
+
+      WritableBuffer buffer = file->Allocate(length);
+      if (buffer.GetOffset() == (size_t)-1) {
+        return 0;
+      }
+
+      uint32_t offset = buffer.GetOffset();
+      for (size_t i = 0; i < count; ++i) {
+        auto& entry = entries[i];
+        entry.Pack(&buffer);
+        offsets[i] = offset;
+
+        index::EntryView index_entry;
+        index_entry.type = entry.type;
+        index_entry.key = entry.key;
+        index_entry.offset = offset;
+        index_entry.len = entry.SizeOf();
+        index_entry.Pack(&index_log);
+        offset += entry.SizeOf();
+      }
+      bytes += length;
+      file->WriteBack();
+      return count;
+    }
+  };
+
   FileManager(MetadataManager::Ptr metadata_manager,
-              std::shared_ptr<Executor> executor, uint8_t max_open_files)
-      : open_files_(max_open_files),
+              std::shared_ptr<Executor> executor,
+              RateLimiter::Ptr rate_limiter, uint8_t max_open_files,
+              size_t bytes_per_sync, Statistics::Ptr statistics = nullptr)
+      : metadata_manager_(std::move(metadata_manager)),
+        open_files_(max_open_files),
         executor_(std::move(executor)),
-        metadata_manager_(std::move(metadata_manager)) {}
+        rate_limiter_(std::move(rate_limiter)),
+        statistics_(std::move(statistics)),
+        bytes_per_sync_(bytes_per_sync) {}
 
   Status Init();
 
   Status Sync();
 
+  // the bytes of the data files which are not synced yet.
+  size_t GetUnsyncedBytes();
+
+  // waits for the rate limiter before the background io.
+  void Throttle(size_t bytes, IOPriority priority) {
+    if (rate_limiter_ != nullptr && bytes != 0) {
+      rate_limiter_->Request(bytes, priority);
+    }
+  }
+
   Status Flush(bool force);
 
   template <typename Key, typename Value>
   Status Append(const record::Entry<Key, Value>& entry, record::Location* loc) {
     for (;;) {
+      PerfTimer lock_timer(&PerfContext::append_lock_nanos);
       auto lock = AcquireLock();
       auto file_id = active_file_id_;
       auto data_file = active_data_file_;
@@ -58,21 +144,40 @@ class FileManager : public std::enable_shared_from_this<FileManager> {
       lock.unlock();
       
       auto flock = data_file->GetLock();
+      lock_timer.Stop();
+
+      PerfTimer copy_timer(&PerfContext::append_copy_nanos);
       WritableBuffer buffer = data_file->Allocate(entry.SizeOf());
       if (buffer.GetOffset() != -1) {
         entry.Pack(&buffer);
+        copy_timer.Stop();
+        PerfCount(&PerfContext::append_bytes, entry.SizeOf());
         data_file->Flush(false);
 
         loc->offset = buffer.GetOffset();
         loc->id = file_id;
 
-        index::Entry<Key> index_entry;
-        index_entry.type = entry.type;
-        index_entry.key = entry.key;
-        index_entry.offset = buffer.GetOffset();
-        index_entry.len = entry.SizeOf();
-
-        index_entry.Pack(index_log.get());
+        if (entry.type == record::Type::kBatch) {
+          record::ForEachInBatch(
+              entry, loc->offset, [&](uint32_t offset, auto next) {
+                index::EntryView index_entry;
+                index_entry.type = next.type;
+                index_entry.key = next.key;
+                index_entry.offset = offset;
+                index_entry.len = next.SizeOf();
+                index_entry.Pack(index_log.get());
+              });
+        } else {
+          index::Entry<Key> index_entry;
+          index_entry.type = entry.type;
+          index_entry.key = entry.key;
+          index_entry.offset = buffer.GetOffset();
+          index_entry.len = entry.SizeOf();
+          index_entry.Pack(index_log.get());
+        }
+
+        flock.unlock();
+        data_file->WriteBack();
         return Status::kOk;
       }
       flock.unlock();
@@ -82,18 +187,30 @@ class FileManager : public std::enable_shared_from_this<FileManager> {
         continue;
       }
       
-      auto status = CreateFile(file_id + 1);
+      auto status = CreateFile(metadata_manager_->NewFileId());
       if (status != Status::kOk) {
         return status;
       }
     }
   }
 
+  file_id_t GetActiveFileId() const noexcept {
+    auto lock = AcquireLock();
+    return active_file_id_;
+  }
+
+  Status CreateOutputFile(OutputFile* output);
+
+  // makes the output durable, it can not be appended anymore.
+  Status CloseOutputFile(OutputFile* output);
+
+  void RemoveOutputFile(const OutputFile& output);
+
   void ReleaseDataFile(file_id_t id);
 
   Status AcquireDataFile(file_id_t id, ReadableFile::Ptr* file);
 
-  Status AcquireIndexFile(file_id_t id, ReadableFile::Ptr* file);
+  Status AcquireIndexFile(file_id_t id, MappingReadonlyFile::Ptr* file);
 
   Status RemoveFile(file_id_t id);
 
@@ -0,0 +1,178 @@
+#ifndef PEDRODB_FORMAT_CHECKPOINT_FORMAT_H
+#define PEDRODB_FORMAT_CHECKPOINT_FORMAT_H
+
+#include <cstring>
+
+#include "pedrodb/defines.h"
+#include "pedrodb/format/record_format.h"
+
+namespace pedrodb::checkpoint {
+
+// The checkpoint is a snapshot of the memory index, so the files it covers
+// are not replayed by recovery:
+//
+//   magic | files block | entries block... | end block
+//   block: type (u8) | size (u32) | payload | checksum (u32)
+//
+// The files block holds the states of the covered files, the entries blocks
+// hold the live entries which point to them, and the end block holds the
+// count of entries. The fingerprint index saves fingerprints blocks instead
+// of entries blocks. The fields are native-endian. A checkpoint is ignored as
+// a whole if any block is damaged.
+constexpr char kMagic[8] = {0x00, 0x70, 'c', 'k', 'p', 't', 0, 1};
+
+enum class BlockType : uint8_t {
+  kFiles = 1,
+  kEntries = 2,
+  kEnd = 3,
+  kFingerprints = 4,
+};
+
+struct FileState {
+  file_id_t id{};
+  uint64_t free_bytes{};
+  uint64_t total_bytes{};
+
+  constexpr static size_t SizeOf() noexcept {
+    return sizeof(id) + sizeof(free_bytes) + sizeof(total_bytes);
+  }
+
+  void Pack(ArrayBuffer* buffer) const {
+    buffer->Append((const char*)&id, sizeof(id));
+    buffer->Append((const char*)&free_bytes, sizeof(free_bytes));
+    buffer->Append((const char*)&total_bytes, sizeof(total_bytes));
+  }
+
+  void UnPack(const char* data) noexcept {
+    memcpy(&id, data, sizeof(id));
+    memcpy(&free_bytes, data + 4, sizeof(free_bytes));
+    memcpy(&total_bytes, data + 12, sizeof(total_bytes));
+  }
+};
+
+struct Entry {
+  std::string_view key;
+  record::Dir dir;
+
+  constexpr static size_t SizeOf(uint8_t key_size) noexcept {
+    return sizeof(key_size) +  // key size
+           sizeof(file_id_t) + // file id
+           sizeof(uint32_t) +  // file offset
+           sizeof(uint32_t) +  // record entry len
+           key_size;
+  }
+
+  void Pack(ArrayBuffer* buffer) const {
+    auto key_size = static_cast<uint8_t>(key.size());
+    buffer->EnsureWritable(SizeOf(key_size));
+    buffer->Append((const char*)&key_size, sizeof(key_size));
+    buffer->Append((const char*)&dir.loc.id, sizeof(dir.loc.id));
+    buffer->Append((const char*)&dir.loc.offset, sizeof(dir.loc.offset));
+    buffer->Append((const char*)&dir.entry_size, sizeof(dir.entry_size));
+    buffer->Append(key.data(), key.size());
+  }
+
+  // returns the bytes parsed, 0 if the entry is incomplete.
+  size_t UnPack(const char* data, size_t size) noexcept {
+    if (size < SizeOf(0) || size < SizeOf((uint8_t)data[0])) {
+      return 0;
+    }
+
+    auto key_size = (uint8_t)data[0];
+    memcpy(&dir.loc.id, data + 1, sizeof(dir.loc.id));
+    memcpy(&dir.loc.offset, data + 5, sizeof(dir.loc.offset));
+    memcpy(&dir.entry_size, data + 9, sizeof(dir.entry_size));
+    key = {data + SizeOf(0), key_size};
+    return SizeOf(key_size);
+  }
+};
+
+struct FingerprintEntry {
+  uint64_t fingerprint{};
+  record::Dir dir;
+
+  constexpr static size_t SizeOf() noexcept {
+    return sizeof(fingerprint) +  // fingerprint
+           sizeof(file_id_t) +    // file id
+           sizeof(uint32_t) +     // file offset
+           sizeof(uint32_t);      // record entry len
+  }
+
+  void Pack(ArrayBuffer* buffer) const {
+    buffer->EnsureWritable(SizeOf());
+    buffer->Append((const char*)&fingerprint, sizeof(fingerprint));
+    buffer->Append((const char*)&dir.loc.id, sizeof(dir.loc.id));
+    buffer->Append((const char*)&dir.loc.offset, sizeof(dir.loc.offset));
+    buffer->Append((const char*)&dir.entry_size, sizeof(dir.entry_size));
+  }
+
+  void UnPack(const char* data) noexcept {
+    memcpy(&fingerprint, data, sizeof(fingerprint));
+    memcpy(&dir.loc.id, data + 8, sizeof(dir.loc.id));
+    memcpy(&dir.loc.offset, data + 12, sizeof(dir.loc.offset));
+    memcpy(&dir.entry_size, data + 16, sizeof(dir.entry_size));
+  }
+};
+
+inline void AppendBlock(BlockType type, const char* payload, size_t size,
+                        ArrayBuffer* out) {
+  auto u8_type = static_cast<uint8_t>(type);
+  auto u32_size = static_cast<uint32_t>(size);
+  uint32_t checksum = Hash({payload, size});
+  out->EnsureWritable(sizeof(u8_type) + sizeof(u32_size) + size +
+                      sizeof(checksum));
+  out->Append((const char*)&u8_type, sizeof(u8_type));
+  out->Append((const char*)&u32_size, sizeof(u32_size));
+  out->Append(payload, size);
+  out->Append((const char*)&checksum, sizeof(checksum));
+}
+
+// reads the blocks of a checkpoint in place.
+class BlockReader {
+  const char* data_;
+  size_t size_;
+  size_t index_{sizeof(kMagic)};
+  bool corrupted_{};
+
+ public:
+  BlockReader(const char* data, size_t size) : data_(data), size_(size) {
+    if (size < sizeof(kMagic) || memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+      corrupted_ = true;
+    }
+  }
+
+  [[nodiscard]] bool Corrupted() const noexcept { return corrupted_; }
+
+  bool Next(BlockType* type, std::string_view* payload) noexcept {
+    constexpr size_t kHeader = sizeof(uint8_t) + sizeof(uint32_t);
+    if (corrupted_ || index_ == size_) {
+      return false;
+    }
+
+    uint32_t size = 0;
+    if (size_ - index_ >= kHeader) {
+      memcpy(&size, data_ + index_ + 1, sizeof(size));
+    }
+
+    uint32_t checksum = 0;
+    if (size_ - index_ < kHeader + size + sizeof(checksum)) {
+      corrupted_ = true;
+      return false;
+    }
+
+    *type = static_cast<BlockType>(data_[index_]);
+    *payload = {data_ + index_ + kHeader, size};
+    memcpy(&checksum, payload->data() + size, sizeof(checksum));
+    if (checksum != Hash(*payload)) {
+      corrupted_ = true;
+      return false;
+    }
+
+    index_ += kHeader + size + sizeof(checksum);
+    return true;
+  }
+};
+
+}  // namespace pedrodb::checkpoint
+
+#endif  // PEDRODB_FORMAT_CHECKPOINT_FORMAT_H
@@ -1,6 +1,10 @@
 #ifndef PEDROKV_FORMAT_INDEX_FORMAT_H
 #define PEDROKV_FORMAT_INDEX_FORMAT_H
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
 #include "pedrodb/defines.h"
 #include "pedrodb/format/record_format.h"
 
@@ -63,6 +67,109 @@ struct Entry {
 
 using EntryView = Entry<std::string_view>;
 
+// The index file v2 is written once a data file is closed:
+//
+//   header | entries sorted by key | checksum
+//
+// An entry omits the prefix shared with the previous key. The fields are
+// native-endian and fixed-width, so the file is read from mmap directly. A
+// v1 file starts with the key size, it never starts with the magic since the
+// type after an empty key is never 0x70.
+struct HeaderV2 {
+  constexpr static char kMagic[8] = {0x00, 0x70, 'i', 'd', 'x', 0, 0, 2};
+
+  uint64_t count{};
+  uint64_t key_bytes{};
+
+  constexpr static size_t SizeOf() noexcept {
+    return sizeof(kMagic) + sizeof(count) + sizeof(key_bytes);
+  }
+
+  static bool Match(const char* data, size_t size) noexcept {
+    return size >= sizeof(kMagic) &&
+           memcmp(data, kMagic, sizeof(kMagic)) == 0;
+  }
+};
+
+struct EntryV2 {
+  uint32_t offset{};
+  uint32_t len{};
+  uint8_t type{};
+  uint8_t shared{};
+  uint8_t suffix{};
+
+  constexpr static size_t SizeOf() noexcept {
+    return sizeof(offset) + sizeof(len) + sizeof(type) + sizeof(shared) +
+           sizeof(suffix);
+  }
+
+  void Pack(char* data) const noexcept {
+    memcpy(data, &offset, sizeof(offset));
+    memcpy(data + 4, &len, sizeof(len));
+    data[8] = (char)type;
+    data[9] = (char)shared;
+    data[10] = (char)suffix;
+  }
+
+  void UnPack(const char* data) noexcept {
+    memcpy(&offset, data, sizeof(offset));
+    memcpy(&len, data + 4, sizeof(len));
+    type = data[8];
+    shared = data[9];
+    suffix = data[10];
+  }
+};
+
+// converts the index log (v1 entries in the order of offset) into v2.
+inline void BuildIndexFile(const char* log, size_t size, ArrayBuffer* out) {
+  ReadableView view(log, size);
+  std::vector<EntryView> entries;
+  EntryView entry;
+  HeaderV2 header;
+  while (entry.UnPack(&view)) {
+    entries.emplace_back(entry);
+    header.key_bytes += entry.key.size();
+  }
+  header.count = entries.size();
+
+  // the versions of a key keep the order of offset.
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](auto& x, auto& y) { return x.key < y.key; });
+
+  out->EnsureWritable(HeaderV2::SizeOf() + sizeof(uint32_t) +
+                      entries.size() * EntryV2::SizeOf() + header.key_bytes);
+  size_t begin = out->ReadableBytes();
+  out->Append(HeaderV2::kMagic, sizeof(HeaderV2::kMagic));
+  out->Append((const char*)&header.count, sizeof(header.count));
+  out->Append((const char*)&header.key_bytes, sizeof(header.key_bytes));
+
+  std::string_view prev;
+  for (auto& e : entries) {
+    size_t shared = 0;
+    while (shared < prev.size() && shared < e.key.size() &&
+           prev[shared] == e.key[shared]) {
+      shared++;
+    }
+
+    EntryV2 packed;
+    packed.offset = e.offset;
+    packed.len = e.len;
+    packed.type = (uint8_t)e.type;
+    packed.shared = shared;
+    packed.suffix = e.key.size() - shared;
+
+    char fixed[EntryV2::SizeOf()];
+    packed.Pack(fixed);
+    out->Append(fixed, sizeof(fixed));
+    out->Append(e.key.data() + shared, packed.suffix);
+    prev = e.key;
+  }
+
+  uint32_t checksum = Hash({out->ReadIndex() + begin,
+                            out->ReadableBytes() - begin});
+  out->Append((const char*)&checksum, sizeof(checksum));
+}
+
 }  // namespace pedrodb::index
 
 #endif  //PEDROKV_FORMAT_INDEX_FORMAT_H
@@ -1,6 +1,7 @@
 #ifndef PEDRODB_FORMAT_METADATA_FORMAT_H
 #define PEDRODB_FORMAT_METADATA_FORMAT_H
 
+#include <vector>
 #include "pedrodb/defines.h"
 
 namespace pedrodb::metadata {
@@ -39,6 +40,7 @@ struct Header {
 enum class LogType {
   kCreateFile,
   kDeleteFile,
+  kCompactFiles,
 };
 
 struct LogEntry {
@@ -70,6 +72,81 @@ struct LogEntry {
     AppendInt(buffer, id);
   }
 };
+// CompactionEntry atomically registers the output files of a compaction and
+// deletes its victims. The outputs are recovered with `rank` instead of
+// their ids, so they are never newer than the data written after them.
+struct CompactionEntry {
+  file_id_t rank{};
+  std::vector<file_id_t> outputs;
+  std::vector<file_id_t> victims;
+
+  [[nodiscard]] size_t SizeOf() const noexcept {
+    return sizeof(uint8_t) + sizeof(file_id_t) + sizeof(uint32_t) * 3 +
+           sizeof(file_id_t) * (outputs.size() + victims.size());
+  }
+
+  template <class ReadableBuffer>
+  bool UnPack(ReadableBuffer* buffer) {
+    const size_t kFixedBytes = sizeof(uint8_t) + sizeof(file_id_t) +
+                               sizeof(uint32_t) * 2;
+    if (buffer->ReadableBytes() < kFixedBytes) {
+      return false;
+    }
+
+    const char* begin = buffer->ReadIndex();
+    uint8_t u8_type;
+    uint32_t n_outputs;
+    uint32_t n_victims;
+    PeekInt(buffer, &u8_type);
+    if (u8_type != (uint8_t)LogType::kCompactFiles) {
+      return false;
+    }
+
+    buffer->Retrieve(sizeof(uint8_t));
+    RetrieveInt(buffer, &rank);
+    RetrieveInt(buffer, &n_outputs);
+    RetrieveInt(buffer, &n_victims);
+
+    // the counts are summed in 64 bits, a torn entry must not wrap them.
+    uint64_t n = uint64_t{n_outputs} + n_victims;
+    if (buffer->ReadableBytes() < (n + 1) * sizeof(uint32_t)) {
+      return false;
+    }
+
+    outputs.resize(n_outputs);
+    victims.resize(n_victims);
+    for (auto& id : outputs) {
+      RetrieveInt(buffer, &id);
+    }
+    for (auto& id : victims) {
+      RetrieveInt(buffer, &id);
+    }
+
+    uint32_t checksum;
+    std::string_view content(begin, buffer->ReadIndex() - begin);
+    RetrieveInt(buffer, &checksum);
+    return checksum == Hash(content);
+  }
+
+  template <class WritableBuffer>
+  void Pack(WritableBuffer* buffer) const {
+    size_t begin = buffer->ReadableBytes();
+    AppendInt(buffer, (uint8_t)LogType::kCompactFiles);
+    AppendInt(buffer, rank);
+    AppendInt(buffer, (uint32_t)outputs.size());
+    AppendInt(buffer, (uint32_t)victims.size());
+    for (auto id : outputs) {
+      AppendInt(buffer, id);
+    }
+    for (auto id : victims) {
+      AppendInt(buffer, id);
+    }
+
+    std::string_view content(buffer->ReadIndex() + begin,
+                             buffer->ReadableBytes() - begin);
+    AppendInt(buffer, Hash(content));
+  }
+};
 }  // namespace pedrodb::metadata
 
 #endif  // PEDRODB_FORMAT_METADATA_FORMAT_H
@@ -6,8 +6,30 @@
 #include "pedrodb/defines.h"
 #include "pedrodb/status.h"
 
+namespace pedrodb {
+
+class ReadableView final {
+  const char* buf_;
+
+  size_t read_index_;
+  size_t write_index_;
+
+ public:
+  ReadableView(const char* buf, size_t length)
+      : buf_(buf), read_index_(0), write_index_(length) {}
+
+  [[nodiscard]] size_t ReadableBytes() const noexcept {
+    return write_index_ - read_index_;
+  }
+  [[nodiscard]] const char* ReadIndex() const noexcept {
+    return read_index_ + buf_;
+  }
+  void Retrieve(size_t n) noexcept { read_index_ += n; }
+};
+}  // namespace pedrodb
+
 namespace pedrodb::record {
-enum class Type { kEmpty = 0, kSet = 1, kDelete = 2 };
+enum class Type { kEmpty = 0, kSet = 1, kDelete = 2, kBatch = 3 };
 
 struct Header {
   uint32_t checksum{};
@@ -129,6 +151,27 @@ struct Entry {
 
 using EntryView = Entry<std::string_view, std::string_view>;
 
+// A kBatch entry packs every record of a WriteBatch into its value, so the
+// whole batch shares one checksum and is recovered entirely or not at all.
+// Each packed record is a complete entry, which can be read directly at its
+// own file offset. `offset` is the file offset of the kBatch entry.
+template <class BatchEntry, class Visitor>
+bool ForEachInBatch(const BatchEntry& batch, uint32_t offset,
+                    Visitor&& visitor) {
+  offset += Header::SizeOf() + std::size(batch.key);
+
+  ReadableView view(std::data(batch.value), std::size(batch.value));
+  while (view.ReadableBytes()) {
+    EntryView entry;
+    if (!entry.UnPack(&view) || entry.type == Type::kBatch) {
+      return false;
+    }
+    visitor(offset, entry);
+    offset += entry.SizeOf();
+  }
+  return true;
+}
+
 struct Location {
   file_id_t id{};
   uint32_t offset{};
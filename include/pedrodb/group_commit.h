@@ -0,0 +1,65 @@
+#ifndef PEDRODB_GROUP_COMMIT_H
+#define PEDRODB_GROUP_COMMIT_H
+
+#include <condition_variable>
+#include <mutex>
+
+#include "pedrodb/defines.h"
+#include "pedrodb/status.h"
+
+namespace pedrodb {
+
+// GroupCommit lets concurrent requests share one sync. A request becomes
+// the leader if no sync is running, and its sync covers every request issued
+// before it starts. The others wait for the result of a sync covering them.
+class GroupCommit : noncopyable, nonmovable {
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool syncing_{};
+  uint64_t requests_{};
+  uint64_t synced_requests_{};
+  uint64_t failed_requests_{};
+
+ public:
+  GroupCommit() = default;
+
+  template <class F>
+  Status Commit(F&& sync) {
+    std::unique_lock lock{mu_};
+    uint64_t request = ++requests_;
+    for (;;) {
+      if (synced_requests_ >= request) {
+        return Status::kOk;
+      }
+
+      if (failed_requests_ >= request) {
+        return Status::kIOError;
+      }
+
+      if (!syncing_) {
+        break;
+      }
+      cv_.wait(lock);
+    }
+
+    // be the leader, the sync covers every request issued before it starts.
+    syncing_ = true;
+    uint64_t covered = requests_;
+    lock.unlock();
+
+    Status status = sync();
+
+    lock.lock();
+    syncing_ = false;
+    if (status == Status::kOk) {
+      synced_requests_ = covered;
+    } else {
+      failed_requests_ = covered;
+    }
+    cv_.notify_all();
+    return status;
+  }
+};
+}  // namespace pedrodb
+
+#endif  // PEDRODB_GROUP_COMMIT_H
@@ -0,0 +1,156 @@
+#ifndef PEDRODB_INDEX_FINGERPRINT_TABLE_H
+#define PEDRODB_INDEX_FINGERPRINT_TABLE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "pedrodb/defines.h"
+#include "pedrodb/format/record_format.h"
+
+namespace pedrodb {
+
+// FingerprintTable maps the 64-bit hashes of keys to dirs without keeping the
+// keys. It is an open addressing table with linear probing, the hashes and
+// the dirs are stored in separate arrays, 20 bytes per slot. Distinct keys of
+// the same hash take different slots, the caller tells them apart.
+//
+// It is not thread safe. The slots are atomic, so a reader racing with the
+// writer reads a stale slot at worst, which is detected by the caller.
+class FingerprintTable {
+ public:
+  constexpr static uint64_t kEmpty = 0;
+  constexpr static size_t kMinBits = 4;
+
+  // the table grows if it is more than 80% full.
+  constexpr static size_t kMaxLoadPercent = 80;
+
+  explicit FingerprintTable(size_t bits)
+      : bits_(std::max(bits, kMinBits)),
+        hashes_(std::make_unique<std::atomic<uint64_t>[]>(1ULL << bits_)),
+        dirs_(std::make_unique<std::atomic<uint32_t>[]>(3ULL << bits_)) {}
+
+  // the fingerprint of a key is its hash, 0 marks the empty slots.
+  static uint64_t Fingerprint(uint64_t hash) noexcept {
+    return hash == kEmpty ? 1 : hash;
+  }
+
+  // the bits of a table which holds `n` slots without growing.
+  static size_t BitsFor(size_t n) noexcept {
+    size_t bits = kMinBits;
+    while ((1ULL << bits) * kMaxLoadPercent < n * 100) {
+      bits++;
+    }
+    return bits;
+  }
+
+  [[nodiscard]] size_t GetBits() const noexcept { return bits_; }
+
+  [[nodiscard]] bool IsFull(size_t n) const noexcept {
+    return n * 100 > (1ULL << bits_) * kMaxLoadPercent;
+  }
+
+  void Load(size_t i, record::Dir* dir) const noexcept {
+    dir->entry_size = dirs_[3 * i].load(std::memory_order_relaxed);
+    dir->loc.id = dirs_[3 * i + 1].load(std::memory_order_relaxed);
+    dir->loc.offset = dirs_[3 * i + 2].load(std::memory_order_relaxed);
+  }
+
+  void Store(size_t i, const record::Dir& dir) noexcept {
+    dirs_[3 * i].store(dir.entry_size, std::memory_order_relaxed);
+    dirs_[3 * i + 1].store(dir.loc.id, std::memory_order_relaxed);
+    dirs_[3 * i + 2].store(dir.loc.offset, std::memory_order_relaxed);
+  }
+
+  // visits the slots of `fingerprint` until an empty slot, stops if f(i)
+  // returns true. Returns false if it takes more than `max_steps`.
+  template <class F>
+  bool Probe(uint64_t fingerprint, F&& f,
+             size_t max_steps = SIZE_MAX) const noexcept {
+    size_t i = Home(fingerprint);
+    for (size_t steps = 0; steps <= max_steps; ++steps, i = Next(i)) {
+      uint64_t hash = hashes_[i].load(std::memory_order_relaxed);
+      if (hash == kEmpty) {
+        return true;
+      }
+      if (hash == fingerprint && f(i)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // puts the entry into the first empty slot, the table must not be full.
+  void Put(uint64_t fingerprint, const record::Dir& dir) noexcept {
+    size_t i = Home(fingerprint);
+    while (hashes_[i].load(std::memory_order_relaxed) != kEmpty) {
+      i = Next(i);
+    }
+    Store(i, dir);
+    hashes_[i].store(fingerprint, std::memory_order_relaxed);
+  }
+
+  // clears the slot and shifts the following ones back, so the probing never
+  // passes a hole.
+  void Erase(size_t i) noexcept {
+    for (size_t j = Next(i);; j = Next(j)) {
+      uint64_t hash = hashes_[j].load(std::memory_order_relaxed);
+      if (hash == kEmpty) {
+        break;
+      }
+
+      // the entry at j can not move to i if its home is in (i, j].
+      size_t home = Home(hash);
+      if (i <= j ? (i < home && home <= j) : (i < home || home <= j)) {
+        continue;
+      }
+
+      record::Dir dir;
+      Load(j, &dir);
+      Store(i, dir);
+      hashes_[i].store(hash, std::memory_order_relaxed);
+      i = j;
+    }
+    hashes_[i].store(kEmpty, std::memory_order_relaxed);
+  }
+
+  void CopyTo(FingerprintTable* table) const noexcept {
+    for (size_t i = 0; i < (1ULL << bits_); ++i) {
+      uint64_t hash = hashes_[i].load(std::memory_order_relaxed);
+      if (hash != kEmpty) {
+        record::Dir dir;
+        Load(i, &dir);
+        table->Put(hash, dir);
+      }
+    }
+  }
+
+  template <class F>
+  void ForEach(F&& f) const {
+    for (size_t i = 0; i < (1ULL << bits_); ++i) {
+      uint64_t hash = hashes_[i].load(std::memory_order_relaxed);
+      if (hash != kEmpty) {
+        record::Dir dir;
+        Load(i, &dir);
+        f(hash, dir);
+      }
+    }
+  }
+
+ private:
+  [[nodiscard]] size_t Home(uint64_t hash) const noexcept {
+    return (hash * 0x9E3779B97F4A7C15ULL) >> (64 - bits_);
+  }
+
+  [[nodiscard]] size_t Next(size_t i) const noexcept {
+    return (i + 1) & ((1ULL << bits_) - 1);
+  }
+
+  const size_t bits_;
+  std::unique_ptr<std::atomic<uint64_t>[]> hashes_;
+  std::unique_ptr<std::atomic<uint32_t>[]> dirs_;
+};
+}  // namespace pedrodb
+
+#endif  // PEDRODB_INDEX_FINGERPRINT_TABLE_H
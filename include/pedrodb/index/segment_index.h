@@ -0,0 +1,1001 @@
+#ifndef PEDRODB_INDEX_SEGMENT_INDEX_H
+#define PEDRODB_INDEX_SEGMENT_INDEX_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "pedrodb/defines.h"
+#include "pedrodb/format/record_format.h"
+#include "pedrodb/index/fingerprint_table.h"
+
+namespace pedrodb {
+
+// SegmentIndex is the memory index of keys, partitioned by the hash of keys.
+// Writers of a segment are serialized by the segment lock, and writers of
+// different segments run in parallel.
+//
+// Readers never take a lock. Every segment is a chained hash table whose
+// nodes are never freed but recycled within the segment, so a reader can
+// always dereference what it reads. A reader validates its snapshot with the
+// sequence of the segment, which changes when nodes are unlinked or the
+// table is resized, and with the version of the node, which changes when its
+// dir is updated. It only retries if one of them changed.
+//
+// In the fingerprint mode, a segment keeps the hashes of keys instead of the
+// keys in a FingerprintTable, every write of it changes the sequence. A
+// matching hash is confirmed by the KeyMatcher, which reads the key of the
+// record, so it is never called under the segment lock. The tables replaced
+// by resizing are freed once no reader is in the segment.
+//
+// The nodes may keep small values after the keys, they are read under the
+// version of the node like the dir. A value is dropped when its dir changes.
+class SegmentIndex : noncopyable, nonmovable {
+ public:
+  // returns true if the record at `dir` has the key.
+  using KeyMatcher =
+      std::function<bool(const record::Dir& dir, std::string_view key)>;
+
+  // hashes the keys instead of std::hash, such as to make collisions in
+  // tests.
+  using KeyHasher = std::function<uint64_t(std::string_view key)>;
+
+  constexpr static size_t kMaxInlineValueBytes = 64;
+
+  // the value of a key, it is kept only if the dir of the key is at `loc`
+  // after the update.
+  struct InlineValue {
+    record::Location loc;
+    std::string_view value;
+  };
+
+ private:
+  constexpr static uint16_t kNoValue = std::numeric_limits<uint16_t>::max();
+
+  struct Node {
+    std::atomic<Node*> next{};
+    std::atomic<uint32_t> version{};
+    std::atomic<uint32_t> entry_size{};
+    std::atomic<file_id_t> id{};
+    std::atomic<uint32_t> offset{};
+    std::atomic<uint64_t> hash{};
+    std::atomic<uint16_t> key_size{};
+    std::atomic<uint16_t> value_size{kNoValue};
+    uint32_t size_class{};
+
+    char* key() noexcept { return reinterpret_cast<char*>(this + 1); }
+
+    // the key is kept in words like the inline value, since a recycled node
+    // may be read by a reader while its new key is written.
+    std::atomic<uint64_t>* key_words() noexcept {
+      return reinterpret_cast<std::atomic<uint64_t>*>(this + 1);
+    }
+
+    // the words of the inline value follow the key capacity.
+    std::atomic<uint64_t>* value() noexcept {
+      return key_words() + size_class * kKeyAlign / sizeof(uint64_t);
+    }
+
+    void StoreKey(std::string_view k) noexcept {
+      for (size_t i = 0; i < k.size(); i += sizeof(uint64_t)) {
+        uint64_t word = 0;
+        memcpy(&word, k.data() + i, std::min(sizeof(word), k.size() - i));
+        key_words()[i / sizeof(word)].store(word, std::memory_order_relaxed);
+      }
+      key_size.store(k.size(), std::memory_order_relaxed);
+    }
+
+    // compares the key without lock, the result is validated by the caller.
+    bool KeyEquals(std::string_view k) noexcept {
+      if (key_size.load(std::memory_order_relaxed) != k.size()) {
+        return false;
+      }
+      for (size_t i = 0; i < k.size(); i += sizeof(uint64_t)) {
+        uint64_t word =
+            key_words()[i / sizeof(uint64_t)].load(std::memory_order_relaxed);
+        size_t n = std::min(sizeof(word), k.size() - i);
+        if (memcmp(&word, k.data() + i, n) != 0) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    void StoreValue(std::string_view v) noexcept {
+      for (size_t i = 0; i < v.size(); i += sizeof(uint64_t)) {
+        uint64_t word = 0;
+        memcpy(&word, v.data() + i, std::min(sizeof(word), v.size() - i));
+        value()[i / sizeof(word)].store(word, std::memory_order_relaxed);
+      }
+      value_size.store(v.size(), std::memory_order_relaxed);
+    }
+
+    // copies the inline value to `buf`, returns kNoValue if there is none.
+    uint16_t LoadValue(char* buf) noexcept {
+      uint16_t size = value_size.load(std::memory_order_relaxed);
+      if (size == kNoValue) {
+        return size;
+      }
+      for (size_t i = 0; i < size; i += sizeof(uint64_t)) {
+        uint64_t word =
+            value()[i / sizeof(uint64_t)].load(std::memory_order_relaxed);
+        memcpy(buf + i, &word, sizeof(word));
+      }
+      return size;
+    }
+
+    // only safe with the segment lock held.
+    std::string_view GetKey() noexcept { return {key(), key_size}; }
+
+    void Load(record::Dir* dir) const noexcept {
+      dir->entry_size = entry_size.load(std::memory_order_relaxed);
+      dir->loc.id = id.load(std::memory_order_relaxed);
+      dir->loc.offset = offset.load(std::memory_order_relaxed);
+    }
+
+    void Store(const record::Dir& dir) noexcept {
+      entry_size.store(dir.entry_size, std::memory_order_relaxed);
+      id.store(dir.loc.id, std::memory_order_relaxed);
+      offset.store(dir.loc.offset, std::memory_order_relaxed);
+    }
+  };
+
+  struct Table {
+    size_t bits;
+    std::unique_ptr<std::atomic<Node*>[]> buckets;
+
+    explicit Table(size_t b)
+        : bits(b), buckets(std::make_unique<std::atomic<Node*>[]>(1ULL << b)) {}
+
+    std::atomic<Node*>& Bucket(uint64_t hash) const noexcept {
+      return buckets[(hash * 0x9E3779B97F4A7C15ULL) >> (64 - bits)];
+    }
+  };
+
+  // the key capacity of nodes is rounded up to kKeyAlign bytes.
+  constexpr static size_t kKeyAlign = 16;
+  constexpr static size_t kSizeClasses = 256 / kKeyAlign + 1;
+  constexpr static size_t kChunkBytes = 64 << 10;
+
+  // the maximum steps of a lock-free lookup before it is considered as a
+  // conflict, it bounds the lookup on a chain under modification.
+  constexpr static size_t kMaxSteps = 1024;
+  constexpr static size_t kMaxRetries = 8;
+
+  struct alignas(64) Segment {
+    std::atomic<uint64_t> seq_{};
+    std::atomic<Table*> table_{};
+
+    alignas(64) std::mutex mu_;
+    size_t size_{};
+    std::vector<std::unique_ptr<Table>> tables_;
+    std::vector<Node*> free_[kSizeClasses];
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    size_t chunk_used_{kChunkBytes};
+
+    // the inline value capacity of nodes.
+    size_t value_words_{};
+
+    // for the fingerprint mode.
+    std::atomic<FingerprintTable*> slots_{};
+    std::unique_ptr<FingerprintTable> fingerprints_;
+    std::vector<std::unique_ptr<FingerprintTable>> retired_;
+    alignas(64) std::atomic<uint32_t> readers_{};
+
+    Segment() {
+      tables_.emplace_back(std::make_unique<Table>(4));
+      table_ = tables_.back().get();
+    }
+
+    template <class F>
+    void ForEachNode(F&& f) {
+      Table* table = table_;
+      for (size_t i = 0; i < (1ULL << table->bits); ++i) {
+        Node* node = table->buckets[i].load(std::memory_order_relaxed);
+        while (node != nullptr) {
+          Node* next = node->next.load(std::memory_order_relaxed);
+          f(node);
+          node = next;
+        }
+      }
+    }
+
+    void BeginWrite() noexcept {
+      seq_.store(seq_.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void EndWrite() noexcept {
+      seq_.store(seq_.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_release);
+    }
+
+    Node* Allocate(size_t key_size) {
+      size_t size_class = (key_size + kKeyAlign - 1) / kKeyAlign;
+      if (!free_[size_class].empty()) {
+        Node* node = free_[size_class].back();
+        free_[size_class].pop_back();
+        return node;
+      }
+
+      size_t bytes = sizeof(Node) + size_class * kKeyAlign +
+                     value_words_ * sizeof(uint64_t);
+      if (chunk_used_ + bytes > kChunkBytes) {
+        chunks_.emplace_back(std::make_unique<char[]>(kChunkBytes));
+        chunk_used_ = 0;
+      }
+
+      auto node = new (chunks_.back().get() + chunk_used_) Node();
+      node->size_class = size_class;
+      for (size_t i = 0; i < size_class * kKeyAlign / sizeof(uint64_t); ++i) {
+        new (node->key_words() + i) std::atomic<uint64_t>();
+      }
+      for (size_t i = 0; i < value_words_; ++i) {
+        new (node->value() + i) std::atomic<uint64_t>();
+      }
+      chunk_used_ += bytes;
+      return node;
+    }
+
+    Node* Find(uint64_t hash, std::string_view key) const noexcept {
+      Table* table = table_.load(std::memory_order_relaxed);
+      Node* node = table->Bucket(hash).load(std::memory_order_relaxed);
+      while (node != nullptr) {
+        if (node->hash.load(std::memory_order_relaxed) == hash &&
+            node->GetKey() == key) {
+          return node;
+        }
+        node = node->next.load(std::memory_order_relaxed);
+      }
+      return nullptr;
+    }
+
+    void Insert(uint64_t hash, std::string_view key, const record::Dir& dir,
+                std::optional<std::string_view> value) {
+      if (size_ >= (1ULL << table_.load()->bits)) {
+        Resize(table_.load()->bits + 1);
+      }
+
+      Node* node = Allocate(key.size());
+      node->StoreKey(key);
+      node->hash.store(hash, std::memory_order_relaxed);
+      node->Store(dir);
+      if (value.has_value()) {
+        node->StoreValue(*value);
+      } else {
+        node->value_size.store(kNoValue, std::memory_order_relaxed);
+      }
+
+      // publish the node, readers either see it or not.
+      auto& bucket = table_.load(std::memory_order_relaxed)->Bucket(hash);
+      node->next.store(bucket.load(std::memory_order_relaxed),
+                       std::memory_order_relaxed);
+      bucket.store(node, std::memory_order_release);
+      size_++;
+    }
+
+    void Update(Node* node, const record::Dir& dir,
+                std::optional<std::string_view> value) noexcept {
+      uint32_t version = node->version.load(std::memory_order_relaxed);
+      node->version.store(version + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      node->Store(dir);
+      if (value.has_value()) {
+        node->StoreValue(*value);
+      } else {
+        node->value_size.store(kNoValue, std::memory_order_relaxed);
+      }
+      node->version.store(version + 2, std::memory_order_release);
+    }
+
+    void Erase(uint64_t hash, Node* target) {
+      BeginWrite();
+      auto* prev = &table_.load(std::memory_order_relaxed)->Bucket(hash);
+      while (prev->load(std::memory_order_relaxed) != target) {
+        prev = &prev->load(std::memory_order_relaxed)->next;
+      }
+      prev->store(target->next.load(std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+      EndWrite();
+
+      free_[target->size_class].emplace_back(target);
+      size_--;
+    }
+
+    // grows the table to hold `n` nodes without resizing.
+    void Reserve(size_t n) {
+      size_t bits = table_.load(std::memory_order_relaxed)->bits;
+      size_t target = bits;
+      while ((1ULL << target) < n) {
+        target++;
+      }
+      if (target > bits) {
+        Resize(target);
+      }
+    }
+
+    void InitFingerprints() {
+      fingerprints_ = std::make_unique<FingerprintTable>(0);
+      slots_ = fingerprints_.get();
+    }
+
+    void ResizeFingerprints(size_t bits) {
+      auto table = std::make_unique<FingerprintTable>(bits);
+      fingerprints_->CopyTo(table.get());
+
+      BeginWrite();
+      slots_.store(table.get());
+      EndWrite();
+      retired_.emplace_back(std::move(fingerprints_));
+      fingerprints_ = std::move(table);
+    }
+
+    // the readers which see a retired table have entered before it is
+    // replaced.
+    void ReclaimFingerprints() {
+      if (!retired_.empty() && readers_.load() == 0) {
+        retired_.clear();
+      }
+    }
+
+    void InsertFingerprint(uint64_t fingerprint, const record::Dir& dir) {
+      if (fingerprints_->IsFull(size_ + 1)) {
+        ResizeFingerprints(fingerprints_->GetBits() + 1);
+      }
+      ReclaimFingerprints();
+
+      BeginWrite();
+      fingerprints_->Put(fingerprint, dir);
+      EndWrite();
+      size_++;
+    }
+
+    void UpdateFingerprint(size_t i, const record::Dir& dir) noexcept {
+      BeginWrite();
+      fingerprints_->Store(i, dir);
+      EndWrite();
+    }
+
+    void EraseFingerprint(size_t i) noexcept {
+      BeginWrite();
+      fingerprints_->Erase(i);
+      EndWrite();
+      size_--;
+    }
+
+    void Resize(size_t bits) {
+      Table* old_table = table_.load(std::memory_order_relaxed);
+      tables_.emplace_back(std::make_unique<Table>(bits));
+      Table* table = tables_.back().get();
+
+      BeginWrite();
+      for (size_t i = 0; i < (1ULL << old_table->bits); ++i) {
+        Node* node = old_table->buckets[i].load(std::memory_order_relaxed);
+        while (node != nullptr) {
+          Node* next = node->next.load(std::memory_order_relaxed);
+          auto& bucket = table->Bucket(node->hash.load());
+          node->next.store(bucket.load(std::memory_order_relaxed),
+                           std::memory_order_relaxed);
+          bucket.store(node, std::memory_order_relaxed);
+          node = next;
+        }
+      }
+      // the readers which load the new table see it built.
+      table_.store(table, std::memory_order_release);
+      EndWrite();
+    }
+  };
+
+  const size_t n_;
+  std::unique_ptr<Segment[]> segments_;
+  const KeyMatcher matcher_;
+  const KeyHasher hasher_;
+  const size_t inline_value_bytes_;
+
+  // at most kMaxCandidates dirs of a fingerprint are collected without lock.
+  constexpr static size_t kMaxCandidates = 4;
+
+  struct Candidates {
+    size_t n{};
+    record::Dir dirs[kMaxCandidates];
+  };
+
+  [[nodiscard]] uint64_t Hash64(std::string_view key) const {
+    return FingerprintTable::Fingerprint(
+        hasher_ != nullptr ? hasher_(key) : std::hash<std::string_view>()(key));
+  }
+
+  // the results of matching the candidates of a key. They never go stale,
+  // since a location holds only one key.
+  using Matches = std::vector<std::pair<record::Location, bool>>;
+
+  static const bool* FindMatch(const Matches& matches,
+                               const record::Location& loc) noexcept {
+    for (auto& [l, matched] : matches) {
+      if (l == loc) {
+        return &matched;
+      }
+    }
+    return nullptr;
+  }
+
+  // collects the candidates of a fingerprint which are not matched yet, the
+  // segment is locked by the caller.
+  static void CollectUnmatched(const Segment& segment, uint64_t fingerprint,
+                               const Matches& matches,
+                               std::vector<record::Dir>* unmatched) {
+    unmatched->clear();
+    auto* table = segment.fingerprints_.get();
+    table->Probe(fingerprint, [&](size_t i) {
+      record::Dir dir;
+      table->Load(i, &dir);
+      if (FindMatch(matches, dir.loc) == nullptr) {
+        unmatched->emplace_back(dir);
+      }
+      return false;
+    });
+  }
+
+  // matches the candidates of `key` by the records, without the lock.
+  void Match(std::string_view key, const std::vector<record::Dir>& dirs,
+             Matches* matches) const {
+    for (auto& dir : dirs) {
+      matches->emplace_back(dir.loc, matcher_(dir, key));
+    }
+  }
+
+  // SegmentDB distributes keys by the low bits of the hash, use the high bits
+  // here to keep the segments balanced.
+  [[nodiscard]] size_t Locate(uint64_t hash) const noexcept {
+    return (hash >> 32) % n_;
+  }
+
+  // a lock-free lookup, returns false if it conflicts with a writer. The
+  // inline value is copied if `value` is not null.
+  static bool TryGet(const Segment& segment, uint64_t hash,
+                     std::string_view key, bool* found, record::Dir* dir,
+                     std::string* value = nullptr,
+                     bool* inlined = nullptr) {
+    uint64_t seq = segment.seq_.load(std::memory_order_acquire);
+    if (seq & 1) {
+      return false;
+    }
+
+    Table* table = segment.table_.load(std::memory_order_acquire);
+    Node* node = table->Bucket(hash).load(std::memory_order_acquire);
+    for (size_t steps = 0; node != nullptr; ++steps) {
+      if (steps == kMaxSteps) {
+        return false;
+      }
+
+      if (node->hash.load(std::memory_order_relaxed) == hash &&
+          node->KeyEquals(key)) {
+        break;
+      }
+      node = node->next.load(std::memory_order_acquire);
+    }
+
+    *found = node != nullptr;
+    char buf[kMaxInlineValueBytes];
+    uint16_t size = kNoValue;
+    if (node != nullptr) {
+      uint32_t version = node->version.load(std::memory_order_acquire);
+      if (version & 1) {
+        return false;
+      }
+
+      node->Load(dir);
+      if (value != nullptr) {
+        size = node->LoadValue(buf);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (node->version.load(std::memory_order_relaxed) != version) {
+        return false;
+      }
+    } else {
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
+
+    if (segment.seq_.load(std::memory_order_relaxed) != seq) {
+      return false;
+    }
+    if (value != nullptr) {
+      *inlined = size != kNoValue;
+      if (*inlined) {
+        value->assign(buf, size);
+      }
+    }
+    return true;
+  }
+
+  // collects the dirs of a fingerprint without lock, returns false if it
+  // conflicts with a writer.
+  static bool TryGetCandidates(const Segment& segment, uint64_t fingerprint,
+                               Candidates* candidates) noexcept {
+    uint64_t seq = segment.seq_.load(std::memory_order_acquire);
+    if (seq & 1) {
+      return false;
+    }
+
+    FingerprintTable* table = segment.slots_.load();
+    candidates->n = 0;
+    bool overflow = false;
+    bool done = table->Probe(
+        fingerprint,
+        [&](size_t i) {
+          if (candidates->n == kMaxCandidates) {
+            overflow = true;
+            return true;
+          }
+          table->Load(i, &candidates->dirs[candidates->n++]);
+          return false;
+        },
+        kMaxSteps);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return done && !overflow &&
+           segment.seq_.load(std::memory_order_relaxed) == seq;
+  }
+
+  // visits the dirs of a fingerprint, the writers are waited if there are
+  // too many conflicts.
+  template <class F>
+  static void ForEachCandidate(Segment& segment, uint64_t fingerprint, F&& f) {
+    segment.readers_.fetch_add(1);
+
+    Candidates candidates;
+    for (size_t i = 0; i < kMaxRetries; ++i) {
+      if (TryGetCandidates(segment, fingerprint, &candidates)) {
+        segment.readers_.fetch_sub(1);
+        for (size_t k = 0; k < candidates.n; ++k) {
+          if (f(candidates.dirs[k])) {
+            return;
+          }
+        }
+        return;
+      }
+      std::this_thread::yield();
+    }
+    segment.readers_.fetch_sub(1);
+
+    std::vector<record::Dir> dirs;
+    {
+      std::unique_lock lock{segment.mu_};
+      auto* table = segment.fingerprints_.get();
+      table->Probe(fingerprint, [&](size_t i) {
+        table->Load(i, &dirs.emplace_back());
+        return false;
+      });
+    }
+
+    for (auto& dir : dirs) {
+      if (f(dir)) {
+        return;
+      }
+    }
+  }
+
+  // `match` tells whether a candidate has the key without reading it.
+  template <class F, class M>
+  auto ComputeFingerprint(Segment& segment, uint64_t fingerprint, F& f,
+                          M&& match) {
+    auto* table = segment.fingerprints_.get();
+    std::optional<size_t> slot;
+    std::optional<record::Dir> dir;
+    table->Probe(fingerprint, [&](size_t i) {
+      record::Dir candidate;
+      table->Load(i, &candidate);
+      if (!match(candidate)) {
+        return false;
+      }
+      slot = i;
+      dir = candidate;
+      return true;
+    });
+
+    auto store = [&] {
+      if (dir.has_value()) {
+        if (slot.has_value()) {
+          segment.UpdateFingerprint(*slot, *dir);
+        } else {
+          segment.InsertFingerprint(fingerprint, *dir);
+        }
+      } else if (slot.has_value()) {
+        segment.EraseFingerprint(*slot);
+      }
+    };
+
+    using Result = std::invoke_result_t<F&, std::optional<record::Dir>&>;
+    if constexpr (std::is_void_v<Result>) {
+      f(dir);
+      store();
+    } else {
+      Result result = f(dir);
+      store();
+      return result;
+    }
+  }
+
+  template <class F>
+  auto Compute(Segment& segment, uint64_t hash, std::string_view key, F& f,
+               const InlineValue* value) {
+    Node* node = segment.Find(hash, key);
+
+    std::optional<record::Dir> dir;
+    record::Dir old;
+    if (node != nullptr) {
+      node->Load(&old);
+      dir = old;
+    }
+
+    auto store = [&] {
+      if (!dir.has_value()) {
+        if (node != nullptr) {
+          segment.Erase(hash, node);
+        }
+        return;
+      }
+
+      std::optional<std::string_view> kept;
+      if (value != nullptr && value->loc == dir->loc &&
+          value->value.size() <= inline_value_bytes_) {
+        kept = value->value;
+      }
+
+      if (node == nullptr) {
+        segment.Insert(hash, key, *dir, kept);
+        return;
+      }
+
+      // the same dir holds the same value.
+      if (!kept.has_value() && old.loc == dir->loc &&
+          old.entry_size == dir->entry_size) {
+        return;
+      }
+      segment.Update(node, *dir, kept);
+    };
+
+    using Result = std::invoke_result_t<F&, std::optional<record::Dir>&>;
+    if constexpr (std::is_void_v<Result>) {
+      f(dir);
+      store();
+    } else {
+      Result result = f(dir);
+      store();
+      return result;
+    }
+  }
+
+ public:
+  // the fingerprint mode is used if `matcher` is not null. The values up to
+  // `inline_value_bytes` can be kept in the nodes, which is not supported by
+  // the fingerprint mode.
+  explicit SegmentIndex(size_t segments, KeyMatcher matcher = nullptr,
+                        size_t inline_value_bytes = 0,
+                        KeyHasher hasher = nullptr)
+      : n_(std::max<size_t>(segments, 1)),
+        segments_(std::make_unique<Segment[]>(n_)),
+        matcher_(std::move(matcher)),
+        hasher_(std::move(hasher)),
+        inline_value_bytes_(matcher_ != nullptr
+                                ? 0
+                                : std::min(inline_value_bytes,
+                                           kMaxInlineValueBytes)) {
+    for (size_t i = 0; i < n_; ++i) {
+      if (matcher_ != nullptr) {
+        segments_[i].InitFingerprints();
+      }
+      segments_[i].value_words_ =
+          (inline_value_bytes_ + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    }
+  }
+
+  ~SegmentIndex() = default;
+
+  [[nodiscard]] bool IsFingerprint() const noexcept {
+    return matcher_ != nullptr;
+  }
+
+  [[nodiscard]] size_t GetInlineValueBytes() const noexcept {
+    return inline_value_bytes_;
+  }
+
+  bool Get(std::string_view key, record::Dir* dir) const {
+    bool inlined = false;
+    return Get(key, dir, nullptr, &inlined);
+  }
+
+  // also gets the inline value of the key, `inlined` tells whether there is
+  // one.
+  bool Get(std::string_view key, record::Dir* dir, std::string* value,
+           bool* inlined) const {
+    *inlined = false;
+    uint64_t hash = Hash64(key);
+    auto& segment = segments_[Locate(hash)];
+
+    if (matcher_ != nullptr) {
+      bool found = false;
+      ForEachCandidate(segment, hash, [&](const record::Dir& candidate) {
+        found = matcher_(candidate, key);
+        if (found) {
+          *dir = candidate;
+        }
+        return found;
+      });
+      return found;
+    }
+
+    bool found = false;
+    for (size_t i = 0; i < kMaxRetries; ++i) {
+      if (TryGet(segment, hash, key, &found, dir, value, inlined)) {
+        return found;
+      }
+      std::this_thread::yield();
+    }
+
+    // too many conflicts, wait for the writers.
+    std::unique_lock lock{segment.mu_};
+    Node* node = segment.Find(hash, key);
+    if (node == nullptr) {
+      return false;
+    }
+    node->Load(dir);
+    if (value != nullptr) {
+      char buf[kMaxInlineValueBytes];
+      uint16_t size = node->LoadValue(buf);
+      *inlined = size != kNoValue;
+      if (*inlined) {
+        value->assign(buf, size);
+      }
+    }
+    return true;
+  }
+
+  // Checks whether the latest versions of several keys are at `locs`. The
+  // bucket heads are prefetched before the lookups, and no record is read
+  // even in the fingerprint mode, since a location holds only one key.
+  void Contains(const std::vector<std::string_view>& keys,
+                const std::vector<record::Location>& locs,
+                std::vector<bool>* latest) const {
+    std::vector<uint64_t> hashes;
+    hashes.reserve(keys.size());
+    for (auto key : keys) {
+      hashes.emplace_back(Hash64(key));
+      auto& segment = segments_[Locate(hashes.back())];
+      if (matcher_ == nullptr) {
+        Table* table = segment.table_.load(std::memory_order_acquire);
+        __builtin_prefetch(&table->Bucket(hashes.back()));
+      }
+    }
+
+    latest->assign(keys.size(), false);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      auto& segment = segments_[Locate(hashes[i])];
+      if (matcher_ != nullptr) {
+        ForEachCandidate(segment, hashes[i], [&](const record::Dir& dir) {
+          return (*latest)[i] = dir.loc == locs[i];
+        });
+        continue;
+      }
+
+      record::Dir dir;
+      bool found = false;
+      if (!TryGet(segment, hashes[i], keys[i], &found, &dir)) {
+        found = Get(keys[i], &dir);
+      }
+      (*latest)[i] = found && dir.loc == locs[i];
+    }
+  }
+
+  // Atomically updates the dir of `key`. `f` gets the current dir, which is
+  // std::nullopt if the key does not exist, and may modify or reset it. The
+  // inline value is replaced by `value` if any, or dropped if the dir
+  // changes.
+  template <class F>
+  auto Compute(std::string_view key, F&& f,
+               const InlineValue* value = nullptr) {
+    uint64_t hash = Hash64(key);
+    auto& segment = segments_[Locate(hash)];
+    std::unique_lock lock{segment.mu_};
+    if (matcher_ == nullptr) {
+      return Compute(segment, hash, key, f, value);
+    }
+
+    // the candidates are matched without the lock, until none is new.
+    Matches matches;
+    std::vector<record::Dir> unmatched;
+    for (;;) {
+      CollectUnmatched(segment, hash, matches, &unmatched);
+      if (unmatched.empty()) {
+        break;
+      }
+      lock.unlock();
+      Match(key, unmatched, &matches);
+      lock.lock();
+    }
+    return ComputeFingerprint(segment, hash, f, [&](const record::Dir& dir) {
+      return *FindMatch(matches, dir.loc);
+    });
+  }
+
+  // Atomically updates the dirs of several keys, in order. `f` is called as
+  // f(i, dir) for keys[i], and (*values)[i] is the inline value of keys[i].
+  // Each involved segment is locked only once.
+  template <class F>
+  void Compute(const std::vector<std::string_view>& keys, F&& f,
+               const std::vector<std::optional<InlineValue>>* values =
+                   nullptr) {
+    std::vector<uint64_t> hashes;
+    std::vector<size_t> locked;
+    hashes.reserve(keys.size());
+    locked.reserve(keys.size());
+    for (auto key : keys) {
+      hashes.emplace_back(Hash64(key));
+      locked.emplace_back(Locate(hashes.back()));
+    }
+    std::sort(locked.begin(), locked.end());
+    locked.erase(std::unique(locked.begin(), locked.end()), locked.end());
+
+    // lock in order to avoid dead lock.
+    auto lock = [&] {
+      for (auto i : locked) {
+        segments_[i].mu_.lock();
+      }
+    };
+    auto unlock = [&] {
+      for (auto i : locked) {
+        segments_[i].mu_.unlock();
+      }
+    };
+    lock();
+
+    if (matcher_ == nullptr) {
+      for (size_t i = 0; i < keys.size(); ++i) {
+        auto g = [&f, i](std::optional<record::Dir>& dir) { f(i, dir); };
+        const InlineValue* value = nullptr;
+        if (values != nullptr && (*values)[i].has_value()) {
+          value = &*(*values)[i];
+        }
+        Compute(segments_[Locate(hashes[i])], hashes[i], keys[i], g, value);
+      }
+      unlock();
+      return;
+    }
+
+    // the candidates of all keys are matched without the locks, until none
+    // is new. The dirs added by the batch belong to its keys.
+    std::vector<Matches> matches(keys.size());
+    std::vector<std::vector<record::Dir>> unmatched(keys.size());
+    for (;;) {
+      bool done = true;
+      for (size_t i = 0; i < keys.size(); ++i) {
+        CollectUnmatched(segments_[Locate(hashes[i])], hashes[i], matches[i],
+                         &unmatched[i]);
+        done = done && unmatched[i].empty();
+      }
+      if (done) {
+        break;
+      }
+      unlock();
+      for (size_t i = 0; i < keys.size(); ++i) {
+        Match(keys[i], unmatched[i], &matches[i]);
+      }
+      lock();
+    }
+
+    std::vector<std::pair<record::Location, size_t>> added;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      auto g = [&f, &added, i](std::optional<record::Dir>& dir) {
+        f(i, dir);
+        if (dir.has_value()) {
+          added.emplace_back(dir->loc, i);
+        }
+      };
+      auto match = [&, i](const record::Dir& dir) {
+        if (auto matched = FindMatch(matches[i], dir.loc)) {
+          return *matched;
+        }
+        for (auto& [loc, k] : added) {
+          if (loc == dir.loc) {
+            return keys[k] == keys[i];
+          }
+        }
+        return false;
+      };
+      ComputeFingerprint(segments_[Locate(hashes[i])], hashes[i], g, match);
+    }
+    unlock();
+  }
+
+  // Inserts an entry whose key is known to be absent, such as an entry of a
+  // checkpoint. It is for the fingerprint mode only.
+  void Insert(uint64_t fingerprint, const record::Dir& dir) {
+    auto& segment = segments_[Locate(fingerprint)];
+    std::unique_lock lock{segment.mu_};
+    segment.InsertFingerprint(fingerprint, dir);
+  }
+
+  [[nodiscard]] size_t GetSegments() const noexcept { return n_; }
+
+  // Visits every (key, dir), each segment is visited under its lock. The
+  // key is empty in the fingerprint mode, see ForEachFingerprint().
+  template <class F>
+  void ForEach(F&& f) const {
+    for (size_t i = 0; i < n_; ++i) {
+      ForEach(i, f);
+    }
+  }
+
+  // Visits every (key, dir) of a segment under its lock.
+  template <class F>
+  void ForEach(size_t segment, F&& f) const {
+    if (matcher_ != nullptr) {
+      ForEachFingerprint(segment, [&](uint64_t, const record::Dir& dir) {
+        f(std::string_view{}, dir);
+      });
+      return;
+    }
+
+    std::unique_lock lock{segments_[segment].mu_};
+    segments_[segment].ForEachNode([&](Node* node) {
+      record::Dir dir;
+      node->Load(&dir);
+      f(node->GetKey(), dir);
+    });
+  }
+
+  // Visits every (fingerprint, dir) in the fingerprint mode.
+  template <class F>
+  void ForEachFingerprint(F&& f) const {
+    for (size_t i = 0; i < n_; ++i) {
+      ForEachFingerprint(i, f);
+    }
+  }
+
+  // Visits every (fingerprint, dir) of a segment under its lock.
+  template <class F>
+  void ForEachFingerprint(size_t segment, F&& f) const {
+    std::unique_lock lock{segments_[segment].mu_};
+    segments_[segment].fingerprints_->ForEach(f);
+  }
+
+  // presizes the segments for `n` keys in total.
+  void Reserve(size_t n) {
+    for (size_t i = 0; i < n_; ++i) {
+      std::unique_lock lock{segments_[i].mu_};
+      auto& segment = segments_[i];
+      if (matcher_ == nullptr) {
+        segment.Reserve(n / n_ + 1);
+        continue;
+      }
+
+      size_t bits = FingerprintTable::BitsFor(n / n_ + 1);
+      if (bits > segment.fingerprints_->GetBits()) {
+        segment.ResizeFingerprints(bits);
+        segment.ReclaimFingerprints();
+      }
+    }
+  }
+
+  [[nodiscard]] size_t Size() const {
+    size_t size = 0;
+    for (size_t i = 0; i < n_; ++i) {
+      std::unique_lock lock{segments_[i].mu_};
+      size += segments_[i].size_;
+    }
+    return size;
+  }
+};
+}  // namespace pedrodb
+
+#endif  // PEDRODB_INDEX_SEGMENT_INDEX_H
@@ -1,30 +1,96 @@
 #ifndef PEDRODB_ITERATOR_INDEX_ITERATOR_H
 #define PEDRODB_ITERATOR_INDEX_ITERATOR_H
 #include "pedrodb/defines.h"
+#include "pedrodb/file/readable_file.h"
 #include "pedrodb/format/index_format.h"
 #include "pedrodb/iterator/iterator.h"
 
-#include <variant>
-
 namespace pedrodb {
 
+// IndexIterator decodes the index of both versions in place, the memory is
+// usually mapped from the index file.
 class IndexIterator : public Iterator<index::EntryView> {
-  ArrayBuffer buffer_;
-  ReadableFile::Ptr file_{};
+  std::shared_ptr<void> holder_;
+  ReadableView view_;
   index::EntryView entry_;
 
+  bool v2_{};
+  bool corrupted_{};
+  index::HeaderV2 header_;
+  std::string key_;
+
  public:
-  explicit IndexIterator(ReadableFile::Ptr file) : file_(file) {
-    buffer_.EnsureWritable(file->Size());
-    file->Read(0, buffer_.WriteIndex(), buffer_.WritableBytes());
-    buffer_.Append(buffer_.WritableBytes());
+  // `holder` keeps the memory alive.
+  IndexIterator(const char* data, size_t size,
+                std::shared_ptr<void> holder = nullptr)
+      : holder_(std::move(holder)), view_(data, size) {
+    if (!index::HeaderV2::Match(data, size)) {
+      return;
+    }
+
+    v2_ = true;
+    size_t min_size = index::HeaderV2::SizeOf() + sizeof(uint32_t);
+    uint32_t checksum = 0;
+    if (size >= min_size) {
+      memcpy(&checksum, data + size - sizeof(checksum), sizeof(checksum));
+    }
+
+    if (size < min_size ||
+        checksum != Hash({data, size - sizeof(checksum)})) {
+      corrupted_ = true;
+      view_ = ReadableView(data, 0);
+      return;
+    }
+
+    const char* p = data + sizeof(index::HeaderV2::kMagic);
+    memcpy(&header_.count, p, sizeof(header_.count));
+    memcpy(&header_.key_bytes, p + 8, sizeof(header_.key_bytes));
+    view_ = ReadableView(data + index::HeaderV2::SizeOf(),
+                         size - min_size);
+  }
+
+  // the index file is torn or damaged, it should be rebuilt from data.
+  [[nodiscard]] bool Corrupted() const noexcept { return corrupted_; }
+
+  // the number of entries, 0 means unknown.
+  [[nodiscard]] uint64_t GetCount() const noexcept { return header_.count; }
+
+  [[nodiscard]] uint64_t GetKeyBytes() const noexcept {
+    return header_.key_bytes;
   }
 
-  bool Valid() override { return entry_.UnPack(&buffer_); }
+  bool Valid() override {
+    if (!v2_) {
+      return entry_.UnPack(&view_);
+    }
+
+    if (view_.ReadableBytes() < index::EntryV2::SizeOf()) {
+      return false;
+    }
+
+    index::EntryV2 entry;
+    entry.UnPack(view_.ReadIndex());
+    if (entry.shared > key_.size() ||
+        view_.ReadableBytes() < index::EntryV2::SizeOf() + entry.suffix) {
+      corrupted_ = true;
+      return false;
+    }
+    view_.Retrieve(index::EntryV2::SizeOf());
+
+    key_.resize(entry.shared);
+    key_.append(view_.ReadIndex(), entry.suffix);
+    view_.Retrieve(entry.suffix);
+
+    entry_.key = key_;
+    entry_.type = static_cast<record::Type>(entry.type);
+    entry_.offset = entry.offset;
+    entry_.len = entry.len;
+    return true;
+  }
 
   index::EntryView Next() noexcept override { return entry_; }
 
-  void Close() override {}
+  void Close() override { holder_ = nullptr; }
 };
 
 }  // namespace pedrodb
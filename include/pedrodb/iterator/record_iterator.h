@@ -25,7 +25,7 @@ class RecordIterator : public Iterator<record::EntryView> {
 
   void fetch(size_t fetch) {
     auto& buffer = GetBuffer();
-    if (read_index_ + fetch >= size_) {
+    if (read_index_ + fetch > size_) {
       return;
     }
 
@@ -0,0 +1,115 @@
+#ifndef PEDRODB_ITERATOR_SEQUENTIAL_ITERATOR_H
+#define PEDRODB_ITERATOR_SEQUENTIAL_ITERATOR_H
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "pedrodb/file/readable_file.h"
+#include "pedrodb/format/record_format.h"
+#include "pedrodb/iterator/iterator.h"
+#include "pedrodb/logger/logger.h"
+
+namespace pedrodb {
+
+// SequentialIterator scans the records of a file by large chunks, and parses
+// them in place. The next chunk is prefetched while the current one is parsed.
+// It is used by recovery, compaction and iteration, RecordIterator is better
+// for a single record.
+class SequentialIterator : public Iterator<record::EntryView> {
+ public:
+  constexpr static size_t kChunkSize = 1 << 20;
+
+ private:
+  ReadableFile::Ptr file_;
+  const size_t size_{};
+
+  // holds the bytes of [buffer_offset_, buffer_offset_ + buffer_size_).
+  std::vector<char> buffer_;
+  size_t buffer_offset_{};
+  size_t buffer_size_{};
+
+  size_t index_{};
+  record::EntryView entry_;
+
+  // makes the bytes of [offset, offset + n) readable in the buffer.
+  bool Load(size_t offset, size_t n) {
+    if (offset >= buffer_offset_ &&
+        offset + n <= buffer_offset_ + buffer_size_) {
+      return true;
+    }
+
+    if (offset + n > size_) {
+      return false;
+    }
+
+    // keep the loaded bytes after offset, only read the rest.
+    size_t keep = 0;
+    if (offset >= buffer_offset_ && offset < buffer_offset_ + buffer_size_) {
+      keep = buffer_offset_ + buffer_size_ - offset;
+      memmove(buffer_.data(), buffer_.data() + (offset - buffer_offset_), keep);
+    }
+
+    if (buffer_.size() < std::max(n, kChunkSize)) {
+      buffer_.resize(std::max(n, kChunkSize));
+    }
+
+    size_t length = std::min(buffer_.size(), size_ - offset) - keep;
+    ssize_t r = file_->Read(offset + keep, buffer_.data() + keep, length);
+    buffer_offset_ = offset;
+    buffer_size_ = keep + (r > 0 ? r : 0);
+    if (r < 0) {
+      PEDRODB_ERROR("failed to read file: {}", file_->GetError());
+      return false;
+    }
+
+    file_->Prefetch(buffer_offset_ + buffer_size_, kChunkSize);
+    return n <= buffer_size_;
+  }
+
+ public:
+  explicit SequentialIterator(ReadableFile::Ptr file)
+      : file_(std::move(file)), size_(file_->Size()) {}
+
+  bool Valid() noexcept override {
+    if (!Load(index_, record::Header::SizeOf())) {
+      return false;
+    }
+
+    ReadableView view(buffer_.data() + (index_ - buffer_offset_),
+                      record::Header::SizeOf());
+    record::Header header;
+    if (!header.UnPack(&view)) {
+      return false;
+    }
+
+    size_t n = record::Header::SizeOf() + header.key_size + header.value_size;
+    if (!Load(index_, n)) {
+      PEDRODB_ERROR("file corrupt");
+      return false;
+    }
+
+    view = ReadableView(buffer_.data() + (index_ - buffer_offset_), n);
+    return entry_.UnPack(&view);
+  }
+
+  // the loaded chunk is kept, seeking forward nearby is cheap.
+  void Seek(uint32_t offset) noexcept { index_ = offset; }
+
+  [[nodiscard]] uint32_t GetOffset() const noexcept { return index_; }
+
+  record::EntryView Peek() noexcept { return entry_; }
+
+  record::EntryView Next() noexcept override {
+    index_ += entry_.SizeOf();
+    return entry_;
+  }
+
+  void Close() override {
+    buffer_.clear();
+    buffer_.shrink_to_fit();
+    buffer_size_ = 0;
+  }
+};
+}  // namespace pedrodb
+
+#endif  // PEDRODB_ITERATOR_SEQUENTIAL_ITERATOR_H
@@ -5,8 +5,8 @@
 #include "pedrodb/status.h"
 
 #include <pedrolib/buffer/array_buffer.h>
+#include <map>
 #include <mutex>
-#include <set>
 
 namespace pedrodb {
 
@@ -14,13 +14,19 @@ class MetadataManager : public std::enable_shared_from_this<MetadataManager> {
   mutable std::mutex mu_;
 
   std::string name_;
-  std::set<file_id_t> files_;
+
+  // the files and their ranks. The files are recovered in the order of
+  // rank, a compaction output inherits the highest rank of its victims.
+  std::map<file_id_t, file_id_t> files_;
+  file_id_t max_file_{};
 
   File file_;
   const std::string path_;
 
   Status Recovery();
 
+  Status Truncate(size_t offset);
+
   Status CreateDatabase();
 
   auto AcquireLock() const noexcept { return std::unique_lock{mu_}; }
@@ -33,18 +39,34 @@ class MetadataManager : public std::enable_shared_from_this<MetadataManager> {
 
   Status Init();
 
-  std::vector<file_id_t> GetFiles() const noexcept {
+  // returns the files in the order of recovery, the last one is active.
+  std::vector<file_id_t> GetFiles() const noexcept;
+
+  file_id_t GetRank(file_id_t id) const noexcept;
+
+  bool Exists(file_id_t id) const noexcept {
     auto lock = AcquireLock();
-    return {files_.begin(), files_.end()};
+    return files_.count(id);
+  }
+
+  // allocates an id greater than all the files ever created.
+  file_id_t NewFileId() noexcept {
+    auto lock = AcquireLock();
+    return ++max_file_;
   }
 
   Status CreateFile(file_id_t id);
 
+  Status CompactFiles(const std::vector<file_id_t>& outputs, file_id_t rank,
+                      const std::vector<file_id_t>& victims);
+
   Status DeleteFile(file_id_t id);
 
   std::string GetDataFilePath(file_id_t id) const noexcept;
 
   std::string GetIndexFilePath(file_id_t id) const noexcept;
+
+  std::string GetCheckpointFilePath() const noexcept;
 };
 
 }  // namespace pedrodb
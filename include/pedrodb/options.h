@@ -4,12 +4,40 @@
 #include <pedrolib/executor/thread_pool_executor.h>
 #include <string>
 #include "pedrodb/defines.h"
+#include "pedrodb/rate_limiter.h"
+#include "pedrodb/statistics.h"
 
 namespace pedrodb {
 
+// the replacement policy of caches. CLOCK saves the list updates of hits,
+// S3-FIFO keeps the working set through scans.
+enum class CachePolicy {
+  kLRU,
+  kClock,
+  kS3FIFO,
+};
+
 struct ReadCacheOptions {
   bool enable{true};
   size_t read_cache_bytes{32 << 20};
+  CachePolicy policy{CachePolicy::kLRU};
+
+  // the size of cached blocks, rounded up to a power of two in [512B, 1MiB].
+  // Larger blocks take fewer reads for large records but waste more memory
+  // for small ones.
+  size_t block_size{4096};
+
+  // the records larger than `bypass_bytes` are read without the cache, so
+  // they never evict the small ones. 0 means disabled.
+  size_t bypass_bytes{0};
+
+  // backs the blocks of the read cache by huge pages, falls back to
+  // transparent huge pages if none is reserved.
+  bool huge_pages{false};
+
+  // the uncompressed values are also cached by keys, so the hot keys skip
+  // the blocks, the checksum and the decompression. 0 means disabled.
+  size_t row_cache_bytes{0};
   size_t segments{std::thread::hardware_concurrency()};
 };
 
@@ -19,15 +47,65 @@ struct Options {
   struct {
     size_t threshold_bytes{static_cast<size_t>(kMaxFileBytes * 0.75)};
     Duration interval{Duration::Seconds(5)};
+
+    // the bytes compacted between two requests to the rate limiter.
+    size_t batch_bytes{4 << 20};
+
+    // the files with the best cost-benefit are compacted until the bytes of
+    // data files are within `max_space_amplification` times of the live
+    // bytes, such as 1.5. 0 means disabled, only the threshold is used.
+    double max_space_amplification{0};
+
+    // the maximum number of files merged by one compaction.
+    size_t max_merge_files{4};
   } compaction{};
 
   bool compress_value{true};
   Duration sync_interval{Duration::Seconds(10)};
+
+  // start writing back the active file every `bytes_per_sync` bytes
+  // appended, which smooths out the periodic sync. 0 means disabled.
+  size_t bytes_per_sync{0};
   int32_t sync_max_io_error{32};
 
   ReadCacheOptions read_cache{};
 
+  // the memory index is saved at clean shutdown and every `interval`, so
+  // recovery only replays the files written after the checkpoint. Disabled
+  // by default.
+  struct {
+    bool enable{false};
+    Duration interval{Duration::Seconds(60)};
+  } checkpoint{};
+
+  // the memory index is partitioned into segments to reduce lock contention.
+  size_t index_segments{std::thread::hardware_concurrency()};
+
+  // the memory index keeps the 64-bit hashes of keys instead of the keys, a
+  // matching hash is confirmed by reading the key of the record. It takes
+  // much less memory for small records, but an overwrite reads the disk.
+  bool fingerprint_index{false};
+
+  // the values up to `inline_value_bytes` (at most 64) are also kept in the
+  // memory index, so reading them never touches the files. It costs the
+  // bytes for every key, 0 means disabled. Not supported by the fingerprint
+  // index.
+  size_t inline_value_bytes{0};
+
   std::shared_ptr<Executor> executor{std::make_shared<DefaultExecutor>(1)};
+
+  // throttles the background io, such as sync, index files and compaction.
+  // it can be shared by databases, null means unlimited.
+  std::shared_ptr<RateLimiter> rate_limiter{};
+
+  // collects the counters and latencies, see DB::GetProperty(). It can be
+  // shared by databases, null means disabled.
+  std::shared_ptr<Statistics> statistics{};
+
+  // runs the async APIs, an executor shared by all databases is used if it
+  // is null. The pending calls keep the database alive, so it may be closed
+  // on this executor, which must not be its last owner.
+  std::shared_ptr<Executor> io_executor{};
 };
 
 struct ReadOptions {
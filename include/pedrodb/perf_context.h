@@ -0,0 +1,105 @@
+#ifndef PEDRODB_PERF_CONTEXT_H
+#define PEDRODB_PERF_CONTEXT_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "pedrodb/defines.h"
+
+namespace pedrodb {
+
+enum class PerfLevel {
+  kDisable,
+  kEnableCount,
+
+  // also measures the time of stages, it costs two clock reads per stage.
+  kEnableTime,
+};
+
+// PerfContext breaks down the requests of the calling thread by stages. It
+// is thread local and disabled by default, enable it by SetPerfLevel(), and
+// Reset() it before the request to be inspected.
+struct PerfContext {
+  // get.
+  uint64_t index_lookup_count{};
+  uint64_t index_lookup_nanos{};
+  uint64_t acquire_file_count{};
+  uint64_t acquire_file_nanos{};
+  uint64_t file_open_count{};
+  uint64_t block_cache_hit_count{};
+  uint64_t block_cache_miss_count{};
+  uint64_t block_cache_wait_count{};
+  uint64_t block_read_count{};
+  uint64_t block_read_bytes{};
+  uint64_t block_read_nanos{};
+  uint64_t validate_nanos{};
+  uint64_t uncompress_nanos{};
+
+  // put.
+  uint64_t compress_nanos{};
+  uint64_t append_lock_nanos{};
+  uint64_t append_copy_nanos{};
+  uint64_t append_bytes{};
+  uint64_t index_update_count{};
+  uint64_t index_update_nanos{};
+
+  void Reset() noexcept { *this = PerfContext{}; }
+
+  // the non-zero fields, such as "index_lookup_count = 1, ...".
+  [[nodiscard]] std::string ToString() const;
+};
+
+namespace detail {
+inline thread_local PerfLevel perf_level = PerfLevel::kDisable;
+inline thread_local PerfContext perf_context;
+}  // namespace detail
+
+inline PerfLevel GetPerfLevel() noexcept { return detail::perf_level; }
+
+inline void SetPerfLevel(PerfLevel level) noexcept {
+  detail::perf_level = level;
+}
+
+inline PerfContext* GetPerfContext() noexcept {
+  return &detail::perf_context;
+}
+
+inline void PerfCount(uint64_t PerfContext::*counter, uint64_t n = 1) noexcept {
+  if (detail::perf_level >= PerfLevel::kEnableCount) {
+    detail::perf_context.*counter += n;
+  }
+}
+
+// adds the time from construction to Stop() or destruction to a field.
+class PerfTimer : noncopyable, nonmovable {
+  using Clock = std::chrono::steady_clock;
+
+  uint64_t PerfContext::*metric_;
+  Clock::time_point start_;
+  bool enabled_;
+
+ public:
+  explicit PerfTimer(uint64_t PerfContext::*metric) noexcept
+      : metric_(metric),
+        enabled_(detail::perf_level >= PerfLevel::kEnableTime) {
+    if (enabled_) {
+      start_ = Clock::now();
+    }
+  }
+
+  void Stop() noexcept {
+    if (enabled_) {
+      enabled_ = false;
+      detail::perf_context.*metric_ +=
+          std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                               start_)
+              .count();
+    }
+  }
+
+  ~PerfTimer() { Stop(); }
+};
+}  // namespace pedrodb
+
+#endif  // PEDRODB_PERF_CONTEXT_H
@@ -0,0 +1,93 @@
+#ifndef PEDRODB_RATE_LIMITER_H
+#define PEDRODB_RATE_LIMITER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "pedrodb/defines.h"
+
+namespace pedrodb {
+
+enum class IOPriority {
+  kForeground,
+  kFlush,
+  kCompaction,
+};
+
+// RateLimiter shares a bytes-per-second budget among the io of databases.
+// Foreground io never waits but consumes the budget, the background requests
+// wait for it in the order of priority, flush before compaction.
+//
+// If `auto_tune` is enabled, compaction backs off when the latency of
+// foreground requests rises above the baseline observed so far.
+class RateLimiter : noncopyable, nonmovable {
+ public:
+  using Ptr = std::shared_ptr<RateLimiter>;
+  using Clock = std::chrono::steady_clock;
+
+  explicit RateLimiter(size_t bytes_per_second, bool auto_tune = false);
+
+  // blocks until `bytes` are granted.
+  void Request(size_t bytes, IOPriority priority);
+
+  // reports the latency of a foreground request.
+  void RecordLatency(Clock::duration latency) noexcept {
+    latency_sum_.fetch_add(latency.count(), std::memory_order_relaxed);
+    latency_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] bool IsAutoTuned() const noexcept { return auto_tune_; }
+
+  [[nodiscard]] size_t GetBytesPerSecond() const noexcept {
+    return bytes_per_second_;
+  }
+
+  // the share of the budget which compaction can use, in (0, 1].
+  [[nodiscard]] double GetCompactionRatio() const noexcept;
+
+ private:
+  struct Waiter {
+    int64_t bytes;
+    bool granted;
+  };
+
+  // the budget is refilled continuously, at most `burst_` bytes are saved.
+  constexpr static auto kBurstPeriod = std::chrono::milliseconds(100);
+
+  // the period to adjust the compaction ratio.
+  constexpr static auto kTunePeriod = std::chrono::milliseconds(100);
+  constexpr static double kMinCompactionRatio = 1.0 / 16;
+
+  void Refill(Clock::time_point now);
+
+  void Tune(Clock::time_point now);
+
+  void Grant();
+
+  const size_t bytes_per_second_;
+  const int64_t burst_;
+  const bool auto_tune_;
+
+  mutable std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<Waiter*> flush_queue_;
+  std::deque<Waiter*> compaction_queue_;
+  int64_t available_{};
+  Clock::time_point refilled_at_;
+
+  // consumed by foreground io, it is taken from the budget on refilling.
+  std::atomic<int64_t> foreground_bytes_{};
+
+  std::atomic<int64_t> latency_sum_{};
+  std::atomic<int64_t> latency_count_{};
+  Clock::time_point tuned_at_;
+  double baseline_latency_{};
+  double compaction_ratio_{1.0};
+};
+}  // namespace pedrodb
+
+#endif  // PEDRODB_RATE_LIMITER_H
@@ -22,16 +22,34 @@ class SegmentDB : public DB {
   Status Get(const ReadOptions& options, std::string_view key,
              std::string* value) override;
 
+  Status MultiGet(const ReadOptions& options,
+                  const std::vector<std::string_view>& keys,
+                  std::vector<std::string>* values,
+                  std::vector<Status>* status) override;
+
   Status Put(const WriteOptions& options, std::string_view key,
              std::string_view value) override;
 
   Status Delete(const WriteOptions& options, std::string_view key) override;
 
+  Status Write(const WriteOptions& options, WriteBatch* batch) override;
+
+  void GetAsync(const ReadOptions& options, std::string key,
+                GetCallback callback) override;
+
+  void PutAsync(const WriteOptions& options, std::string key,
+                std::string value, WriteCallback callback) override;
+
+  void DeleteAsync(const WriteOptions& options, std::string key,
+                   WriteCallback callback) override;
+
   Status Flush() override;
 
   Status Compact() override;
 
   Status GetIterator(EntryIterator::Ptr* ptr) override;
+
+  Status GetProperty(std::string_view name, std::string* value) override;
 };
 }  // namespace pedrodb
 
@@ -0,0 +1,163 @@
+#ifndef PEDRODB_STATISTICS_H
+#define PEDRODB_STATISTICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "pedrodb/defines.h"
+
+namespace pedrodb {
+
+enum class Ticker : uint32_t {
+  kGets,
+  kMultiGetKeys,
+  kPuts,
+  kDeletes,
+  kWrites,
+
+  // the bytes of values returned to and records appended by users.
+  kBytesRead,
+  kBytesWritten,
+
+  kInlineHits,
+  kRowCacheHits,
+  kRowCacheMisses,
+  kBlockCacheHits,
+  kBlockCacheMisses,
+  // the misses served by a concurrent load of the same block.
+  kBlockCacheWaits,
+
+  // the bytes read from data files by the read cache.
+  kDiskBytesRead,
+
+  kCompactions,
+  kCompactionBytesWritten,
+  kSyncs,
+  kFileRollovers,
+  kTickerCount,
+};
+
+enum class Histogram : uint32_t {
+  kGet,
+  kMultiGet,
+  kPut,
+  kDelete,
+  kWrite,
+  kSync,
+  kCompaction,
+  kHistogramCount,
+};
+
+struct HistogramData {
+  uint64_t count{};
+  double average{};
+  double p50{};
+  double p99{};
+  double p999{};
+  double max{};
+};
+
+// Statistics counts the operations of databases, it can be shared by them.
+// The counters are sharded by threads, so recording is a relaxed add on a
+// cache line which is rarely shared. The histograms keep 4 buckets per power
+// of two of nanoseconds, the percentiles are within about 12%.
+class Statistics : noncopyable, nonmovable {
+ public:
+  using Ptr = std::shared_ptr<Statistics>;
+  using Clock = std::chrono::steady_clock;
+
+ private:
+  constexpr static size_t kShards = 16;
+  constexpr static size_t kSubBucketBits = 2;
+  constexpr static size_t kSubBuckets = 1 << kSubBucketBits;
+
+  // up to 2^40 nanoseconds, about 18 minutes.
+  constexpr static size_t kBuckets = 40 * kSubBuckets;
+
+  constexpr static size_t kTickers = static_cast<size_t>(Ticker::kTickerCount);
+  constexpr static size_t kHistograms =
+      static_cast<size_t>(Histogram::kHistogramCount);
+
+  struct HistogramShard {
+    std::atomic<uint64_t> count{};
+    std::atomic<uint64_t> sum{};
+    std::atomic<uint64_t> max{};
+    std::array<std::atomic<uint64_t>, kBuckets> buckets{};
+  };
+
+  struct alignas(64) Shard {
+    std::array<std::atomic<uint64_t>, kTickers> tickers{};
+    std::array<HistogramShard, kHistograms> histograms{};
+  };
+
+  std::unique_ptr<Shard[]> shards_;
+
+  static size_t BucketOf(uint64_t nanos) noexcept;
+
+  static uint64_t LowerBoundOf(size_t bucket) noexcept;
+
+  Shard& LocalShard() noexcept;
+
+ public:
+  Statistics();
+
+  void Record(Ticker ticker, uint64_t n = 1) noexcept {
+    LocalShard()
+        .tickers[static_cast<size_t>(ticker)]
+        .fetch_add(n, std::memory_order_relaxed);
+  }
+
+  void Measure(Histogram histogram, Clock::duration latency) noexcept;
+
+  [[nodiscard]] uint64_t GetTicker(Ticker ticker) const noexcept;
+
+  [[nodiscard]] HistogramData GetHistogram(Histogram histogram) const noexcept;
+
+  void Reset() noexcept;
+
+  // the name of a ticker is like "pedrodb.block.cache.hits", a histogram is
+  // like "pedrodb.get.micros".
+  static std::string_view NameOf(Ticker ticker) noexcept;
+
+  static std::string_view NameOf(Histogram histogram) noexcept;
+
+  // gets a ticker or a histogram by its name.
+  bool GetProperty(std::string_view name, std::string* value) const;
+
+  [[nodiscard]] std::string ToString() const;
+};
+
+inline void RecordTick(Statistics* statistics, Ticker ticker,
+                       uint64_t n = 1) noexcept {
+  if (statistics != nullptr) {
+    statistics->Record(ticker, n);
+  }
+}
+
+// measures the latency of a scope, it does nothing without statistics.
+class StopWatch : noncopyable, nonmovable {
+  Statistics* statistics_;
+  Histogram histogram_;
+  Statistics::Clock::time_point start_;
+
+ public:
+  StopWatch(Statistics* statistics, Histogram histogram) noexcept
+      : statistics_(statistics), histogram_(histogram) {
+    if (statistics_ != nullptr) {
+      start_ = Statistics::Clock::now();
+    }
+  }
+
+  ~StopWatch() {
+    if (statistics_ != nullptr) {
+      statistics_->Measure(histogram_, Statistics::Clock::now() - start_);
+    }
+  }
+};
+}  // namespace pedrodb
+
+#endif  // PEDRODB_STATISTICS_H
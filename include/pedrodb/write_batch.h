@@ -0,0 +1,51 @@
+#ifndef PEDRODB_WRITE_BATCH_H
+#define PEDRODB_WRITE_BATCH_H
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "pedrodb/format/record_format.h"
+
+namespace pedrodb {
+
+// WriteBatch holds a sequence of updates that DB::Write applies atomically.
+// Updates are applied in the order they are added to the batch.
+class WriteBatch {
+  std::vector<record::Entry<>> entries_;
+
+ public:
+  using Ptr = std::shared_ptr<WriteBatch>;
+
+  WriteBatch() = default;
+  ~WriteBatch() = default;
+
+  void Put(std::string_view key, std::string_view value) {
+    if (value.empty()) {
+      Delete(key);
+      return;
+    }
+
+    auto& entry = entries_.emplace_back();
+    entry.type = record::Type::kSet;
+    entry.key = key;
+    entry.value = value;
+  }
+
+  void Delete(std::string_view key) {
+    auto& entry = entries_.emplace_back();
+    entry.type = record::Type::kDelete;
+    entry.key = key;
+  }
+
+  void Clear() noexcept { entries_.clear(); }
+
+  [[nodiscard]] size_t Count() const noexcept { return entries_.size(); }
+
+  [[nodiscard]] auto begin() const noexcept { return entries_.begin(); }
+
+  [[nodiscard]] auto end() const noexcept { return entries_.end(); }
+};
+}  // namespace pedrodb
+
+#endif  // PEDRODB_WRITE_BATCH_H
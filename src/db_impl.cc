@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <tuple>
 
 #include <memory>
 
@@ -8,16 +12,122 @@ namespace pedrodb {
 
 Status DBImpl::Get(const ReadOptions& options, std::string_view key,
                    std::string* value) {
-  return HandleGet(options, key, value);
+  StopWatch watch(statistics_, Histogram::kGet);
+  RecordTick(statistics_, Ticker::kGets);
+  if (rate_limiter_ == nullptr || !rate_limiter_->IsAutoTuned()) {
+    return RecordRead(HandleGet(options, key, value), *value);
+  }
+
+  auto start = RateLimiter::Clock::now();
+  auto status = HandleGet(options, key, value);
+  rate_limiter_->RecordLatency(RateLimiter::Clock::now() - start);
+  return RecordRead(status, *value);
+}
+
+Status DBImpl::RecordRead(Status status, std::string_view value) {
+  if (status == Status::kOk) {
+    RecordTick(statistics_, Ticker::kBytesRead, value.size());
+  }
+  return status;
 }
 
 Status DBImpl::Put(const WriteOptions& options, std::string_view key,
                    std::string_view value) {
-  return HandlePut(options, key, value);
+  StopWatch watch(statistics_, Histogram::kPut);
+  RecordTick(statistics_, Ticker::kPuts);
+  return ThrottlePut(options, key, value);
+}
+
+Status DBImpl::ThrottlePut(const WriteOptions& options, std::string_view key,
+                           std::string_view value) {
+  if (rate_limiter_ == nullptr) {
+    return HandlePut(options, key, value);
+  }
+
+  rate_limiter_->Request(key.size() + value.size(), IOPriority::kForeground);
+  if (!rate_limiter_->IsAutoTuned()) {
+    return HandlePut(options, key, value);
+  }
+
+  auto start = RateLimiter::Clock::now();
+  auto status = HandlePut(options, key, value);
+  rate_limiter_->RecordLatency(RateLimiter::Clock::now() - start);
+  return status;
 }
 
 Status DBImpl::Delete(const WriteOptions& options, std::string_view key) {
-  return HandlePut(options, key, {});
+  StopWatch watch(statistics_, Histogram::kDelete);
+  RecordTick(statistics_, Ticker::kDeletes);
+  return ThrottlePut(options, key, {});
+}
+
+// the executor of async APIs if `Options::io_executor` is not set.
+static const std::shared_ptr<Executor>& GetDefaultIOExecutor() {
+  static std::shared_ptr<Executor> executor =
+      std::make_shared<DefaultExecutor>(std::thread::hardware_concurrency());
+  return executor;
+}
+
+// Runs f(0), ..., f(n - 1) on the executor and returns once they are done.
+// The caller runs them too and only waits for the ones already started, so
+// it never dead locks on a thread of the executor, e.g. Open in a callback.
+template <class F>
+static void ParallelFor(Executor* executor, size_t n, F&& f) {
+  struct State {
+    std::atomic<size_t> next{};
+    Latch done;
+    explicit State(size_t n) : done(n) {}
+  };
+  if (n == 0) {
+    return;
+  }
+
+  // a helper scheduled too late finds nothing left, and never calls f.
+  auto state = std::make_shared<State>(n);
+  auto run = [state, n, &f] {
+    for (size_t i; (i = state->next.fetch_add(1)) < n;) {
+      f(i);
+      state->done.CountDown();
+    }
+  };
+
+  size_t helpers = std::min<size_t>(
+      n, std::max<size_t>(std::thread::hardware_concurrency(), 1));
+  for (size_t i = 1; i < helpers; ++i) {
+    executor->Schedule(run);
+  }
+  run();
+  state->done.Await();
+}
+
+void DBImpl::GetAsync(const ReadOptions& options, std::string key,
+                      GetCallback callback) {
+  auto& executor = io_executor_ ? io_executor_ : GetDefaultIOExecutor();
+  executor->Schedule([self = shared_from_this(), options, key = std::move(key),
+                      callback = std::move(callback)] {
+    std::string value;
+    Status status = self->Get(options, key, &value);
+    callback(status, std::move(value));
+  });
+}
+
+void DBImpl::PutAsync(const WriteOptions& options, std::string key,
+                      std::string value, WriteCallback callback) {
+  auto& executor = io_executor_ ? io_executor_ : GetDefaultIOExecutor();
+  executor->Schedule([self = shared_from_this(), options, key = std::move(key),
+                      value = std::move(value),
+                      callback = std::move(callback)] {
+    callback(self->Put(options, key, value));
+  });
+}
+
+void DBImpl::DeleteAsync(const WriteOptions& options, std::string key,
+                         WriteCallback callback) {
+  auto& executor = io_executor_ ? io_executor_ : GetDefaultIOExecutor();
+  executor->Schedule([self = shared_from_this(), options, key = std::move(key),
+                      callback = std::move(callback)] {
+    callback(self->Delete(options, key));
+  });
 }
 
 void DBImpl::UpdateUnused(record::Location loc, size_t unused) {
@@ -50,6 +160,7 @@ Status DBImpl::Init() {
   }
 
   PEDRODB_INFO("recovery success");
+  recovered_ = true;
 
   std::weak_ptr<DBImpl> weak = shared_from_this();
 
@@ -61,7 +172,10 @@ Status DBImpl::Init() {
           return;
         }
 
-        auto err = ptr->file_manager_->Sync();
+        auto& file_manager = ptr->file_manager_;
+        file_manager->Throttle(file_manager->GetUnsyncedBytes(),
+                               IOPriority::kFlush);
+        auto err = file_manager->Sync();
         if (err != Status::kOk) {
           failed_count++;
         }
@@ -83,7 +197,7 @@ Status DBImpl::Init() {
         auto task = ptr->PollCompactTask();
         lock.unlock();
 
-        std::for_each(task.begin(), task.end(), [weak, ptr](auto task) {
+        std::for_each(task.begin(), task.end(), [weak, ptr](auto& task) {
           ptr->executor_->Schedule([weak, task = std::move(task)] {
             auto ptr = weak.lock();
             if (ptr == nullptr) {
@@ -94,16 +208,107 @@ Status DBImpl::Init() {
         });
       });
 
+  if (options_.checkpoint.enable) {
+    checkpoint_worker_ = executor_->ScheduleEvery(
+        options_.checkpoint.interval, options_.checkpoint.interval, [weak] {
+          auto ptr = weak.lock();
+          if (ptr == nullptr) {
+            return;
+          }
+          PEDRODB_IGNORE_ERROR(ptr->Checkpoint());
+        });
+  }
+
   return Status::kOk;
 }
 
-std::vector<file_id_t> DBImpl::PollCompactTask() {
-  auto tasks = compact_tasks_;
+// the LFS cost-benefit policy: a file is worth compacting if it has much
+// garbage and its data is cold, the age is counted in files written since.
+void DBImpl::PickCompactTask(std::vector<file_id_t>* tasks) {
+  double max_amplification = options_.compaction.max_space_amplification;
+  if (max_amplification <= 0) {
+    return;
+  }
+
+  auto active = file_manager_->GetActiveFileId();
+  auto active_rank = metadata_manager_->GetRank(active);
+
+  struct Candidate {
+    double score;
+    file_id_t id;
+    size_t free_bytes;
+  };
+
+  std::vector<Candidate> candidates;
+  size_t total_bytes = 0;
+  size_t free_bytes = 0;
+  for (auto id : metadata_manager_->GetFiles()) {
+    if (id == active) {
+      continue;
+    }
+
+    FileState state;
+    if (auto it = file_states_.find(id); it != file_states_.end()) {
+      state = it->second;
+    }
+
+    auto free = std::min(state.free_bytes, state.total_bytes);
+    total_bytes += state.total_bytes;
+    free_bytes += free;
+    if (state.compact_state != CompactState::kNop || free == 0) {
+      continue;
+    }
+
+    auto rank = metadata_manager_->GetRank(id);
+    double u = 1.0 - static_cast<double>(free) / state.total_bytes;
+    double age = active_rank > rank ? active_rank - rank : 1;
+    candidates.push_back({(1 - u) * age / (1 + u), id, free});
+  }
+
+  std::sort(candidates.begin(), candidates.end(),
+            [](auto& x, auto& y) { return x.score > y.score; });
+
+  // compact until the space amplification is within the bound.
+  for (auto& candidate : candidates) {
+    size_t live_bytes = total_bytes - free_bytes;
+    if (total_bytes <= live_bytes * max_amplification) {
+      break;
+    }
+
+    total_bytes -= candidate.free_bytes;
+    free_bytes -= candidate.free_bytes;
+
+    auto& state = file_states_[candidate.id];
+    state.compact_state = CompactState::kQueued;
+    tasks->emplace_back(candidate.id);
+  }
+}
+
+std::vector<std::vector<file_id_t>> DBImpl::PollCompactTask() {
+  auto tasks = std::move(compact_tasks_);
   compact_tasks_.clear();
+  PickCompactTask(&tasks);
+  std::sort(tasks.begin(), tasks.end());
+
+  // merge the files until the live bytes fill up an output file.
+  std::vector<std::vector<file_id_t>> groups;
+  size_t live_bytes = 0;
   for (auto file : tasks) {
-    file_states_[file].compact_state = CompactState::kScheduling;
+    auto& state = file_states_[file];
+    state.compact_state = CompactState::kScheduling;
+
+    size_t live = state.total_bytes - std::min(state.free_bytes,
+                                               state.total_bytes);
+    if (groups.empty() ||
+        groups.back().size() >= options_.compaction.max_merge_files ||
+        live_bytes + live > kMaxFileBytes) {
+      groups.emplace_back();
+      live_bytes = 0;
+    }
+    groups.back().emplace_back(file);
+    live_bytes += live;
   }
-  return {tasks.begin(), tasks.end()};
+  return groups;
 }
 
 Status DBImpl::Compact() {
@@ -111,53 +316,117 @@ Status DBImpl::Compact() {
   auto tasks = PollCompactTask();
   lock.unlock();
 
-  std::sort(tasks.begin(), tasks.end());
-  for (auto file : tasks) {
-    Compact(file);
+  for (auto& task : tasks) {
+    Compact(task);
   }
 
   return Status::kOk;
 }
 
 DBImpl::DBImpl(const Options& options, const std::string& name)
-    : options_(options), read_cache_(options.read_cache) {
+    : options_(options),
+      indices_(options.index_segments,
+               options.fingerprint_index
+                   ? [this](auto& dir, auto key) { return MatchKey(dir, key); }
+                   : SegmentIndex::KeyMatcher{},
+               options.inline_value_bytes),
+      read_cache_(options.read_cache),
+      row_cache_(options.read_cache),
+      checkpoint_barrier_(options.checkpoint.enable) {
   executor_ = options_.executor;
+  io_executor_ = options_.io_executor;
+  rate_limiter_ = options_.rate_limiter;
+  statistics_ = options_.statistics.get();
   metadata_manager_ = std::make_shared<MetadataManager>(name);
-  file_manager_ = std::make_shared<FileManager>(metadata_manager_, executor_,
-                                                options.max_open_files);
+  file_manager_ = std::make_shared<FileManager>(
+      metadata_manager_, executor_, rate_limiter_, options.max_open_files,
+      options.bytes_per_sync, options_.statistics);
 
   read_cache_.SetFileOpener([this](file_id_t f, ReadableFile::Ptr* file) {
     return file_manager_->AcquireDataFile(f, file);
   });
+  read_cache_.SetStatistics(statistics_);
+}
+
+Status DBImpl::GetIntProperty(std::string_view name, uint64_t* value) {
+  if (name == "pedrodb.num-keys") {
+    *value = indices_.Size();
+  } else if (name == "pedrodb.num-files") {
+    *value = metadata_manager_->GetFiles().size();
+  } else if (name == "pedrodb.free-bytes") {
+    auto lock = AcquireLock();
+    *value = 0;
+    for (auto& [id, state] : file_states_) {
+      *value += state.free_bytes;
+    }
+  } else if (name == "pedrodb.unsynced-bytes") {
+    *value = file_manager_->GetUnsyncedBytes();
+  } else {
+    return Status::kNotFound;
+  }
+  return Status::kOk;
+}
+
+Status DBImpl::GetProperty(std::string_view name, std::string* value) {
+  if (uint64_t n; GetIntProperty(name, &n) == Status::kOk) {
+    *value = std::to_string(n);
+    return Status::kOk;
+  }
+
+  if (statistics_ == nullptr) {
+    return Status::kNotFound;
+  }
+
+  if (name == "pedrodb.stats") {
+    *value = statistics_->ToString();
+    return Status::kOk;
+  }
+  return statistics_->GetProperty(name, value) ? Status::kOk
+                                               : Status::kNotFound;
 }
 
 DBImpl::~DBImpl() {
   executor_->ScheduleCancel(sync_worker_);
   executor_->ScheduleCancel(compact_worker_);
+  executor_->ScheduleCancel(checkpoint_worker_);
   file_manager_->Flush(true);
-}
 
-Status DBImpl::Recovery(file_id_t id) {
-  ReadableFile::Ptr file;
-  if (file_manager_->AcquireIndexFile(id, &file) == Status::kOk) {
-    auto iter = IndexIterator(file);
-    while (iter.Valid()) {
-      Recovery(id, iter.Next());
-    }
-    return Status::kOk;
+  if (recovered_ && options_.checkpoint.enable) {
+    PEDRODB_IGNORE_ERROR(Checkpoint());
   }
+}
 
+// rebuilds the index log of a file from its data file.
+Status DBImpl::RebuildIndexLog(file_id_t id, ArrayBuffer* log) {
+  ReadableFile::Ptr file;
   if (file_manager_->AcquireDataFile(id, &file) == Status::kOk) {
-    auto iter = RecordIterator(file);
+    auto iter = SequentialIterator(file);
     while (iter.Valid()) {
       index::EntryView view;
       view.offset = iter.GetOffset();
 
       auto next = iter.Next();
+      if (next.type == record::Type::kBatch) {
+        if (!next.Validate()) {
+          PEDRODB_WARN("drop incomplete batch in file {}", id);
+          break;
+        }
+
+        record::ForEachInBatch(next, view.offset, [&](uint32_t offset,
+                                                      auto entry) {
+          view.offset = offset;
+          view.len = entry.SizeOf();
+          view.type = entry.type;
+          view.key = entry.key;
+          view.Pack(log);
+        });
+        continue;
+      }
+
       view.len = next.SizeOf();
       view.type = next.type;
       view.key = next.key;
-      Recovery(id, view);
+      view.Pack(log);
     }
     file_manager_->ReleaseDataFile(id);
     return Status::kOk;
@@ -166,81 +435,360 @@ Status DBImpl::Recovery(file_id_t id) {
   return Status::kIOError;
 }
 
-void DBImpl::Compact(file_id_t id) {
-  if (readonly_) {
-    return;
+// parses the index of a file into partitions of keys, the index file is
+// read from mmap. It is rebuilt from the data file if the index file does
+// not exist or is corrupted.
+Status DBImpl::ReadIndexLog(file_id_t id, size_t partitions, IndexLog* log) {
+  MappingReadonlyFile::Ptr file;
+  ArrayBuffer rebuilt;
+  for (bool rebuild : {false, true}) {
+    std::optional<IndexIterator> iter;
+    if (!rebuild) {
+      if (file_manager_->AcquireIndexFile(id, &file) != Status::kOk) {
+        continue;
+      }
+      file->Prefetch(0, file->Size());
+
+      auto buffer = file->GetReadonlyBuffer();
+      iter.emplace(buffer.ReadIndex(), buffer.ReadableBytes(), file);
+    } else {
+      auto status = RebuildIndexLog(id, &rebuilt);
+      if (status != Status::kOk) {
+        return status;
+      }
+      iter.emplace(rebuilt.ReadIndex(), rebuilt.ReadableBytes());
+    }
+
+    // the keys are copied into one string, presized by the header.
+    size_t key_bytes = iter->GetKeyBytes();
+    if (key_bytes == 0) {
+      key_bytes = rebuild ? rebuilt.ReadableBytes() : file->Size();
+    }
+    log->keys.clear();
+    log->keys.reserve(key_bytes);
+    log->partitions.assign(partitions, {});
+    log->count = 0;
+
+    while (iter->Valid()) {
+      auto entry = iter->Next();
+      IndexLog::Item item;
+      item.key_pos = log->keys.size();
+      item.key_size = entry.key.size();
+      item.type = entry.type;
+      item.offset = entry.offset;
+      item.len = entry.len;
+      log->keys.append(entry.key);
+      log->partitions[Hash(entry.key) % partitions].emplace_back(item);
+      log->count++;
+    }
+
+    if (!iter->Corrupted()) {
+      return Status::kOk;
+    }
+    PEDRODB_WARN("index file {} is corrupted, rebuild it from data", id);
   }
+  return Status::kOk;
+}
 
-  ReadableFile::Ptr file;
-  auto stat = file_manager_->AcquireDataFile(id, &file);
-  if (stat != Status::kOk) {
+void DBImpl::Compact(const std::vector<file_id_t>& ids) {
+  if (readonly_) {
     return;
   }
 
-  PEDRODB_TRACE("start compacting {}", id);
+  // the active file is still written, it is compacted after rolled over.
+  std::vector<file_id_t> victims;
+  auto active = file_manager_->GetActiveFileId();
   {
     auto lock = AcquireLock();
-    auto& hints = file_states_[id];
-    hints.compact_state = CompactState::kCompacting;
+    for (auto id : ids) {
+      if (!metadata_manager_->Exists(id)) {
+        file_states_.erase(id);
+        continue;
+      }
+
+      auto& state = file_states_[id];
+      if (id == active) {
+        state.compact_state = CompactState::kNop;
+        continue;
+      }
+      state.compact_state = CompactState::kCompacting;
+      victims.emplace_back(id);
+    }
   }
 
-  auto iter = RecordIterator(file);
-  while (iter.Valid()) {
-    uint32_t offset = iter.GetOffset();
-    auto next = iter.Next();
-    if (next.type != record::Type::kSet) {
-      continue;
+  if (victims.empty()) {
+    return;
+  }
+  StopWatch watch(statistics_, Histogram::kCompaction);
+
+  // the outputs are recovered before the files written after the victims. A
+  // tombstone is kept if an older file may still hold the deleted key.
+  file_id_t rank = 0;
+  file_id_t min_rank = std::numeric_limits<file_id_t>::max();
+  std::unordered_map<file_id_t, file_id_t> ranks;
+  for (auto id : metadata_manager_->GetFiles()) {
+    auto r = metadata_manager_->GetRank(id);
+    if (std::find(victims.begin(), victims.end(), id) != victims.end()) {
+      ranks[id] = r;
+      rank = std::max(rank, r);
+    } else {
+      min_rank = std::min(min_rank, r);
     }
+  }
 
-    // check if the key is valid.
-    {
-      auto lock = AcquireLock();
-      auto it = indices_.find(next.key);
-      if (it == indices_.end()) {
+  struct Move {
+    std::string key;
+    record::Location from;
+    record::Location to;
+    uint32_t size;
+    std::optional<std::string> value;
+  };
+
+  std::vector<Move> moves;
+  std::vector<std::unique_ptr<FileManager::OutputFile>> outputs;
+  std::unordered_map<file_id_t, size_t> free_bytes;
+
+  // the io is throttled every `batch_bytes` read or written.
+  size_t batch_bytes = 0;
+  auto throttle = [&](size_t bytes) {
+    batch_bytes += bytes;
+    if (batch_bytes >= options_.compaction.batch_bytes) {
+      file_manager_->Throttle(batch_bytes, IOPriority::kCompaction);
+      batch_bytes = 0;
+    }
+  };
+
+  // the records of a window are checked and relocated together.
+  constexpr static size_t kWindowBytes = 1 << 20;
+  ArrayBuffer window;
+  std::vector<uint32_t> window_offsets;
+  std::vector<record::EntryView> entries;
+  std::vector<std::string_view> keys;
+  std::vector<record::Location> locs;
+  std::vector<bool> latest;
+  std::vector<uint32_t> offsets_out;
+
+  auto relocate = [&](file_id_t id) {
+    throttle(window.ReadableBytes());
+
+    // the records are copied, the scanner may reuse its buffer.
+    ReadableView view(window.ReadIndex(), window.ReadableBytes());
+    entries.resize(window_offsets.size());
+    keys.resize(window_offsets.size());
+    locs.resize(window_offsets.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+      entries[i].UnPack(&view);
+      keys[i] = entries[i].key;
+      locs[i] = {id, window_offsets[i]};
+    }
+    indices_.Contains(keys, locs, &latest);
+
+    // only the latest versions and the tombstones which may hide older
+    // versions are live.
+    size_t n = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+      if (entries[i].type == record::Type::kSet) {
+        if (!latest[i]) {
+          continue;
+        }
+      } else if (record::Dir dir;
+                 min_rank > ranks[id] || indices_.Get(keys[i], &dir)) {
         continue;
       }
+      entries[n] = entries[i];
+      window_offsets[n] = window_offsets[i];
+      n++;
+    }
+    entries.resize(n);
+
+    offsets_out.resize(n);
+    for (size_t i = 0; i < n;) {
+      size_t appended = 0;
+      if (!outputs.empty()) {
+        appended = outputs.back()->Append(entries.data() + i, n - i,
+                                          offsets_out.data() + i);
+      }
 
-      // steal entry.
-      auto& dir = it.value();
-      if (dir.loc != record::Location(id, offset)) {
-        continue;
+      if (appended == 0) {
+        auto& output = outputs.emplace_back(
+            std::make_unique<FileManager::OutputFile>());
+        if (auto stat = file_manager_->CreateOutputFile(output.get());
+            stat != Status::kOk) {
+          return stat;
+        }
+
+        appended = output->Append(entries.data() + i, n - i,
+                                  offsets_out.data() + i);
+        if (appended == 0) {
+          return Status::kCorruption;
+        }
+      }
+
+      auto output_id = outputs.back()->id;
+      for (size_t k = i; k < i + appended; ++k) {
+        auto& entry = entries[k];
+        throttle(entry.SizeOf());
+
+        // the kept tombstones are live, or the picker compacts them again
+        // and again.
+        if (entry.type == record::Type::kDelete) {
+          continue;
+        }
+        auto& move = moves.emplace_back();
+        move.key = entry.key;
+        move.from = {id, window_offsets[k]};
+        move.to = {output_id, offsets_out[k]};
+        move.size = entry.SizeOf();
+
+        // the inline value moves with the record.
+        if (MayInline(entry.value.size()) &&
+            ReadValue(entry, &move.value.emplace()) == Status::kOk &&
+            move.value->size() <= indices_.GetInlineValueBytes()) {
+          continue;
+        }
+        move.value.reset();
       }
+      i += appended;
     }
 
-    // move to active file because this file will be removed.
-    record::Location loc;
-    auto status = file_manager_->Append(next, &loc);
+    window.Reset();
+    window_offsets.clear();
+    return Status::kOk;
+  };
+
+  auto add = [&](uint32_t offset, const record::EntryView& entry) {
+    window.EnsureWritable(entry.SizeOf());
+    entry.Pack(&window);
+    window_offsets.emplace_back(offset);
+  };
+
+  Status status = Status::kOk;
+  size_t victim_bytes = 0;
+  for (auto id : victims) {
+    PEDRODB_TRACE("start compacting {}", id);
+
+    ReadableFile::Ptr file;
+    status = file_manager_->AcquireDataFile(id, &file);
     if (status != Status::kOk) {
-      return;
+      break;
     }
+    victim_bytes += file->Size();
 
-    // update the memory index
-    {
-      auto lock = AcquireLock();
-      auto it = indices_.find(next.key);
-      if (it != indices_.end()) {
-        if (it.value().loc < loc) {
-          record::Dir dir;
-          dir.loc = loc;
-          dir.entry_size = next.SizeOf();
-          indices_[next.key] = dir;
-        } else {
-          file_states_[loc.id].free_bytes += next.SizeOf();
-        }
+    auto iter = SequentialIterator(file);
+    while (status == Status::kOk && iter.Valid()) {
+      uint32_t offset = iter.GetOffset();
+      auto next = iter.Next();
+      if (next.type != record::Type::kBatch) {
+        add(offset, next);
+      } else if (next.Validate()) {
+        record::ForEachInBatch(next, offset, add);
       } else {
-        // the key has been deleted.
+        // a torn batch is the end of file.
+        break;
+      }
+
+      if (window.ReadableBytes() >= kWindowBytes) {
+        status = relocate(id);
       }
     }
+
+    if (status == Status::kOk && !window_offsets.empty()) {
+      status = relocate(id);
+    }
   }
 
-  // erase compaction_state.
-  {
+  std::vector<file_id_t> output_ids;
+  for (auto& output : outputs) {
+    if (status == Status::kOk) {
+      status = file_manager_->CloseOutputFile(output.get());
+    }
+    output_ids.emplace_back(output->id);
+  }
+
+  if (status != Status::kOk) {
+    PEDRODB_ERROR("failed to compact files, keep the victims");
+    for (auto& output : outputs) {
+      file_manager_->RemoveOutputFile(*output);
+    }
+
     auto lock = AcquireLock();
-    file_states_.erase(id);
+    for (auto id : victims) {
+      file_states_[id].compact_state = CompactState::kNop;
+    }
+    return;
+  }
+
+  // a checkpoint never sees the outputs before the moves are published.
+  std::shared_lock barrier{checkpoint_barrier_};
+
+  // register the outputs and drop the victims in one step.
+  status = metadata_manager_->CompactFiles(output_ids, rank, victims);
+  if (status != Status::kOk) {
+    PEDRODB_ERROR("failed to commit compaction, keep the victims");
+    auto lock = AcquireLock();
+    for (auto id : victims) {
+      file_states_[id].compact_state = CompactState::kNop;
+    }
+    return;
+  }
+
+  // publish the moved records unless they have been overwritten.
+  constexpr static size_t kPublishBatch = 1024;
+  std::vector<std::optional<SegmentIndex::InlineValue>> values;
+  for (size_t i = 0; i < moves.size(); i += kPublishBatch) {
+    size_t n = std::min(kPublishBatch, moves.size() - i);
+    keys.clear();
+    values.clear();
+    for (size_t k = 0; k < n; ++k) {
+      auto& move = moves[i + k];
+      keys.emplace_back(move.key);
+      if (move.value.has_value()) {
+        values.emplace_back(SegmentIndex::InlineValue{move.to, *move.value});
+      } else {
+        values.emplace_back();
+      }
+    }
+
+    indices_.Compute(keys, [&](size_t k, auto& dir) {
+      auto& move = moves[i + k];
+      if (dir.has_value() && dir->loc == move.from) {
+        dir->loc = move.to;
+        return;
+      }
+      free_bytes[move.to.id] += move.size;
+    }, &values);
+
+    for (auto key : keys) {
+      row_cache_.Remove(key);
+    }
+  }
+  barrier.unlock();
+
+  // removing large files stalls the file system too.
+  file_manager_->Throttle(victim_bytes, IOPriority::kCompaction);
+  for (auto id : victims) {
     PEDRODB_IGNORE_ERROR(file_manager_->RemoveFile(id));
+    PEDRODB_TRACE("end compacting: {}", id);
   }
 
-  PEDRODB_TRACE("end compacting: {}", id);
+  auto lock = AcquireLock();
+  for (auto id : victims) {
+    file_states_.erase(id);
+  }
+
+  // the outputs are truncated to pages.
+  for (auto& output : outputs) {
+    file_states_[output->id].total_bytes =
+        (output->bytes + kPageSize - 1) / kPageSize * kPageSize;
+    RecordTick(statistics_, Ticker::kCompactionBytesWritten, output->bytes);
+  }
+  RecordTick(statistics_, Ticker::kCompactions);
+
+  for (auto [id, bytes] : free_bytes) {
+    if (bytes != 0) {
+      UpdateUnused({id, 0}, bytes);
+    }
+  }
 }
 
 Status DBImpl::HandlePut(const WriteOptions& options, std::string_view key,
@@ -255,6 +803,7 @@ Status DBImpl::HandlePut(const WriteOptions& options, std::string_view key,
 
   std::string compressed;
   if (options_.compress_value) {
+    PerfTimer timer(&PerfContext::compress_nanos);
     Compress(value, &compressed);
     entry.value = compressed;
   } else {
@@ -270,52 +819,197 @@ Status DBImpl::HandlePut(const WriteOptions& options, std::string_view key,
   uint32_t timestamp = 0;
   entry.timestamp = timestamp;
 
+  // a checkpoint waits until the entry is indexed.
+  std::shared_lock barrier{checkpoint_barrier_};
   record::Location loc{};
   auto status = file_manager_->Append(entry, &loc);
+  if (status != Status::kOk) {
+    return status;
+  }
+  RecordTick(statistics_, Ticker::kBytesWritten, entry.SizeOf());
+
+  // the readers seeing the new location must also see it is in the active
+  // file, so they never cache the blocks being written.
+  UpdateMaxFile(loc.id);
+
+  SegmentIndex::InlineValue inlined{loc, value};
+  bool inline_value = entry.type == record::Type::kSet &&
+                      value.size() <= indices_.GetInlineValueBytes();
+
+  record::Dir unused{};
+  PerfTimer index_timer(&PerfContext::index_update_nanos);
+  PerfCount(&PerfContext::index_update_count);
+  status = indices_.Compute(
+      key,
+      [&](auto& dir) {
+        return UpdateIndex(dir, entry.type, loc, entry.SizeOf(), &unused);
+      },
+      inline_value ? &inlined : nullptr);
+  index_timer.Stop();
+  row_cache_.Remove(key);
+
+  if (unused.entry_size != 0) {
+    auto lock = AcquireLock();
+    UpdateUnused(unused.loc, unused.entry_size);
+  }
+  barrier.unlock();
+
   if (status != Status::kOk) {
     return status;
   }
 
-  auto lock = AcquireLock();
-  auto it = indices_.find(key);
-  max_file_ = std::max(max_file_, loc.id);
+  if (options.sync) {
+    return file_manager_->Sync();
+  }
+  return Status::kOk;
+}
+
+void DBImpl::UpdateMaxFile(file_id_t id) {
+  auto max_file = max_file_.load();
+  while (max_file < id && !max_file_.compare_exchange_weak(max_file, id)) {
+  }
+}
 
+Status DBImpl::UpdateIndex(std::optional<record::Dir>& dir, record::Type type,
+                           record::Location loc, uint32_t entry_size,
+                           record::Dir* unused) {
   // only for insert.
-  if (it == indices_.end()) {
+  if (!dir.has_value()) {
     // invalid deletion.
-    if (value.empty()) {
-      UpdateUnused(loc, entry.SizeOf());
+    if (type == record::Type::kDelete) {
+      unused->loc = loc;
+      unused->entry_size = entry_size;
       return Status::kNotFound;
     }
 
     // insert.
-    auto& dir = indices_[key];
-    dir.loc = loc;
-    dir.entry_size = entry.SizeOf();
-
-    lock.unlock();
-    if (options.sync) {
-      file_manager_->Sync();
-    }
+    dir = record::Dir{};
+    dir->loc = loc;
+    dir->entry_size = entry_size;
     return Status::kOk;
   }
 
   // replace or delete.
-  auto dir = it.value();
-  UpdateUnused(dir.loc, dir.entry_size);
+  *unused = *dir;
 
   // delete.
-  indices_.erase(it);
+  if (type == record::Type::kDelete) {
+    dir.reset();
+    return Status::kOk;
+  }
+
+  dir->loc = loc;
+  dir->entry_size = entry_size;
+  return Status::kOk;
+}
+
+Status DBImpl::Write(const WriteOptions& options, WriteBatch* batch) {
+  StopWatch watch(statistics_, Histogram::kWrite);
+  RecordTick(statistics_, Ticker::kWrites);
+  if (readonly_) {
+    return Status::kNotSupported;
+  }
+
+  if (batch->Count() == 0) {
+    return Status::kOk;
+  }
+
+  // pack all records of the batch into one entry.
+  ArrayBuffer records;
+  std::string compressed;
+  std::vector<std::optional<SegmentIndex::InlineValue>> values;
+  for (auto& update : *batch) {
+    auto& value = values.emplace_back();
+    if (update.type == record::Type::kSet &&
+        update.value.size() <= indices_.GetInlineValueBytes()) {
+      value = SegmentIndex::InlineValue{{}, update.value};
+    }
+
+    record::EntryView entry;
+    entry.type = update.type;
+    entry.key = update.key;
+
+    if (options_.compress_value && update.type == record::Type::kSet) {
+      PerfTimer timer(&PerfContext::compress_nanos);
+      Compress(update.value, &compressed);
+      entry.value = compressed;
+    } else {
+      entry.value = update.value;
+    }
+    entry.checksum = record::EntryView::Checksum(entry.key, entry.value);
+
+    records.EnsureWritable(entry.SizeOf());
+    entry.Pack(&records);
+  }
 
-  if (!value.empty()) {
-    dir.loc = loc;
-    dir.entry_size = entry.SizeOf();
-    indices_[key] = dir;
+  if (rate_limiter_ != nullptr) {
+    rate_limiter_->Request(records.ReadableBytes(), IOPriority::kForeground);
   }
 
+  record::EntryView entry;
+  entry.type = record::Type::kBatch;
+  entry.value = {records.ReadIndex(), records.ReadableBytes()};
+  entry.checksum = record::EntryView::Checksum(entry.key, entry.value);
+
+  if (entry.SizeOf() > kMaxFileBytes) {
+    PEDRODB_ERROR("write batch is too big");
+    return Status::kNotSupported;
+  }
+
+  std::shared_lock barrier{checkpoint_barrier_};
+  record::Location loc{};
+  auto status = file_manager_->Append(entry, &loc);
+  if (status != Status::kOk) {
+    return status;
+  }
+  RecordTick(statistics_, Ticker::kBytesWritten, entry.SizeOf());
+
+  // before the locations are published, see HandlePut().
+  UpdateMaxFile(loc.id);
+
+  struct Update {
+    record::Type type;
+    record::Location loc;
+    uint32_t entry_size;
+  };
+
+  std::vector<std::string_view> keys;
+  std::vector<Update> updates;
+  record::ForEachInBatch(entry, loc.offset, [&](uint32_t offset, auto next) {
+    if (auto& value = values[keys.size()]; value.has_value()) {
+      value->loc = {loc.id, offset};
+    }
+    keys.emplace_back(next.key);
+    updates.push_back({next.type, {loc.id, offset}, next.SizeOf()});
+  });
+
+  std::vector<record::Dir> unused(keys.size());
+  PerfTimer index_timer(&PerfContext::index_update_nanos);
+  PerfCount(&PerfContext::index_update_count, keys.size());
+  indices_.Compute(
+      keys,
+      [&](size_t i, auto& dir) {
+        auto& update = updates[i];
+        UpdateIndex(dir, update.type, update.loc, update.entry_size,
+                    &unused[i]);
+      },
+      &values);
+  index_timer.Stop();
+  for (auto key : keys) {
+    row_cache_.Remove(key);
+  }
+
+  auto lock = AcquireLock();
+  for (auto& dir : unused) {
+    if (dir.entry_size != 0) {
+      UpdateUnused(dir.loc, dir.entry_size);
+    }
+  }
   lock.unlock();
+  barrier.unlock();
+
   if (options.sync) {
-    file_manager_->Sync();
+    return file_manager_->Sync();
   }
   return Status::kOk;
 }
@@ -325,29 +1019,417 @@ Status DBImpl::Flush() {
 }
 
 Status DBImpl::Recovery() {
-  for (auto file : metadata_manager_->GetFiles()) {
-    PEDRODB_TRACE("crash recover: file {}", file);
-    max_file_ = std::max(max_file_, file);
-    auto status = Recovery(file);
-    if (status != Status::kOk) {
-      return status;
+  auto files = metadata_manager_->GetFiles();
+  for (auto file : files) {
+    ranks_[file] = metadata_manager_->GetRank(file);
+
+    // the outputs of compaction are ranked lower than their ids, they are
+    // truncated to the written bytes.
+    ReadableFile::Ptr data;
+    if (ranks_[file] != file &&
+        file_manager_->AcquireDataFile(file, &data) == Status::kOk) {
+      file_states_[file].total_bytes = data->Size();
+    }
+  }
+
+  // only the files after the checkpoint are replayed.
+  if (options_.checkpoint.enable) {
+    auto covered = LoadCheckpoint(files);
+    files.erase(std::remove_if(files.begin(), files.end(),
+                               [&](auto id) { return covered.count(id); }),
+                files.end());
+  }
+
+  // the files are parsed in parallel, then merged by partitions of keys. The
+  // entries of a key are still applied in the order of rank.
+  auto& executor = io_executor_ ? io_executor_ : GetDefaultIOExecutor();
+  size_t n = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+  for (size_t begin = 0; begin < files.size(); begin += n) {
+    size_t end = std::min(files.size(), begin + n);
+    std::vector<IndexLog> logs(end - begin);
+
+    ParallelFor(executor.get(), logs.size(), [&](size_t i) {
+      logs[i].status = ReadIndexLog(files[begin + i], n, &logs[i]);
+    });
+
+    size_t count = 0;
+    for (size_t i = 0; i < logs.size(); ++i) {
+      if (logs[i].status != Status::kOk) {
+        PEDRODB_ERROR("failed to recover file {}", files[begin + i]);
+        return logs[i].status;
+      }
+      count += logs[i].count;
+    }
+    indices_.Reserve(indices_.Size() + count);
+
+    std::vector<std::unordered_map<file_id_t, size_t>> unused(n);
+    ParallelFor(executor.get(), n, [&](size_t p) {
+      for (size_t i = 0; i < logs.size(); ++i) {
+        auto& keys = logs[i].keys;
+        for (auto& item : logs[i].partitions[p]) {
+          index::EntryView entry;
+          entry.key = {keys.data() + item.key_pos, item.key_size};
+          entry.type = item.type;
+          entry.offset = item.offset;
+          entry.len = item.len;
+          Recovery(files[begin + i], entry, &unused[p]);
+        }
+      }
+    });
+
+    for (auto& partition : unused) {
+      for (auto [id, bytes] : partition) {
+        UpdateUnused({id, 0}, bytes);
+      }
+    }
+    PEDRODB_INFO("crash recover success: file[{}] record[{}]", end,
+                 indices_.Size());
+  }
+
+  RecoverInlineValues();
+
+  ranks_.clear();
+  UpdateMaxFile(file_manager_->GetActiveFileId());
+  return Status::kOk;
+}
+
+bool DBImpl::MayInline(size_t size) const noexcept {
+  size_t n = indices_.GetInlineValueBytes();
+  if (n == 0) {
+    return false;
+  }
+
+  // the bound of snappy::MaxCompressedLength().
+  return size <= (options_.compress_value ? 32 + n + n / 6 : n);
+}
+
+void DBImpl::RecoverInlineValues() {
+  std::vector<std::pair<record::Dir, size_t>> dirs;
+  std::vector<std::string> keys;
+  indices_.ForEach([&](std::string_view key, auto& dir) {
+    size_t size = dir.entry_size - record::Header::SizeOf() - key.size();
+    if (MayInline(size)) {
+      dirs.emplace_back(dir, keys.size());
+      keys.emplace_back(key);
+    }
+  });
+  if (dirs.empty()) {
+    return;
+  }
+
+  std::sort(dirs.begin(), dirs.end(), [](const auto& x, const auto& y) {
+    return x.first.loc < y.first.loc;
+  });
+
+  // the files are read in parallel.
+  std::vector<std::pair<size_t, size_t>> ranges;
+  for (size_t i = 0, j = 0; i < dirs.size(); i = j) {
+    while (j < dirs.size() && dirs[j].first.loc.id == dirs[i].first.loc.id) {
+      j++;
+    }
+    ranges.emplace_back(i, j);
+  }
+
+  std::vector<std::string> values(keys.size());
+  std::vector<Status> status(keys.size(), Status::kNotFound);
+  auto& executor = io_executor_ ? io_executor_ : GetDefaultIOExecutor();
+  ParallelFor(executor.get(), ranges.size(), [&](size_t i) {
+    ReadDirectly(dirs, ranges[i].first, ranges[i].second, &values, &status);
+  });
+
+  // the dirs are unchanged, only the values are installed.
+  constexpr static size_t kBatch = 1024;
+  std::vector<std::string_view> batch;
+  std::vector<std::optional<SegmentIndex::InlineValue>> inlined;
+  size_t count = 0;
+  for (size_t begin = 0; begin < dirs.size(); begin += kBatch) {
+    batch.clear();
+    inlined.clear();
+    for (size_t k = begin; k < std::min(dirs.size(), begin + kBatch); ++k) {
+      auto& [dir, i] = dirs[k];
+      if (status[i] == Status::kOk &&
+          values[i].size() <= indices_.GetInlineValueBytes()) {
+        batch.emplace_back(keys[i]);
+        inlined.emplace_back(SegmentIndex::InlineValue{dir.loc, values[i]});
+      }
+    }
+    indices_.Compute(batch, [](size_t, auto&) {}, &inlined);
+    count += batch.size();
+  }
+  PEDRODB_INFO("recover inline values success: record[{}]", count);
+}
+
+// the checkpoint covers the files except the active one. The entries which
+// are changed while the index is visited are saved or not, recovery replays
+// the files after the checkpoint in either case.
+Status DBImpl::Checkpoint() {
+  std::unique_lock barrier{checkpoint_barrier_};
+  auto files = metadata_manager_->GetFiles();
+  auto active = file_manager_->GetActiveFileId();
+  files.erase(std::remove(files.begin(), files.end(), active), files.end());
+  std::sort(files.begin(), files.end());
+
+  ArrayBuffer states;
+  auto lock = AcquireLock();
+  for (auto id : files) {
+    checkpoint::FileState state;
+    state.id = id;
+    state.total_bytes = kMaxFileBytes;
+
+    auto it = file_states_.find(id);
+    if (it != file_states_.end()) {
+      state.free_bytes = it->second.free_bytes;
+      state.total_bytes = it->second.total_bytes;
+    }
+    state.Pack(&states);
+  }
+  lock.unlock();
+  barrier.unlock();
+
+  if (files == checkpoint_files_) {
+    return Status::kOk;
+  }
+
+  auto path = metadata_manager_->GetCheckpointFilePath();
+  auto tmp = path + ".tmp";
+  auto err = File::Remove(tmp.c_str());
+  if (err != Error::kOk && err != Error{ENOENT}) {
+    PEDRODB_WARN("failed to remove checkpoint {}: {}", tmp, err);
+  }
+
+  File::OpenOption option{.mode = File::OpenMode::kWrite, .create = 0644};
+  File file = File::Open(tmp.c_str(), option);
+  if (!file.Valid()) {
+    PEDRODB_ERROR("cannot open checkpoint {}: {}", tmp, file.GetError());
+    return Status::kIOError;
+  }
+
+  ArrayBuffer buffer;
+  size_t written = 0;
+  auto write = [&] {
+    written += buffer.ReadableBytes();
+    while (buffer.ReadableBytes() > 0) {
+      if (buffer.Retrieve(&file) <= 0) {
+        return Status::kIOError;
+      }
+    }
+    buffer.Reset();
+    return Status::kOk;
+  };
+
+  buffer.Append(checkpoint::kMagic, sizeof(checkpoint::kMagic));
+  checkpoint::AppendBlock(checkpoint::BlockType::kFiles, states.ReadIndex(),
+                          states.ReadableBytes(), &buffer);
+
+  constexpr static size_t kBlockBytes = 1 << 20;
+  std::unordered_set<file_id_t> covered(files.begin(), files.end());
+  ArrayBuffer entries;
+  uint64_t count = 0;
+  Status status = Status::kOk;
+  auto type = indices_.IsFingerprint() ? checkpoint::BlockType::kFingerprints
+                                       : checkpoint::BlockType::kEntries;
+  auto add = [&](const auto& entry) {
+    if (!covered.count(entry.dir.loc.id)) {
+      return;
     }
-    PEDRODB_INFO("crash recover success: record[{}]", indices_.size());
+
+    entry.Pack(&entries);
+    count++;
+    if (entries.ReadableBytes() >= kBlockBytes) {
+      checkpoint::AppendBlock(type, entries.ReadIndex(),
+                              entries.ReadableBytes(), &buffer);
+      entries.Reset();
+    }
+  };
+
+  // the entries of a segment are copied under its lock, and written after
+  // the lock is released.
+  for (size_t i = 0; i < indices_.GetSegments() && status == Status::kOk;
+       ++i) {
+    if (indices_.IsFingerprint()) {
+      indices_.ForEachFingerprint(i, [&](uint64_t fingerprint, auto& dir) {
+        add(checkpoint::FingerprintEntry{fingerprint, dir});
+      });
+    } else {
+      indices_.ForEach(i, [&](std::string_view key, auto& dir) {
+        add(checkpoint::Entry{key, dir});
+      });
+    }
+    status = write();
   }
+
+  if (entries.ReadableBytes() > 0) {
+    checkpoint::AppendBlock(type, entries.ReadIndex(), entries.ReadableBytes(),
+                            &buffer);
+  }
+  checkpoint::AppendBlock(checkpoint::BlockType::kEnd, (const char*)&count,
+                          sizeof(count), &buffer);
+  if (status == Status::kOk) {
+    status = write();
+  }
+
+  file_manager_->Throttle(written, IOPriority::kFlush);
+  if (status != Status::kOk || file.Sync() != Error::kOk ||
+      ::rename(tmp.c_str(), path.c_str()) != 0) {
+    PEDRODB_ERROR("failed to write checkpoint {}: {}", path, Error{errno});
+    return Status::kIOError;
+  }
+
+  checkpoint_files_ = std::move(files);
+  PEDRODB_INFO("checkpoint success: file[{}] record[{}]",
+               checkpoint_files_.size(), count);
   return Status::kOk;
 }
 
+std::unordered_set<file_id_t> DBImpl::LoadCheckpoint(
+    const std::vector<file_id_t>& files) {
+  auto file = std::make_shared<MappingReadonlyFile>();
+  if (file->Open(metadata_manager_->GetCheckpointFilePath()) != Status::kOk) {
+    return {};
+  }
+  file->Prefetch(0, file->Size());
+
+  // the blocks are all checked before the index is changed.
+  auto buffer = file->GetReadonlyBuffer();
+  checkpoint::BlockReader reader(buffer.ReadIndex(), buffer.ReadableBytes());
+  std::string_view states;
+  std::vector<std::string_view> blocks;
+  std::vector<std::string_view> fingerprints;
+  uint64_t count = 0;
+  bool end = false;
+
+  checkpoint::BlockType type;
+  std::string_view payload;
+  while (!end && reader.Next(&type, &payload)) {
+    switch (type) {
+      case checkpoint::BlockType::kFiles:
+        states = payload;
+        break;
+      case checkpoint::BlockType::kEntries:
+        blocks.emplace_back(payload);
+        break;
+      case checkpoint::BlockType::kFingerprints:
+        fingerprints.emplace_back(payload);
+        break;
+      case checkpoint::BlockType::kEnd:
+        if (payload.size() == sizeof(count)) {
+          memcpy(&count, payload.data(), sizeof(count));
+          end = true;
+        }
+        break;
+    }
+  }
+
+  if (!end || states.size() % checkpoint::FileState::SizeOf() != 0) {
+    PEDRODB_WARN("checkpoint is corrupted, recover from files");
+    return {};
+  }
+
+  // the keys can be hashed, but not the other way round.
+  if (!fingerprints.empty() && !indices_.IsFingerprint()) {
+    PEDRODB_WARN("checkpoint has no keys, recover from files");
+    return {};
+  }
+
+  // the files removed by compaction are not covered, their live entries
+  // have been moved to the outputs.
+  std::unordered_set<file_id_t> exists(files.begin(), files.end());
+  std::unordered_set<file_id_t> covered;
+  for (size_t i = 0; i < states.size(); i += checkpoint::FileState::SizeOf()) {
+    checkpoint::FileState state;
+    state.UnPack(states.data() + i);
+    if (!exists.count(state.id)) {
+      continue;
+    }
+
+    covered.emplace(state.id);
+    checkpoint_files_.emplace_back(state.id);
+    file_states_[state.id].free_bytes = state.free_bytes;
+    file_states_[state.id].total_bytes = state.total_bytes;
+  }
+
+  // the keys of a checkpoint are unique, the blocks are loaded in parallel.
+  indices_.Reserve(count);
+  auto& executor = io_executor_ ? io_executor_ : GetDefaultIOExecutor();
+  auto load_entries = [&](std::string_view block) {
+    checkpoint::Entry entry;
+    size_t index = 0;
+    while (size_t n = entry.UnPack(block.data() + index,
+                                   block.size() - index)) {
+      index += n;
+      if (!covered.count(entry.dir.loc.id)) {
+        continue;
+      }
+      indices_.Compute(entry.key, [&](auto& dir) { dir = entry.dir; });
+    }
+  };
+
+  constexpr static size_t kFingerprintSize =
+      checkpoint::FingerprintEntry::SizeOf();
+  auto load_fingerprints = [&](std::string_view block) {
+    checkpoint::FingerprintEntry entry;
+    for (size_t i = 0; i + kFingerprintSize <= block.size();
+         i += kFingerprintSize) {
+      entry.UnPack(block.data() + i);
+      if (covered.count(entry.dir.loc.id)) {
+        indices_.Insert(entry.fingerprint, entry.dir);
+      }
+    }
+  };
+
+  ParallelFor(executor.get(), blocks.size() + fingerprints.size(),
+              [&](size_t i) {
+                if (i < blocks.size()) {
+                  load_entries(blocks[i]);
+                } else {
+                  load_fingerprints(fingerprints[i - blocks.size()]);
+                }
+              });
+
+  PEDRODB_INFO("load checkpoint success: file[{}] record[{}]", covered.size(),
+               indices_.Size());
+  return covered;
+}
+
+bool DBImpl::IsNewer(record::Location x, record::Location y) const noexcept {
+  auto rank = [this](file_id_t id) {
+    auto it = ranks_.find(id);
+    return it == ranks_.end() ? id : it->second;
+  };
+  return std::make_tuple(rank(x.id), x.id, x.offset) >
+         std::make_tuple(rank(y.id), y.id, y.offset);
+}
+
 Status DBImpl::HandleGet(const ReadOptions& options, std::string_view key,
                          std::string* value) {
   
-  auto lock = AcquireLock();
-  auto it = indices_.find(key);
-  if (it == indices_.end()) {
+  record::Dir dir;
+  bool inlined = false;
+  if (!LookupIndex(key, &dir, value, &inlined)) {
     return Status::kNotFound;
   }
-  auto dir = it.value();
-  auto max_file = max_file_;
-  lock.unlock();
+  if (inlined) {
+    RecordTick(statistics_, Ticker::kInlineHits);
+    return Status::kOk;
+  }
+
+  bool use_row_cache = options.use_read_cache && row_cache_.Enabled();
+  if (use_row_cache) {
+    if (row_cache_.Get(key, dir.loc, value)) {
+      RecordTick(statistics_, Ticker::kRowCacheHits);
+      return Status::kOk;
+    }
+    RecordTick(statistics_, Ticker::kRowCacheMisses);
+  }
+  auto fill = [&](Status stat) {
+    if (stat == Status::kOk && use_row_cache) {
+      row_cache_.Put(key, dir.loc, *value);
+    }
+    return stat;
+  };
+
+  auto max_file = max_file_.load();
   
   bool directly_read = false;
   directly_read |= !options.use_read_cache;
@@ -369,18 +1451,7 @@ Status DBImpl::HandleGet(const ReadOptions& options, std::string_view key,
       return Status::kCorruption;
     }
 
-    auto entry = iterator.Next();
-    if (!entry.Validate()) {
-      PEDRODB_ERROR("checksum validation error");
-      return Status::kCorruption;
-    }
-
-    if (options_.compress_value) {
-      Uncompress(entry.value, value);
-    } else {
-      value->assign(entry.value);
-    }
-    return Status::kOk;
+    return fill(ReadValue(iterator.Next(), value));
   }
 
   ReadCache::Context ctx(dir.loc, dir.entry_size);
@@ -390,85 +1461,309 @@ Status DBImpl::HandleGet(const ReadOptions& options, std::string_view key,
     return stat;
   }
 
-  if (!ctx.GetEntry().Validate()) {
+  return fill(ReadValue(ctx.GetEntry(), value));
+}
+
+bool DBImpl::LookupIndex(std::string_view key, record::Dir* dir,
+                         std::string* value, bool* inlined) {
+  PerfTimer timer(&PerfContext::index_lookup_nanos);
+  PerfCount(&PerfContext::index_lookup_count);
+  return indices_.Get(key, dir, value, inlined);
+}
+
+Status DBImpl::ReadValue(const record::EntryView& entry,
+                         std::string* value) const {
+  PerfTimer validate_timer(&PerfContext::validate_nanos);
+  bool valid = entry.Validate();
+  validate_timer.Stop();
+  if (!valid) {
     PEDRODB_ERROR("checksum validation error");
     return Status::kCorruption;
   }
 
+  PerfTimer uncompress_timer(&PerfContext::uncompress_nanos);
   if (options_.compress_value) {
-    Uncompress(ctx.GetEntry().value, value);
+    Uncompress(entry.value, value);
   } else {
-    value->assign(ctx.GetEntry().value);
+    value->assign(entry.value);
   }
   return Status::kOk;
 }
 
-void DBImpl::Recovery(file_id_t id, index::EntryView entry) {
-  record::Location loc(id, entry.offset);
+bool DBImpl::MatchKey(const record::Dir& dir, std::string_view key) {
+  size_t n = record::Header::SizeOf() + key.size();
+  if (n > dir.entry_size) {
+    return false;
+  }
 
-  auto it = indices_.find(entry.key);
-  if (entry.type == record::Type::kSet) {
-    if (it == indices_.end()) {
-      auto& dir = indices_[entry.key];
-      dir.entry_size = entry.len;
-      dir.loc = loc;
-      return;
+  ReadableFile::Ptr file;
+  if (file_manager_->AcquireDataFile(dir.loc.id, &file) != Status::kOk) {
+    return false;
+  }
+
+  char buf[record::Header::SizeOf() + std::numeric_limits<uint8_t>::max()];
+  if (file->Read(dir.loc.offset, buf, n) != static_cast<ssize_t>(n)) {
+    PEDRODB_ERROR("failed to read key of record: {}", file->GetError());
+    return false;
+  }
+
+  ReadableView view(buf, n);
+  record::Header header;
+  return header.UnPack(&view) && header.key_size == key.size() &&
+         memcmp(view.ReadIndex(), key.data(), key.size()) == 0;
+}
+
+Status DBImpl::MultiGet(const ReadOptions& options,
+                        const std::vector<std::string_view>& keys,
+                        std::vector<std::string>* values,
+                        std::vector<Status>* status) {
+  StopWatch watch(statistics_, Histogram::kMultiGet);
+  RecordTick(statistics_, Ticker::kMultiGetKeys, keys.size());
+  values->clear();
+  values->resize(keys.size());
+  status->assign(keys.size(), Status::kNotFound);
+
+  // resolve all keys first, then read them in the order of location.
+  bool use_row_cache = options.use_read_cache && row_cache_.Enabled();
+  std::vector<std::pair<record::Dir, size_t>> dirs;
+  dirs.reserve(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    record::Dir dir;
+    bool inlined = false;
+    if (!LookupIndex(keys[i], &dir, &(*values)[i], &inlined)) {
+      continue;
+    }
+    if (inlined) {
+      RecordTick(statistics_, Ticker::kInlineHits);
+      (*status)[i] = Status::kOk;
+      continue;
+    }
+    if (use_row_cache) {
+      if (row_cache_.Get(keys[i], dir.loc, &(*values)[i])) {
+        RecordTick(statistics_, Ticker::kRowCacheHits);
+        (*status)[i] = Status::kOk;
+        continue;
+      }
+      RecordTick(statistics_, Ticker::kRowCacheMisses);
+    }
+    dirs.emplace_back(dir, i);
+  }
+  std::sort(dirs.begin(), dirs.end(), [](const auto& x, const auto& y) {
+    return x.first.loc < y.first.loc;
+  });
+
+  auto max_file = max_file_.load();
+  bool use_read_cache = options.use_read_cache && options_.read_cache.enable;
+
+  std::vector<ReadCache::Context> ctxs;
+  std::vector<size_t> cached;
+  for (size_t i = 0, j = 0; i < dirs.size(); i = j) {
+    file_id_t id = dirs[i].first.loc.id;
+    while (j < dirs.size() && dirs[j].first.loc.id == id) {
+      j++;
     }
 
-    // indices has the newer version data.
-    auto dir = it.value();
-    if (dir.loc > loc) {
-      UpdateUnused(loc, entry.len);
-      return;
+    if (!use_read_cache || id == max_file) {
+      ReadDirectly(dirs, i, j, values, status);
+      continue;
+    }
+
+    for (size_t k = i; k < j; ++k) {
+      ctxs.emplace_back(dirs[k].first.loc, dirs[k].first.entry_size);
+      cached.emplace_back(dirs[k].second);
     }
+  }
 
-    // never happen.
-    if (dir.loc == loc) {
-      PEDRODB_FATAL("meta.loc == loc should never happened");
+  if (!ctxs.empty()) {
+    std::vector<Status> stats;
+    read_cache_.Get(ctxs, &stats);
+    for (size_t i = 0; i < ctxs.size(); ++i) {
+      size_t k = cached[i];
+      if (stats[i] != Status::kOk) {
+        PEDRODB_ERROR("failed to get from cache");
+        (*status)[k] = stats[i];
+        continue;
+      }
+      (*status)[k] = ReadValue(ctxs[i].GetEntry(), &(*values)[k]);
     }
+  }
 
-    // indices has the elder version data.
-    UpdateUnused(dir.loc, dir.entry_size);
+  if (use_row_cache) {
+    for (auto& [dir, i] : dirs) {
+      if ((*status)[i] == Status::kOk) {
+        row_cache_.Put(keys[i], dir.loc, (*values)[i]);
+      }
+    }
+  }
 
-    // update indices.
-    dir.loc = loc;
-    dir.entry_size = entry.len;
-    indices_[entry.key] = dir;
+  if (statistics_ != nullptr) {
+    size_t bytes = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      if ((*status)[i] == Status::kOk) {
+        bytes += (*values)[i].size();
+      }
+    }
+    statistics_->Record(Ticker::kBytesRead, bytes);
   }
+  return Status::kOk;
+}
 
-  // a tombstone of deletion.
-  if (entry.type == record::Type::kDelete) {
-    UpdateUnused(loc, entry.len);
-    if (it == indices_.end()) {
-      return;
+void DBImpl::ReadDirectly(
+    const std::vector<std::pair<record::Dir, size_t>>& dirs, size_t begin,
+    size_t end, std::vector<std::string>* values,
+    std::vector<Status>* status) {
+  constexpr static uint64_t kMaxReadBytes = 1 << 20;
+
+  // the records of a block are read together, as the read cache does.
+  const uint64_t block_bit =
+      ReadCache::BlockBitOf(options_.read_cache.block_size);
+
+  file_id_t id = dirs[begin].first.loc.id;
+  ReadableFile::Ptr file;
+  auto stat = file_manager_->AcquireDataFile(id, &file);
+  if (stat != Status::kOk) {
+    PEDRODB_ERROR("cannot get file {}", id);
+    for (size_t i = begin; i < end; ++i) {
+      (*status)[dirs[i].second] = stat;
+    }
+    return;
+  }
+
+  // records starting in the last block of the previous ones are read by the
+  // same request, and all requests of the file are submitted together.
+  std::vector<std::pair<size_t, size_t>> runs;
+  std::vector<std::string> bufs;
+  std::vector<ReadRequest> requests;
+  for (size_t i = begin, j = begin; i < end; i = j) {
+    uint64_t first = dirs[i].first.loc.offset;
+    uint64_t last = first;
+    for (; j < end; ++j) {
+      auto& dir = dirs[j].first;
+      if (j > i && (dir.loc.offset >> block_bit) > ((last - 1) >> block_bit)) {
+        break;
+      }
+      if (j > i && dir.loc.offset + dir.entry_size - first > kMaxReadBytes) {
+        break;
+      }
+      last = std::max(last, uint64_t{dir.loc.offset} + dir.entry_size);
     }
 
-    // Recover(file_id_t) should be called monotonously,
-    // therefore entry.loc is always monotonously increased.
-    // should not delete the latest version data.
-    auto dir = it.value();
+    runs.emplace_back(i, j);
+    bufs.emplace_back(last - first, '\0');
+    auto& r = requests.emplace_back();
+    r.offset = first;
+    r.n = last - first;
+  }
 
-    if (dir.loc > loc) {
-      return;
+  for (size_t i = 0; i < requests.size(); ++i) {
+    requests[i].buf = bufs[i].data();
+  }
+  file->MultiRead(requests.data(), requests.size());
+
+  for (size_t i = 0; i < runs.size(); ++i) {
+    auto& r = requests[i];
+    if (r.result < 0) {
+      PEDRODB_ERROR("failed to read file {}", id);
+    }
+
+    // a short read keeps the records before its end.
+    size_t read = r.result < 0 ? 0 : static_cast<size_t>(r.result);
+    for (size_t k = runs[i].first; k < runs[i].second; ++k) {
+      auto& [dir, idx] = dirs[k];
+      if (dir.loc.offset + dir.entry_size - r.offset > read) {
+        (*status)[idx] = Status::kIOError;
+        continue;
+      }
+
+      ReadableView view(r.buf + (dir.loc.offset - r.offset), dir.entry_size);
+      record::EntryView entry;
+      if (!entry.UnPack(&view)) {
+        (*status)[idx] = Status::kCorruption;
+        continue;
+      }
+      (*status)[idx] = ReadValue(entry, &(*values)[idx]);
     }
+  }
+}
 
-    UpdateUnused(dir.loc, dir.entry_size);
-    indices_.erase(it);
+void DBImpl::Recovery(file_id_t id, index::EntryView entry,
+                      std::unordered_map<file_id_t, size_t>* free_bytes) {
+  record::Location loc(id, entry.offset);
+
+  // the space of replaced or useless entries.
+  std::optional<record::Dir> unused[2];
+  indices_.Compute(entry.key, [&](auto& dir) {
+    if (entry.type == record::Type::kSet) {
+      if (!dir.has_value()) {
+        dir = record::Dir{};
+        dir->entry_size = entry.len;
+        dir->loc = loc;
+        return;
+      }
+
+      // indices has the newer version data.
+      if (IsNewer(dir->loc, loc)) {
+        unused[0] = record::Dir{entry.len, loc};
+        return;
+      }
+
+      // never happen.
+      if (dir->loc == loc) {
+        PEDRODB_FATAL("meta.loc == loc should never happened");
+      }
+
+      // indices has the elder version data.
+      unused[0] = dir;
+
+      // update indices.
+      dir->loc = loc;
+      dir->entry_size = entry.len;
+    }
+
+    // a tombstone of deletion.
+    if (entry.type == record::Type::kDelete) {
+      unused[0] = record::Dir{entry.len, loc};
+      if (!dir.has_value()) {
+        return;
+      }
+
+      // the entries of a key are recovered in the order of rank,
+      // should not delete the latest version data.
+      if (IsNewer(dir->loc, loc)) {
+        return;
+      }
+
+      unused[1] = dir;
+      dir.reset();
+    }
+  });
+
+  for (auto& dir : unused) {
+    if (dir.has_value()) {
+      (*free_bytes)[dir->loc.id] += dir->entry_size;
+    }
   }
 }
 
 Status DBImpl::GetIterator(EntryIterator::Ptr* iterator) {
+  // the records are visited in the order of location, so every file is
+  // scanned sequentially.
   struct EntryIteratorImpl : public EntryIterator {
-    tsl::htrie_map<char, record::Dir> indices_;
-    tsl::htrie_map<char, record::Dir>::iterator it_;
+    std::vector<record::Dir> indices_;
+    std::vector<record::Dir>::iterator it_;
     record::EntryView next_;
     DBImpl* parent_;
     FileManager* file_manager_;
 
+    file_id_t file_id_{};
+    std::unique_ptr<SequentialIterator> iter_;
+
     explicit EntryIteratorImpl(DBImpl* parent)
         : parent_(parent), file_manager_(parent_->file_manager_.get()) {
-      auto lock = parent_->AcquireLock();
-      indices_ = parent_->indices_;
+      parent_->indices_.ForEach(
+          [this](auto&&, auto& dir) { indices_.emplace_back(dir); });
+      std::sort(indices_.begin(), indices_.end(),
+                [](auto& x, auto& y) { return x.loc < y.loc; });
       it_ = indices_.begin();
     }
 
@@ -480,19 +1775,25 @@ Status DBImpl::GetIterator(EntryIterator::Ptr* iterator) {
           return false;
         }
 
-        auto dir = (it_++).value();
-        ReadableFile::Ptr file;
-        auto status = file_manager_->AcquireDataFile(dir.loc.id, &file);
-        if (status != Status::kOk) {
-          continue;
+        auto dir = *(it_++);
+        if (iter_ == nullptr || file_id_ != dir.loc.id) {
+          iter_ = nullptr;
+
+          ReadableFile::Ptr file;
+          auto status = file_manager_->AcquireDataFile(dir.loc.id, &file);
+          if (status != Status::kOk) {
+            continue;
+          }
+          iter_ = std::make_unique<SequentialIterator>(file);
+          file_id_ = dir.loc.id;
         }
 
-        auto iter = RecordIterator(file);
-        if (!iter.Valid()) {
+        iter_->Seek(dir.loc.offset);
+        if (!iter_->Valid()) {
           continue;
         }
 
-        next_ = iter.Next();
+        next_ = iter_->Next();
         if (!next_.Validate()) {
           continue;
         }
@@ -503,7 +1804,7 @@ Status DBImpl::GetIterator(EntryIterator::Ptr* iterator) {
 
     record::EntryView Next() override { return next_; }
 
-    void Close() override {}
+    void Close() override { iter_ = nullptr; }
   };
 
   *iterator = std::make_unique<EntryIteratorImpl>(this);
@@ -1,7 +1,17 @@
 #include "pedrodb/file_manager.h"
 
+#include <algorithm>
+
 namespace pedrodb {
 
+// data files are immutable after they are closed, read them by io_uring if
+// it is enabled.
+#ifdef PEDRODB_WITH_IO_URING
+using DataReadonlyFile = UringReadonlyFile;
+#else
+using DataReadonlyFile = PosixReadonlyFile;
+#endif
+
 Status FileManager::Recovery(file_id_t id) {
   auto status = CreateFile(id);
   if (status != Status::kOk) {
@@ -13,7 +23,7 @@ Status FileManager::Recovery(file_id_t id) {
 Status FileManager::Init() {
   auto files = metadata_manager_->GetFiles();
   if (files.empty()) {
-    auto status = CreateFile(1);
+    auto status = CreateFile(metadata_manager_->NewFileId());
     if (status != Status::kOk) {
       return status;
     }
@@ -24,6 +34,9 @@ Status FileManager::Init() {
 }
 
 void FileManager::SyncFile(file_id_t id, const ReadWriteFile::Ptr& file) {
+  Throttle(file->GetUnsyncedBytes(), IOPriority::kFlush);
+  StopWatch watch(statistics_.get(), Histogram::kSync);
+  RecordTick(statistics_.get(), Ticker::kSyncs);
   auto err = file->Sync();
   if (err != Error::kOk) {
     PEDRODB_WARN("failed to sync active file to disk");
@@ -32,33 +45,67 @@ void FileManager::SyncFile(file_id_t id, const ReadWriteFile::Ptr& file) {
         [this, self = shared_from_this(), id, file] { SyncFile(id, file); });
     return;
   }
+
+  auto lock = AcquireLock();
+  auto it = std::find(unsynced_files_.begin(), unsynced_files_.end(), file);
+  if (it != unsynced_files_.end()) {
+    unsynced_files_.erase(it);
+  }
   PEDRODB_TRACE("sync file {} success", id);
 }
 
-void FileManager::CreateIndexFile(file_id_t id,
-                                  const std::shared_ptr<ArrayBuffer>& log) {
+Status FileManager::WriteIndexFile(file_id_t id, const ArrayBuffer& log) {
+  ArrayBuffer content;
+  index::BuildIndexFile(log.ReadIndex(), log.ReadableBytes(), &content);
+
   auto index_path = metadata_manager_->GetIndexFilePath(id);
   auto file = std::make_shared<MappingReadWriteFile>();
-  auto err = file->Open(index_path, log->ReadableBytes());
+  auto err = file->Open(index_path, content.ReadableBytes());
   if (err != Status::kOk) {
+    return err;
+  }
+
+  file->Allocate(content.ReadableBytes())
+      .Append(content.ReadIndex(), content.ReadableBytes());
+  if (file->Sync() != Error::kOk) {
+    return Status::kIOError;
+  }
+  return Status::kOk;
+}
+
+void FileManager::CreateIndexFile(file_id_t id,
+                                  const std::shared_ptr<ArrayBuffer>& log) {
+  Throttle(log->ReadableBytes(), IOPriority::kFlush);
+  if (WriteIndexFile(id, *log) != Status::kOk) {
     executor_->ScheduleAfter(Duration::Seconds(1),
                              [this, self = shared_from_this(), id, log] {
                                CreateIndexFile(id, log);
                              });
     return;
   }
-  
-  file->Allocate(log->ReadableBytes())
-      .Append(log->ReadIndex(), log->ReadableBytes());
 
   PEDRODB_TRACE("create index file {} success", id);
 }
 
+// the files of an id which is not in metadata are left by a crash, such as
+// the outputs of an uncommitted compaction.
+void FileManager::RemoveStaleFiles(file_id_t id) {
+  for (auto& path : {metadata_manager_->GetDataFilePath(id),
+                     metadata_manager_->GetIndexFilePath(id)}) {
+    auto err = File::Remove(path.c_str());
+    if (err != Error::kOk && err != Error{ENOENT}) {
+      PEDRODB_WARN("failed to remove stale file {}: {}", path, err);
+    }
+  }
+}
+
 Status FileManager::CreateFile(file_id_t id) {
   if (active_data_file_) {
+    RecordTick(statistics_.get(), Ticker::kFileRollovers);
     PEDRODB_TRACE("flush {} to disk", id);
     PEDRODB_IGNORE_ERROR(active_data_file_->Flush(true));
 
+    unsynced_files_.emplace_back(active_data_file_);
     executor_->Schedule([this, self = shared_from_this(), id = active_file_id_,
                          f = active_data_file_] { SyncFile(id, f); });
 
@@ -70,7 +117,11 @@ Status FileManager::CreateFile(file_id_t id) {
     }
   }
 
-  auto file = std::make_shared<MappingReadWriteFile>();
+  if (!metadata_manager_->Exists(id)) {
+    RemoveStaleFiles(id);
+  }
+
+  auto file = std::make_shared<MappingReadWriteFile>(bytes_per_sync_);
   auto err = file->Open(metadata_manager_->GetDataFilePath(id), kMaxFileBytes);
   if (err != Status::kOk) {
     return err;
@@ -79,10 +130,32 @@ Status FileManager::CreateFile(file_id_t id) {
   // Rebuild index from file.
   record::EntryView entry;
   uint32_t offset = 0;
+  uint32_t torn = 0;
   active_index_log_ = std::make_shared<ArrayBuffer>();
 
   auto buffer = file->GetReadableBuffer();
   while (entry.UnPack(&buffer)) {
+    if (entry.type == record::Type::kBatch) {
+      // a torn batch is the end of the log, it will be overwritten.
+      if (!entry.Validate()) {
+        PEDRODB_WARN("drop incomplete batch at offset {}", offset);
+        torn = entry.SizeOf();
+        break;
+      }
+
+      record::ForEachInBatch(entry, offset, [&](uint32_t off, auto next) {
+        index::EntryView index;
+        index.offset = off;
+        index.len = next.SizeOf();
+        index.type = next.type;
+        index.key = next.key;
+        index.Pack(active_index_log_.get());
+      });
+
+      offset += entry.SizeOf();
+      continue;
+    }
+
     index::EntryView index;
     index.offset = offset;
     index.len = entry.SizeOf();
@@ -93,7 +166,16 @@ Status FileManager::CreateFile(file_id_t id) {
     index.Pack(active_index_log_.get());
   }
 
-  if (offset != 0) {
+  // erase the torn batch, so its records never show up after the new tail.
+  if (torn != 0) {
+    file->SetWriteOffset(offset);
+    auto erased = file->Allocate(torn);
+    if (erased.GetOffset() != (size_t)-1) {
+      memset(erased.WriteIndex(), 0, erased.WritableBytes());
+    }
+  }
+
+  if (offset != 0 || torn != 0) {
     PEDRODB_WARN("last offset {}", offset);
     file->SetWriteOffset(offset);
   }
@@ -105,6 +187,30 @@ Status FileManager::CreateFile(file_id_t id) {
   return Status::kOk;
 }
 
+Status FileManager::CreateOutputFile(OutputFile* output) {
+  output->id = metadata_manager_->NewFileId();
+  RemoveStaleFiles(output->id);
+
+  output->file = std::make_shared<MappingReadWriteFile>(bytes_per_sync_);
+  output->index_log.Reset();
+  output->bytes = 0;
+  return output->file->Open(metadata_manager_->GetDataFilePath(output->id),
+                            kMaxFileBytes);
+}
+
+Status FileManager::CloseOutputFile(OutputFile* output) {
+  auto& file = output->file;
+  if (file->Sync() != Error::kOk || file->Truncate(kPageSize) != Error::kOk) {
+    PEDRODB_ERROR("failed to close output file {}", output->id);
+    return Status::kIOError;
+  }
+  return WriteIndexFile(output->id, output->index_log);
+}
+
+void FileManager::RemoveOutputFile(const OutputFile& output) {
+  RemoveStaleFiles(output.id);
+}
+
 void FileManager::ReleaseDataFile(file_id_t id) {
   auto lock = AcquireLock();
   ReadableFile::Ptr file;
@@ -112,6 +218,8 @@ void FileManager::ReleaseDataFile(file_id_t id) {
 }
 
 Status FileManager::AcquireDataFile(file_id_t id, ReadableFile::Ptr* file) {
+  PerfTimer timer(&PerfContext::acquire_file_nanos);
+  PerfCount(&PerfContext::acquire_file_count);
   {
     auto lock = AcquireLock();
     if (id == active_file_id_) {
@@ -124,7 +232,8 @@ Status FileManager::AcquireDataFile(file_id_t id, ReadableFile::Ptr* file) {
     }
   }
 
-  auto ptr = std::make_shared<PosixReadonlyFile>();
+  PerfCount(&PerfContext::file_open_count);
+  auto ptr = std::make_shared<DataReadonlyFile>();
   auto stat = ptr->Open(metadata_manager_->GetDataFilePath(id));
   if (stat != Status::kOk) {
     return stat;
@@ -171,26 +280,53 @@ Status FileManager::Flush(bool force) {
 }
 
 Status FileManager::Sync() {
+  return group_commit_.Commit([this] {
+    StopWatch watch(statistics_.get(), Histogram::kSync);
+    RecordTick(statistics_.get(), Ticker::kSyncs);
+    return SyncFiles();
+  });
+}
+
+size_t FileManager::GetUnsyncedBytes() {
   std::unique_lock lock{mu_};
-  auto active = active_data_file_;
+  auto files = unsynced_files_;
+  files.emplace_back(active_data_file_);
   lock.unlock();
 
-  if (active == nullptr) {
-    return Status::kOk;
+  size_t bytes = 0;
+  for (auto& file : files) {
+    if (file != nullptr) {
+      bytes += file->GetUnsyncedBytes();
+    }
   }
+  return bytes;
+}
 
-  if (auto err = active->Flush(true); err != Error::kOk) {
-    return Status::kIOError;
-  }
+Status FileManager::SyncFiles() {
+  std::unique_lock lock{mu_};
+  auto files = unsynced_files_;
+  files.emplace_back(active_data_file_);
+  lock.unlock();
 
-  if (auto err = active->Sync(); err != Error::kOk) {
-    return Status::kIOError;
+  for (auto& file : files) {
+    if (file == nullptr) {
+      continue;
+    }
+
+    if (auto err = file->Flush(true); err != Error::kOk) {
+      return Status::kIOError;
+    }
+
+    if (auto err = file->Sync(); err != Error::kOk) {
+      return Status::kIOError;
+    }
   }
   return Status::kOk;
 }
 
-Status FileManager::AcquireIndexFile(file_id_t id, ReadableFile::Ptr* file) {
-  auto ptr = std::make_shared<PosixReadonlyFile>();
+Status FileManager::AcquireIndexFile(file_id_t id,
+                                     MappingReadonlyFile::Ptr* file) {
+  auto ptr = std::make_shared<MappingReadonlyFile>();
   Status status = ptr->Open(metadata_manager_->GetIndexFilePath(id));
   if (status != Status::kOk) {
     return status;
@@ -1,4 +1,6 @@
 #include "pedrodb/metadata_manager.h"
+#include <unistd.h>
+#include <algorithm>
 #include "pedrodb/defines.h"
 #include "pedrodb/logger/logger.h"
 namespace pedrodb {
@@ -19,13 +21,34 @@ Status MetadataManager::Recovery() {
   PEDRODB_INFO("read database {}", name_);
 
   while (buffer.ReadableBytes()) {
+    size_t offset = length - buffer.ReadableBytes();
+
+    uint8_t type;
+    PeekInt(&buffer, &type);
+    if (type == (uint8_t)metadata::LogType::kCompactFiles) {
+      metadata::CompactionEntry entry;
+      if (!entry.UnPack(&buffer)) {
+        return Truncate(offset);
+      }
+
+      for (auto id : entry.outputs) {
+        files_[id] = entry.rank;
+        max_file_ = std::max(max_file_, id);
+      }
+      for (auto id : entry.victims) {
+        files_.erase(id);
+      }
+      continue;
+    }
+
     metadata::LogEntry logEntry;
     if (!logEntry.UnPack(&buffer)) {
-      PEDRODB_FATAL("failed to open db");
+      return Truncate(offset);
     }
 
+    max_file_ = std::max(max_file_, logEntry.id);
     if (logEntry.type == metadata::LogType::kCreateFile) {
-      files_.emplace(logEntry.id);
+      files_[logEntry.id] = logEntry.id;
     } else {
       files_.erase(logEntry.id);
     }
@@ -34,6 +57,17 @@ Status MetadataManager::Recovery() {
   return Status::kOk;
 }
 
+// the log entry at `offset` is torn by a crash, drop it.
+Status MetadataManager::Truncate(size_t offset) {
+  PEDRODB_WARN("drop incomplete metadata log at offset {}", offset);
+  if (::ftruncate(file_.Descriptor(), offset) < 0 ||
+      ::lseek(file_.Descriptor(), offset, SEEK_SET) < 0) {
+    PEDRODB_ERROR("failed to truncate metadata: {}", Error{errno});
+    return Status::kIOError;
+  }
+  return Status::kOk;
+}
+
 Status MetadataManager::CreateDatabase() {
   metadata::Header header;
   header.name = name_;
@@ -80,7 +114,8 @@ Status MetadataManager::CreateFile(file_id_t id) {
   if (files_.count(id)) {
     return Status::kOk;
   }
-  files_.emplace(id);
+  files_[id] = id;
+  max_file_ = std::max(max_file_, id);
 
   metadata::LogEntry entry;
   entry.type = metadata::LogType::kCreateFile;
@@ -96,6 +131,54 @@ Status MetadataManager::CreateFile(file_id_t id) {
   return Status::kOk;
 }
 
+Status MetadataManager::CompactFiles(const std::vector<file_id_t>& outputs,
+                                     file_id_t rank,
+                                     const std::vector<file_id_t>& victims) {
+  auto lock = AcquireLock();
+
+  metadata::CompactionEntry entry;
+  entry.rank = rank;
+  entry.outputs = outputs;
+  entry.victims = victims;
+
+  ArrayBuffer slice(entry.SizeOf());
+  entry.Pack(&slice);
+  slice.Retrieve(&file_);
+
+  if (file_.Sync() != Error::kOk) {
+    return Status::kIOError;
+  }
+
+  for (auto id : outputs) {
+    files_[id] = rank;
+  }
+  for (auto id : victims) {
+    files_.erase(id);
+  }
+  return Status::kOk;
+}
+
+std::vector<file_id_t> MetadataManager::GetFiles() const noexcept {
+  auto lock = AcquireLock();
+  std::vector<std::pair<file_id_t, file_id_t>> ranks;
+  for (auto [id, rank] : files_) {
+    ranks.emplace_back(rank, id);
+  }
+  std::sort(ranks.begin(), ranks.end());
+
+  std::vector<file_id_t> files;
+  for (auto [rank, id] : ranks) {
+    files.emplace_back(id);
+  }
+  return files;
+}
+
+file_id_t MetadataManager::GetRank(file_id_t id) const noexcept {
+  auto lock = AcquireLock();
+  auto it = files_.find(id);
+  return it == files_.end() ? id : it->second;
+}
+
 Status MetadataManager::DeleteFile(file_id_t id) {
   auto lock = AcquireLock();
   auto it = files_.find(id);
@@ -125,4 +208,8 @@ std::string MetadataManager::GetDataFilePath(file_id_t id) const noexcept {
 std::string MetadataManager::GetIndexFilePath(file_id_t id) const noexcept {
   return fmt::format("{}.{}.index", name_, id);
 }
+
+std::string MetadataManager::GetCheckpointFilePath() const noexcept {
+  return fmt::format("{}.checkpoint", name_);
+}
 }  // namespace pedrodb
\ No newline at end of file
@@ -0,0 +1,44 @@
+#include "pedrodb/perf_context.h"
+
+#include <pedrolib/format/formatter.h>
+#include <string_view>
+#include <utility>
+
+namespace pedrodb {
+
+std::string PerfContext::ToString() const {
+  const std::pair<std::string_view, uint64_t> fields[] = {
+      {"index_lookup_count", index_lookup_count},
+      {"index_lookup_nanos", index_lookup_nanos},
+      {"acquire_file_count", acquire_file_count},
+      {"acquire_file_nanos", acquire_file_nanos},
+      {"file_open_count", file_open_count},
+      {"block_cache_hit_count", block_cache_hit_count},
+      {"block_cache_miss_count", block_cache_miss_count},
+      {"block_cache_wait_count", block_cache_wait_count},
+      {"block_read_count", block_read_count},
+      {"block_read_bytes", block_read_bytes},
+      {"block_read_nanos", block_read_nanos},
+      {"validate_nanos", validate_nanos},
+      {"uncompress_nanos", uncompress_nanos},
+      {"compress_nanos", compress_nanos},
+      {"append_lock_nanos", append_lock_nanos},
+      {"append_copy_nanos", append_copy_nanos},
+      {"append_bytes", append_bytes},
+      {"index_update_count", index_update_count},
+      {"index_update_nanos", index_update_nanos},
+  };
+
+  std::string out;
+  for (auto [name, value] : fields) {
+    if (value == 0) {
+      continue;
+    }
+    if (!out.empty()) {
+      out += ", ";
+    }
+    out += fmt::format("{} = {}", name, value);
+  }
+  return out;
+}
+}  // namespace pedrodb
@@ -0,0 +1,126 @@
+#include "pedrodb/rate_limiter.h"
+
+#include <algorithm>
+
+namespace pedrodb {
+
+RateLimiter::RateLimiter(size_t bytes_per_second, bool auto_tune)
+    : bytes_per_second_(std::max<size_t>(bytes_per_second, 1)),
+      burst_(std::max<int64_t>(
+          bytes_per_second_ * kBurstPeriod.count() / 1000, 1)),
+      auto_tune_(auto_tune),
+      available_(burst_),
+      refilled_at_(Clock::now()),
+      tuned_at_(refilled_at_) {}
+
+double RateLimiter::GetCompactionRatio() const noexcept {
+  std::unique_lock lock{mu_};
+  return compaction_ratio_;
+}
+
+void RateLimiter::Refill(Clock::time_point now) {
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      now - refilled_at_);
+  int64_t bytes = static_cast<int64_t>(bytes_per_second_) * elapsed.count() /
+                  1000000;
+  if (bytes > 0) {
+    refilled_at_ = now;
+    available_ = std::min(available_ + bytes, burst_);
+  }
+  // foreground io can borrow one burst at most, so the background is never
+  // starved for long.
+  available_ -= foreground_bytes_.exchange(0, std::memory_order_relaxed);
+  available_ = std::max(available_, -burst_);
+
+  if (auto_tune_ && now - tuned_at_ >= kTunePeriod) {
+    Tune(now);
+  }
+}
+
+// halves the compaction ratio if the foreground latency is twice as the
+// baseline, otherwise grows it back slowly.
+void RateLimiter::Tune(Clock::time_point now) {
+  tuned_at_ = now;
+  auto count = latency_count_.exchange(0, std::memory_order_relaxed);
+  auto sum = latency_sum_.exchange(0, std::memory_order_relaxed);
+  if (count == 0) {
+    compaction_ratio_ = std::min(compaction_ratio_ * 1.25, 1.0);
+    return;
+  }
+
+  double latency = static_cast<double>(sum) / count;
+  if (baseline_latency_ == 0 || latency < baseline_latency_) {
+    baseline_latency_ = latency;
+  } else {
+    // forget the baseline slowly, the load may change.
+    baseline_latency_ *= 1.01;
+  }
+
+  if (latency > baseline_latency_ * 2) {
+    compaction_ratio_ = std::max(compaction_ratio_ / 2, kMinCompactionRatio);
+  } else {
+    compaction_ratio_ = std::min(compaction_ratio_ * 1.25, 1.0);
+  }
+}
+
+void RateLimiter::Grant() {
+  bool granted = false;
+  for (auto queue : {&flush_queue_, &compaction_queue_}) {
+    while (!queue->empty() && queue->front()->bytes <= available_) {
+      available_ -= queue->front()->bytes;
+      queue->front()->granted = true;
+      queue->pop_front();
+      granted = true;
+    }
+
+    // the lower priority waits until the higher one is drained.
+    if (!queue->empty()) {
+      break;
+    }
+  }
+
+  if (granted) {
+    cv_.notify_all();
+  }
+}
+
+void RateLimiter::Request(size_t bytes, IOPriority priority) {
+  if (priority == IOPriority::kForeground) {
+    foreground_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    return;
+  }
+
+  std::unique_lock lock{mu_};
+  while (bytes > 0) {
+    // compaction pays more for the same bytes if it has been slowed down.
+    double ratio = 1.0;
+    if (priority == IOPriority::kCompaction) {
+      ratio = compaction_ratio_;
+    }
+
+    auto n = std::min<size_t>(bytes, std::max<int64_t>(burst_ * ratio, 1));
+    bytes -= n;
+
+    Waiter waiter{std::min<int64_t>(n / ratio, burst_), false};
+    if (priority == IOPriority::kCompaction) {
+      compaction_queue_.push_back(&waiter);
+    } else {
+      flush_queue_.push_back(&waiter);
+    }
+
+    for (;;) {
+      Refill(Clock::now());
+      Grant();
+      if (waiter.granted) {
+        break;
+      }
+
+      int64_t deficit = std::max<int64_t>(waiter.bytes - available_, 1);
+      auto wait = std::chrono::microseconds(deficit * 1000000 /
+                                            bytes_per_second_);
+      cv_.wait_for(lock, std::max<Clock::duration>(
+                             wait, std::chrono::milliseconds(1)));
+    }
+  }
+}
+}  // namespace pedrodb
@@ -41,6 +41,46 @@ Status SegmentDB::Get(const ReadOptions& options, std::string_view key,
   return GetDB(Hash(key))->Get(options, key, value);
 }
 
+Status SegmentDB::MultiGet(const ReadOptions& options,
+                           const std::vector<std::string_view>& keys,
+                           std::vector<std::string>* values,
+                           std::vector<Status>* status) {
+  values->clear();
+  values->resize(keys.size());
+  status->assign(keys.size(), Status::kNotFound);
+
+  std::vector<std::vector<size_t>> groups(segments_.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    groups[Hash(keys[i]) % segments_.size()].emplace_back(i);
+  }
+
+  std::vector<std::string_view> sub_keys;
+  std::vector<std::string> sub_values;
+  std::vector<Status> sub_status;
+  for (size_t i = 0; i < segments_.size(); ++i) {
+    if (groups[i].empty()) {
+      continue;
+    }
+
+    sub_keys.clear();
+    for (auto k : groups[i]) {
+      sub_keys.emplace_back(keys[k]);
+    }
+
+    auto stat =
+        segments_[i]->MultiGet(options, sub_keys, &sub_values, &sub_status);
+    if (stat != Status::kOk) {
+      return stat;
+    }
+
+    for (size_t j = 0; j < groups[i].size(); ++j) {
+      (*values)[groups[i][j]] = std::move(sub_values[j]);
+      (*status)[groups[i][j]] = sub_status[j];
+    }
+  }
+  return Status::kOk;
+}
+
 Status SegmentDB::Put(const WriteOptions& options, std::string_view key,
                       std::string_view value) {
   return GetDB(Hash(key))->Put(options, key, value);
@@ -50,6 +90,49 @@ Status SegmentDB::Delete(const WriteOptions& options, std::string_view key) {
   return GetDB(Hash(key))->Delete(options, key);
 }
 
+void SegmentDB::GetAsync(const ReadOptions& options, std::string key,
+                         GetCallback callback) {
+  auto db = GetDB(Hash(key));
+  db->GetAsync(options, std::move(key), std::move(callback));
+}
+
+void SegmentDB::PutAsync(const WriteOptions& options, std::string key,
+                         std::string value, WriteCallback callback) {
+  auto db = GetDB(Hash(key));
+  db->PutAsync(options, std::move(key), std::move(value), std::move(callback));
+}
+
+void SegmentDB::DeleteAsync(const WriteOptions& options, std::string key,
+                            WriteCallback callback) {
+  auto db = GetDB(Hash(key));
+  db->DeleteAsync(options, std::move(key), std::move(callback));
+}
+
+// The batch is split by segment, it is only atomic within each segment.
+Status SegmentDB::Write(const WriteOptions& options, WriteBatch* batch) {
+  std::vector<WriteBatch> batches(segments_.size());
+  for (auto& update : *batch) {
+    auto& b = batches[Hash(update.key) % segments_.size()];
+    if (update.type == record::Type::kSet) {
+      b.Put(update.key, update.value);
+    } else {
+      b.Delete(update.key);
+    }
+  }
+
+  for (size_t i = 0; i < segments_.size(); ++i) {
+    if (batches[i].Count() == 0) {
+      continue;
+    }
+
+    auto status = segments_[i]->Write(options, &batches[i]);
+    if (status != Status::kOk) {
+      return status;
+    }
+  }
+  return Status::kOk;
+}
+
 Status SegmentDB::Compact() {
   Latch latch(segments_.size());
   for (auto& segment : segments_) {
@@ -74,6 +157,22 @@ Status SegmentDB::Flush() {
   return Status::kOk;
 }
 
+// The numeric properties are summed over segments, the statistics are shared
+// by segments.
+Status SegmentDB::GetProperty(std::string_view name, std::string* value) {
+  uint64_t sum = 0;
+  for (auto& segment : segments_) {
+    uint64_t n = 0;
+    if (segment->GetIntProperty(name, &n) != Status::kOk) {
+      return segments_.front()->GetProperty(name, value);
+    }
+    sum += n;
+  }
+
+  *value = std::to_string(sum);
+  return Status::kOk;
+}
+
 Status SegmentDB::GetIterator(EntryIterator::Ptr* iterator) {
   struct IteratorImpl : public EntryIterator {
     std::vector<std::weak_ptr<DB>> db;
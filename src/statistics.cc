@@ -0,0 +1,205 @@
+#include "pedrodb/statistics.h"
+
+#include <pedrolib/format/formatter.h>
+#include <algorithm>
+#include <cmath>
+
+namespace pedrodb {
+
+static constexpr std::string_view kTickerNames[] = {
+    "pedrodb.gets",
+    "pedrodb.multiget.keys",
+    "pedrodb.puts",
+    "pedrodb.deletes",
+    "pedrodb.writes",
+    "pedrodb.bytes.read",
+    "pedrodb.bytes.written",
+    "pedrodb.inline.hits",
+    "pedrodb.row.cache.hits",
+    "pedrodb.row.cache.misses",
+    "pedrodb.block.cache.hits",
+    "pedrodb.block.cache.misses",
+    "pedrodb.block.cache.waits",
+    "pedrodb.disk.bytes.read",
+    "pedrodb.compactions",
+    "pedrodb.compaction.bytes.written",
+    "pedrodb.syncs",
+    "pedrodb.file.rollovers",
+};
+
+static constexpr std::string_view kHistogramNames[] = {
+    "pedrodb.get.micros",   "pedrodb.multiget.micros",
+    "pedrodb.put.micros",   "pedrodb.delete.micros",
+    "pedrodb.write.micros", "pedrodb.sync.micros",
+    "pedrodb.compaction.micros",
+};
+
+static_assert(std::size(kTickerNames) ==
+              static_cast<size_t>(Ticker::kTickerCount));
+static_assert(std::size(kHistogramNames) ==
+              static_cast<size_t>(Histogram::kHistogramCount));
+
+Statistics::Statistics() : shards_(std::make_unique<Shard[]>(kShards)) {}
+
+size_t Statistics::BucketOf(uint64_t nanos) noexcept {
+  if (nanos < kSubBuckets) {
+    return nanos;
+  }
+
+  size_t bit = 63 - __builtin_clzll(nanos);
+  size_t bucket = (bit - kSubBucketBits + 1) * kSubBuckets +
+                  ((nanos >> (bit - kSubBucketBits)) & (kSubBuckets - 1));
+  return std::min(bucket, kBuckets - 1);
+}
+
+uint64_t Statistics::LowerBoundOf(size_t bucket) noexcept {
+  if (bucket < kSubBuckets) {
+    return bucket;
+  }
+
+  size_t bit = bucket / kSubBuckets + kSubBucketBits - 1;
+  return (kSubBuckets + bucket % kSubBuckets) << (bit - kSubBucketBits);
+}
+
+Statistics::Shard& Statistics::LocalShard() noexcept {
+  static std::atomic<size_t> threads{};
+  thread_local size_t index =
+      threads.fetch_add(1, std::memory_order_relaxed) % kShards;
+  return shards_[index];
+}
+
+void Statistics::Measure(Histogram histogram,
+                         Clock::duration latency) noexcept {
+  auto nanos = static_cast<uint64_t>(std::max<int64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count(),
+      0));
+
+  auto& h = LocalShard().histograms[static_cast<size_t>(histogram)];
+  h.count.fetch_add(1, std::memory_order_relaxed);
+  h.sum.fetch_add(nanos, std::memory_order_relaxed);
+  h.buckets[BucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+
+  uint64_t max = h.max.load(std::memory_order_relaxed);
+  while (nanos > max &&
+         !h.max.compare_exchange_weak(max, nanos, std::memory_order_relaxed)) {
+  }
+}
+
+uint64_t Statistics::GetTicker(Ticker ticker) const noexcept {
+  uint64_t n = 0;
+  for (size_t i = 0; i < kShards; ++i) {
+    n += shards_[i]
+             .tickers[static_cast<size_t>(ticker)]
+             .load(std::memory_order_relaxed);
+  }
+  return n;
+}
+
+HistogramData Statistics::GetHistogram(Histogram histogram) const noexcept {
+  uint64_t count = 0;
+  uint64_t sum = 0;
+  uint64_t max = 0;
+  std::array<uint64_t, kBuckets> buckets{};
+  for (size_t i = 0; i < kShards; ++i) {
+    auto& h = shards_[i].histograms[static_cast<size_t>(histogram)];
+    count += h.count.load(std::memory_order_relaxed);
+    sum += h.sum.load(std::memory_order_relaxed);
+    max = std::max(max, h.max.load(std::memory_order_relaxed));
+    for (size_t k = 0; k < kBuckets; ++k) {
+      buckets[k] += h.buckets[k].load(std::memory_order_relaxed);
+    }
+  }
+
+  HistogramData data;
+  data.count = count;
+  data.max = max / 1000.0;
+  if (count == 0) {
+    return data;
+  }
+  data.average = static_cast<double>(sum) / count / 1000.0;
+
+  // interpolates linearly in the bucket of the rank.
+  auto percentile = [&](double p) {
+    auto rank = static_cast<uint64_t>(std::ceil(p * count));
+    uint64_t seen = 0;
+    for (size_t k = 0; k < kBuckets; ++k) {
+      if (seen + buckets[k] < rank) {
+        seen += buckets[k];
+        continue;
+      }
+
+      double lower = LowerBoundOf(k);
+      double upper = k + 1 < kBuckets ? LowerBoundOf(k + 1) : max;
+      double nanos = lower + (upper - lower) * (rank - seen) / buckets[k];
+      return std::min<double>(nanos, max) / 1000.0;
+    }
+    return max / 1000.0;
+  };
+
+  data.p50 = percentile(0.5);
+  data.p99 = percentile(0.99);
+  data.p999 = percentile(0.999);
+  return data;
+}
+
+void Statistics::Reset() noexcept {
+  for (size_t i = 0; i < kShards; ++i) {
+    for (auto& ticker : shards_[i].tickers) {
+      ticker.store(0, std::memory_order_relaxed);
+    }
+    for (auto& h : shards_[i].histograms) {
+      h.count.store(0, std::memory_order_relaxed);
+      h.sum.store(0, std::memory_order_relaxed);
+      h.max.store(0, std::memory_order_relaxed);
+      for (auto& bucket : h.buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+}
+
+std::string_view Statistics::NameOf(Ticker ticker) noexcept {
+  return kTickerNames[static_cast<size_t>(ticker)];
+}
+
+std::string_view Statistics::NameOf(Histogram histogram) noexcept {
+  return kHistogramNames[static_cast<size_t>(histogram)];
+}
+
+static std::string FormatHistogram(const HistogramData& data) {
+  return fmt::format(
+      "count {} avg {:.2f} p50 {:.2f} p99 {:.2f} p999 {:.2f} max {:.2f}",
+      data.count, data.average, data.p50, data.p99, data.p999, data.max);
+}
+
+bool Statistics::GetProperty(std::string_view name, std::string* value) const {
+  for (size_t i = 0; i < kTickers; ++i) {
+    if (kTickerNames[i] == name) {
+      *value = std::to_string(GetTicker(static_cast<Ticker>(i)));
+      return true;
+    }
+  }
+
+  for (size_t i = 0; i < kHistograms; ++i) {
+    if (kHistogramNames[i] == name) {
+      *value = FormatHistogram(GetHistogram(static_cast<Histogram>(i)));
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string Statistics::ToString() const {
+  std::string out;
+  for (size_t i = 0; i < kTickers; ++i) {
+    out += fmt::format("{} {}\n", kTickerNames[i],
+                       GetTicker(static_cast<Ticker>(i)));
+  }
+  for (size_t i = 0; i < kHistograms; ++i) {
+    out += fmt::format(
+        "{} {}\n", kHistogramNames[i],
+        FormatHistogram(GetHistogram(static_cast<Histogram>(i))));
+  }
+  return out;
+}
+}  // namespace pedrodb
@@ -0,0 +1,184 @@
+#include <pedrodb/db.h>
+#include <chrono>
+#include <future>
+#include <thread>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+
+static Options TestOptions(std::shared_ptr<Executor> io_executor,
+                           Statistics::Ptr statistics = nullptr) {
+  // outlives the databases, the background tasks of a closed one may still
+  // hold its files.
+  static auto executor = std::make_shared<DefaultExecutor>(1);
+
+  Options options;
+  options.executor = executor;
+  options.io_executor = std::move(io_executor);
+  options.checkpoint.enable = false;
+  options.statistics = std::move(statistics);
+  return options;
+}
+
+static std::thread::id ThreadOf(Executor* executor) {
+  std::promise<std::thread::id> id;
+  executor->Schedule([&] { id.set_value(std::this_thread::get_id()); });
+  return id.get_future().get();
+}
+
+// the results of the async calls, and the threads which ran the callbacks.
+struct WriteResult {
+  std::promise<std::pair<Status, std::thread::id>> promise;
+
+  DB::WriteCallback Callback() {
+    return [this](Status status) {
+      promise.set_value({status, std::this_thread::get_id()});
+    };
+  }
+};
+
+struct GetResult {
+  std::promise<std::tuple<Status, std::string, std::thread::id>> promise;
+
+  DB::GetCallback Callback() {
+    return [this](Status status, std::string value) {
+      promise.set_value({status, std::move(value), std::this_thread::get_id()});
+    };
+  }
+};
+
+// the callbacks get the results of the calls, on the io executor.
+static void TestCallbacks() {
+  auto io_executor = std::make_shared<DefaultExecutor>(1);
+  auto io_thread = ThreadOf(io_executor.get());
+  auto path = TempDir("async") + "/t.db";
+
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(io_executor), path, &db));
+  WriteOptions wo;
+  ReadOptions ro;
+
+  WriteResult put;
+  db->PutAsync(wo, "key", "value", put.Callback());
+  auto put_result = put.promise.get_future().get();
+  PEDRODB_CHECK(put_result.first == Status::kOk);
+  PEDRODB_CHECK(put_result.second == io_thread);
+  PEDRODB_CHECK(Get(db.get(), "key") == "value");
+
+  GetResult get;
+  db->GetAsync(ro, "key", get.Callback());
+  auto [get_status, value, get_thread] = get.promise.get_future().get();
+  PEDRODB_CHECK(get_status == Status::kOk);
+  PEDRODB_CHECK(value == "value");
+  PEDRODB_CHECK(get_thread == io_thread);
+
+  WriteResult del;
+  db->DeleteAsync(wo, "key", del.Callback());
+  auto del_result = del.promise.get_future().get();
+  PEDRODB_CHECK(del_result.first == Status::kOk);
+  PEDRODB_CHECK(del_result.second == io_thread);
+
+  GetResult missing;
+  db->GetAsync(ro, "key", missing.Callback());
+  auto missing_result = missing.promise.get_future().get();
+  PEDRODB_CHECK(std::get<0>(missing_result) == Status::kNotFound);
+  PEDRODB_CHECK(std::get<2>(missing_result) == io_thread);
+
+  // the last task may still hold the database, it is closed before the
+  // executor goes.
+  db.reset();
+  ThreadOf(io_executor.get());
+}
+
+// the pending calls keep the database alive after the caller drops it, and
+// their writes are found after reopening.
+static void TestKeepAlive() {
+  auto io_executor = std::make_shared<DefaultExecutor>(1);
+  auto path = TempDir("async_keep_alive") + "/t.db";
+
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(io_executor), path, &db));
+
+  // the io thread is held until the database is dropped.
+  std::promise<void> hold;
+  io_executor->Schedule([held = hold.get_future().share()] { held.wait(); });
+
+  WriteResult put;
+  GetResult get;
+  db->PutAsync({}, "key", "value", put.Callback());
+  db->GetAsync({}, "key", get.Callback());
+
+  std::weak_ptr<DB> weak = db;
+  db.reset();
+  PEDRODB_CHECK(!weak.expired());
+  hold.set_value();
+
+  PEDRODB_CHECK(put.promise.get_future().get().first == Status::kOk);
+  auto get_result = get.promise.get_future().get();
+  PEDRODB_CHECK(std::get<0>(get_result) == Status::kOk);
+  PEDRODB_CHECK(std::get<1>(get_result) == "value");
+
+  // the last reference goes with the finished tasks.
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!weak.expired()) {
+    PEDRODB_CHECK(std::chrono::steady_clock::now() < deadline);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(io_executor), path, &db));
+  PEDRODB_CHECK(Get(db.get(), "key") == "value");
+}
+
+static std::string Property(DB* db, std::string_view name) {
+  std::string value;
+  PEDRODB_CHECK_OK(db->GetProperty(name, &value));
+  return value;
+}
+
+// the count of a histogram, which is formatted like "count 1 avg ...".
+static uint64_t CountOf(DB* db, std::string_view name) {
+  auto value = Property(db, name);
+  PEDRODB_CHECK(value.rfind("count ", 0) == 0);
+  return std::stoull(value.substr(6));
+}
+
+// an async delete counts as a delete, not as a put.
+static void TestTickers() {
+  auto io_executor = std::make_shared<DefaultExecutor>(1);
+  auto path = TempDir("async_tickers") + "/t.db";
+
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(DB::Open(
+      TestOptions(io_executor, std::make_shared<Statistics>()), path, &db));
+  PEDRODB_CHECK_OK(db->Put({}, "a", "1"));
+  PEDRODB_CHECK_OK(db->Put({}, "b", "1"));
+  PEDRODB_CHECK_OK(db->Delete({}, "a"));
+
+  WriteResult del;
+  db->DeleteAsync({}, "b", del.Callback());
+  PEDRODB_CHECK(del.promise.get_future().get().first == Status::kOk);
+
+  WriteBatch batch;
+  batch.Put("c", "1");
+  batch.Delete("d");
+  PEDRODB_CHECK_OK(db->Write({}, &batch));
+
+  PEDRODB_CHECK(Property(db.get(), "pedrodb.puts") == "2");
+  PEDRODB_CHECK(Property(db.get(), "pedrodb.deletes") == "2");
+  PEDRODB_CHECK(Property(db.get(), "pedrodb.writes") == "1");
+  PEDRODB_CHECK(CountOf(db.get(), "pedrodb.put.micros") == 2);
+  PEDRODB_CHECK(CountOf(db.get(), "pedrodb.delete.micros") == 2);
+  PEDRODB_CHECK(CountOf(db.get(), "pedrodb.write.micros") == 1);
+
+  db.reset();
+  ThreadOf(io_executor.get());
+}
+
+int main() {
+  return RunTests({
+      {"Async.Callbacks", TestCallbacks},
+      {"Async.KeepAlive", TestKeepAlive},
+      {"Async.Tickers", TestTickers},
+  });
+}
@@ -0,0 +1,111 @@
+#include <pedrodb/cache/block_arena.h>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+
+constexpr size_t kBlockBytes = 4096;
+
+// the blocks beyond the arena come from the heap, and a released arena block
+// is taken again.
+static void TestExhaustion() {
+  const size_t n = 4;
+  BlockArena arena(kBlockBytes, n);
+
+  std::vector<BlockArena::Ptr> blocks;
+  for (size_t i = 0; i < n; ++i) {
+    blocks.emplace_back(arena.Allocate());
+  }
+  std::vector<char*> addresses;
+  for (auto& block : blocks) {
+    addresses.emplace_back(block->data());
+  }
+  std::sort(addresses.begin(), addresses.end());
+  char* begin = addresses.front();
+  char* end = begin + n * kBlockBytes;
+  for (size_t i = 0; i < n; ++i) {
+    PEDRODB_CHECK(addresses[i] == begin + i * kBlockBytes);
+  }
+  auto in_arena = [&](const BlockArena::Ptr& block) {
+    return block->data() >= begin && block->data() < end;
+  };
+
+  auto heap = arena.Allocate();
+  PEDRODB_CHECK(!in_arena(heap));
+  PEDRODB_CHECK(heap->size() == kBlockBytes);
+
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    memset(blocks[i]->data(), static_cast<int>(i), kBlockBytes);
+  }
+  memset(heap->data(), 0xff, kBlockBytes);
+
+  // the copies share the block, it is free after the last one is dropped.
+  char* released = blocks[1]->data();
+  auto copy = blocks[1];
+  blocks[1] = nullptr;
+  auto other = arena.Allocate();
+  PEDRODB_CHECK(!in_arena(other));
+  PEDRODB_CHECK(copy->data()[kBlockBytes - 1] == 1);
+
+  copy = nullptr;
+  auto reused = arena.Allocate();
+  PEDRODB_CHECK(reused->data() == released);
+
+  heap = nullptr;
+  other = nullptr;
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    if (blocks[i] != nullptr) {
+      PEDRODB_CHECK(blocks[i]->data()[0] == static_cast<char>(i));
+    }
+  }
+}
+
+// an empty arena allocates every block from the heap.
+static void TestEmpty() {
+  BlockArena arena(kBlockBytes, 0);
+  auto x = arena.Allocate();
+  auto y = arena.Allocate();
+  PEDRODB_CHECK(x != nullptr && y != nullptr && x->data() != y->data());
+  memset(x->data(), 1, kBlockBytes);
+  memset(y->data(), 2, kBlockBytes);
+  PEDRODB_CHECK(x->data()[kBlockBytes - 1] == 1);
+}
+
+// the threads hold more blocks than the arena has, no block is shared by
+// two of them.
+static void TestConcurrent() {
+  BlockArena arena(kBlockBytes, 64);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&, t] {
+      std::vector<BlockArena::Ptr> held;
+      for (int i = 0; i < 100000; ++i) {
+        auto block = arena.Allocate();
+        memset(block->data(), t, 64);
+        held.emplace_back(std::move(block));
+        if (held.size() > 12) {
+          auto& oldest = held.front();
+          for (int k = 0; k < 64; ++k) {
+            PEDRODB_CHECK(oldest->data()[k] == static_cast<char>(t));
+          }
+          held.erase(held.begin());
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+int main() {
+  return RunTests({
+      {"BlockArena.Exhaustion", TestExhaustion},
+      {"BlockArena.Empty", TestEmpty},
+      {"BlockArena.Concurrent", TestConcurrent},
+  });
+}
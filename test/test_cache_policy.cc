@@ -0,0 +1,129 @@
+#include <pedrodb/cache/policy_cache.h>
+#include <map>
+#include <random>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+
+// the cache never returns a value other than the last one put.
+template <class Cache>
+static void TestModel() {
+  Cache cache(100);
+  std::map<int, int> model;
+  std::mt19937 rng(1);
+  for (int i = 0; i < 200000; ++i) {
+    int key = static_cast<int>(rng() % 300);
+    int value = 0;
+    switch (rng() % 3) {
+      case 0:
+        if (cache.Get(key, value)) {
+          PEDRODB_CHECK(model.count(key) && model[key] == value);
+        }
+        break;
+      case 1:
+        value = static_cast<int>(rng());
+        cache.Put(key, value, 1 + rng() % 5);
+        model[key] = value;
+        break;
+      default:
+        if (cache.Remove(key, value)) {
+          PEDRODB_CHECK(model[key] == value);
+        }
+        model.erase(key);
+        break;
+    }
+  }
+}
+
+// an entry larger than the cache drops the old value of its key.
+template <class Cache>
+static void TestOversizedPut() {
+  Cache cache(10);
+  cache.Put(1, 1);
+  cache.Put(2, 2);
+  cache.Put(1, 3, 11);
+
+  int value = 0;
+  PEDRODB_CHECK(!cache.Get(1, value));
+  PEDRODB_CHECK(cache.Get(2, value) && value == 2);
+}
+
+// the hand skips the referenced entries once.
+static void TestClockSecondChance() {
+  ClockCache<int, int> cache(3);
+  cache.Put(1, 1);
+  cache.Put(2, 2);
+  cache.Put(3, 3);
+
+  int value = 0;
+  PEDRODB_CHECK(cache.Get(1, value));
+  cache.Put(4, 4);
+  PEDRODB_CHECK(cache.Get(1, value) && value == 1);
+  PEDRODB_CHECK(!cache.Get(2, value));
+  PEDRODB_CHECK(cache.Get(3, value) && cache.Get(4, value));
+}
+
+// the entries hit again survive a scan, which flushes LRU.
+template <class Cache>
+static size_t HotAfterScan() {
+  Cache cache(100);
+  const int hot = 50;
+  int value = 0;
+  for (int i = 0; i < hot; ++i) {
+    cache.Put(i, i);
+  }
+  for (int i = 0; i < hot; ++i) {
+    PEDRODB_CHECK(cache.Get(i, value));
+  }
+  for (int i = 0; i < 1000; ++i) {
+    cache.Put(1000 + i, i);
+  }
+
+  size_t kept = 0;
+  for (int i = 0; i < hot; ++i) {
+    kept += cache.Get(i, value);
+  }
+  return kept;
+}
+
+static void TestS3FIFOScan() {
+  PEDRODB_CHECK((HotAfterScan<S3FIFOCache<int, int>>() == 50));
+  PEDRODB_CHECK((HotAfterScan<LRUCache<int, int>>() == 0));
+}
+
+// the policy is picked at runtime.
+static void TestPolicyCache() {
+  for (auto policy :
+       {CachePolicy::kLRU, CachePolicy::kClock, CachePolicy::kS3FIFO}) {
+    PolicyCache<int, int> cache(policy, 4);
+    for (int i = 0; i < 4; ++i) {
+      cache.SegmentAdd(10);
+    }
+
+    int value = 0;
+    cache.Put(1, 2);
+    PEDRODB_CHECK(cache.Get(1, value) && value == 2);
+    for (int i = 100; i < 1000; ++i) {
+      cache.Put(i, i);
+    }
+    PEDRODB_CHECK(cache.Remove(999, value) && value == 999);
+    PEDRODB_CHECK(!cache.Get(999, value));
+  }
+}
+
+int main() {
+  return RunTests({
+      {"CachePolicy.LRUModel", TestModel<LRUCache<int, int>>},
+      {"CachePolicy.ClockModel", TestModel<ClockCache<int, int>>},
+      {"CachePolicy.S3FIFOModel", TestModel<S3FIFOCache<int, int>>},
+      {"CachePolicy.LRUOversizedPut", TestOversizedPut<LRUCache<int, int>>},
+      {"CachePolicy.ClockOversizedPut",
+       TestOversizedPut<ClockCache<int, int>>},
+      {"CachePolicy.S3FIFOOversizedPut",
+       TestOversizedPut<S3FIFOCache<int, int>>},
+      {"CachePolicy.ClockSecondChance", TestClockSecondChance},
+      {"CachePolicy.S3FIFOScan", TestS3FIFOScan},
+      {"CachePolicy.PolicyCache", TestPolicyCache},
+  });
+}
@@ -0,0 +1,114 @@
+#include <pedrodb/db.h>
+#include <map>
+#include <optional>
+#include <random>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+
+constexpr size_t kValueBytes = 64 << 10;
+
+using Model = std::map<std::string, std::optional<std::string>>;
+
+static std::string ValueOf(size_t seed, size_t size) {
+  std::string value(size, '\0');
+  std::mt19937 rng(seed);
+  for (auto& c : value) {
+    c = static_cast<char>(rng());
+  }
+  return value;
+}
+
+static Options TestOptions() {
+  // outlives the databases, the background tasks of a closed one may still
+  // hold its files.
+  static auto executor = std::make_shared<DefaultExecutor>(1);
+
+  Options options;
+  options.executor = executor;
+  options.checkpoint.enable = true;
+  options.checkpoint.interval = Duration::Seconds(3600);
+  options.compaction.interval = Duration::Seconds(3600);
+  return options;
+}
+
+static void Verify(const std::string& path, const Model& model) {
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(), path, &db));
+  size_t live = 0;
+  for (auto& [key, value] : model) {
+    PEDRODB_CHECK(Get(db.get(), key) == value.value_or(""));
+    live += value.has_value();
+  }
+
+  std::string keys;
+  PEDRODB_CHECK_OK(db->GetProperty("pedrodb.num-keys", &keys));
+  PEDRODB_CHECK(std::stoul(keys) == live);
+}
+
+// a checkpoint older than the files, or a corrupted one, never loses the
+// records written after it.
+static void TestStaleAndCorrupt() {
+  auto dir = TempDir("checkpoint");
+  auto path = dir + "/t.db";
+  auto checkpoint = dir + "/t.checkpoint";
+
+  Model model;
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(), path, &db));
+  const size_t n = kMaxFileBytes / kValueBytes + 16;
+  for (size_t i = 0; i < n; ++i) {
+    auto key = "key" + std::to_string(i);
+    model[key] = ValueOf(i, kValueBytes);
+    PEDRODB_CHECK_OK(db->Put({}, key, *model[key]));
+  }
+  db = nullptr;
+
+  // the first file is covered.
+  auto stale = ReadFile(checkpoint);
+  PEDRODB_CHECK(!stale.empty());
+  Verify(path, model);
+
+  // the first file is compacted away after the stale checkpoint.
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(), path, &db));
+  for (size_t i = 0; i < n - 32; ++i) {
+    auto key = "key" + std::to_string(i);
+    if (i % 10 == 0) {
+      continue;
+    }
+    if (i % 3 == 0) {
+      model[key] = std::nullopt;
+      PEDRODB_CHECK_OK(db->Delete({}, key));
+    } else {
+      model[key] = ValueOf(i + n, 100);
+      PEDRODB_CHECK_OK(db->Put({}, key, *model[key]));
+    }
+  }
+  PEDRODB_CHECK_OK(db->Compact());
+  db = nullptr;
+
+  auto fresh = ReadFile(checkpoint);
+  PEDRODB_CHECK(fresh != stale);
+  Verify(path, model);
+
+  WriteFile(checkpoint, stale);
+  Verify(path, model);
+
+  // each corruption drops the whole checkpoint.
+  WriteFile(checkpoint, fresh);
+  CorruptFile(checkpoint, fresh.size() / 2);
+  Verify(path, model);
+
+  WriteFile(checkpoint, fresh.substr(0, fresh.size() - 1));
+  Verify(path, model);
+
+  WriteFile(checkpoint, "");
+  Verify(path, model);
+}
+
+int main() {
+  return RunTests({
+      {"Checkpoint.StaleAndCorrupt", TestStaleAndCorrupt},
+  });
+}
@@ -0,0 +1,86 @@
+#include <pedrodb/checkpoint_barrier.h>
+#include <atomic>
+#include <chrono>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+using namespace std::chrono_literals;
+
+// a checkpoint waits for the writes in progress, and the writes wait for the
+// checkpoint.
+static void TestExclusion() {
+  CheckpointBarrier barrier(true);
+  std::atomic<int> writes{};
+  std::atomic<bool> checkpointing{};
+
+  std::shared_lock write{barrier};
+  std::thread checkpoint([&] {
+    std::unique_lock lock{barrier};
+    checkpointing = true;
+    PEDRODB_CHECK(writes.load() == 0);
+    std::this_thread::sleep_for(50ms);
+    checkpointing = false;
+  });
+  std::this_thread::sleep_for(50ms);
+  PEDRODB_CHECK(!checkpointing.load());
+  write.unlock();
+
+  while (!checkpointing.load()) {
+    std::this_thread::yield();
+  }
+  std::thread writer([&] {
+    std::shared_lock lock{barrier};
+    PEDRODB_CHECK(!checkpointing.load());
+    writes++;
+  });
+  checkpoint.join();
+  writer.join();
+  PEDRODB_CHECK(writes.load() == 1);
+}
+
+// the writes overlap without a gap, but the checkpoints still get in.
+static void TestNoStarvation() {
+  CheckpointBarrier barrier(true);
+  std::atomic<bool> stop{};
+  std::vector<std::thread> writers;
+  for (int i = 0; i < 4; ++i) {
+    writers.emplace_back([&] {
+      while (!stop.load()) {
+        std::shared_lock lock{barrier};
+        std::this_thread::sleep_for(100us);
+      }
+    });
+  }
+
+  for (int i = 0; i < 10; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    { std::unique_lock lock{barrier}; }
+    PEDRODB_CHECK(std::chrono::steady_clock::now() - start < 1s);
+    std::this_thread::sleep_for(10ms);
+  }
+
+  stop = true;
+  for (auto& writer : writers) {
+    writer.join();
+  }
+}
+
+// a disabled barrier never blocks.
+static void TestDisabled() {
+  CheckpointBarrier barrier(false);
+  std::unique_lock checkpoint{barrier};
+  std::shared_lock write{barrier};
+  std::unique_lock another{barrier};
+}
+
+int main() {
+  return RunTests({
+      {"CheckpointBarrier.Exclusion", TestExclusion},
+      {"CheckpointBarrier.NoStarvation", TestNoStarvation},
+      {"CheckpointBarrier.Disabled", TestDisabled},
+  });
+}
@@ -0,0 +1,231 @@
+#include <pedrodb/db.h>
+#include <pedrodb/format/metadata_format.h>
+#include <pedrodb/format/record_format.h>
+#include <algorithm>
+#include <future>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <random>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+
+constexpr size_t kValueBytes = 64 << 10;
+
+using Model = std::map<std::string, std::optional<std::string>>;
+
+static std::string ValueOf(size_t seed, size_t size) {
+  std::string value(size, '\0');
+  std::mt19937 rng(seed);
+  for (auto& c : value) {
+    c = static_cast<char>(rng());
+  }
+  return value;
+}
+
+static Options TestOptions() {
+  // outlives the databases, the background tasks of a closed one may still
+  // hold its files.
+  static auto executor = std::make_shared<DefaultExecutor>(1);
+
+  Options options;
+  options.executor = executor;
+  options.checkpoint.enable = false;
+  options.compaction.interval = Duration::Seconds(3600);
+  options.statistics = std::make_shared<Statistics>();
+  return options;
+}
+
+static uint64_t Property(DB* db, std::string_view name) {
+  std::string value;
+  PEDRODB_CHECK_OK(db->GetProperty(name, &value));
+  return std::stoull(value);
+}
+
+static void Verify(DB* db, const Model& model) {
+  for (auto& [key, value] : model) {
+    PEDRODB_CHECK(Get(db, key) == value.value_or(""));
+  }
+
+  size_t count = 0;
+  EntryIterator::Ptr iterator;
+  PEDRODB_CHECK_OK(db->GetIterator(&iterator));
+  while (iterator->Valid()) {
+    auto entry = iterator->Next();
+    auto it = model.find(std::string(entry.key));
+    PEDRODB_CHECK(it != model.end() && it->second.has_value());
+    count++;
+  }
+  auto live = std::count_if(model.begin(), model.end(),
+                            [](auto& x) { return x.second.has_value(); });
+  PEDRODB_CHECK(count == static_cast<size_t>(live));
+}
+
+static std::vector<std::string> FileNames(const std::string& dir) {
+  std::vector<std::string> names;
+  for (auto& path : ListFiles(dir, "")) {
+    names.emplace_back(std::filesystem::path(path).filename().string());
+  }
+  return names;
+}
+
+// fills two files, the first one is mostly overwritten or deleted.
+static void Fill(const std::string& path, Model* model) {
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(), path, &db));
+  const size_t n = kMaxFileBytes / kValueBytes + 16;
+  for (size_t i = 0; i < n; ++i) {
+    auto key = "key" + std::to_string(i);
+    (*model)[key] = ValueOf(i, kValueBytes);
+    PEDRODB_CHECK_OK(db->Put({}, key, *(*model)[key]));
+  }
+  PEDRODB_CHECK(Property(db.get(), "pedrodb.num-files") == 2);
+
+  for (size_t i = 0; i < n - 32; ++i) {
+    if (i % 10 == 0) {
+      continue;
+    }
+    auto key = "key" + std::to_string(i);
+    if (i % 3 == 0) {
+      (*model)[key] = std::nullopt;
+      PEDRODB_CHECK_OK(db->Delete({}, key));
+    } else {
+      (*model)[key] = ValueOf(i + n, 100);
+      PEDRODB_CHECK_OK(db->Put({}, key, *(*model)[key]));
+    }
+  }
+}
+
+// compacts the database once, returns the files removed and added.
+static std::pair<std::vector<std::string>, std::vector<std::string>>
+CompactOnce(const std::string& dir, const Model& model) {
+  auto before = FileNames(dir);
+
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(), dir + "/t.db", &db));
+  PEDRODB_CHECK_OK(db->Compact());
+  PEDRODB_CHECK(Property(db.get(), "pedrodb.compactions") == 1);
+  PEDRODB_CHECK(Property(db.get(), "pedrodb.num-files") == 2);
+  Verify(db.get(), model);
+  db = nullptr;
+
+  auto after = FileNames(dir);
+  std::vector<std::string> victims;
+  std::vector<std::string> outputs;
+  std::set_difference(before.begin(), before.end(), after.begin(), after.end(),
+                      std::back_inserter(victims));
+  std::set_difference(after.begin(), after.end(), before.begin(), before.end(),
+                      std::back_inserter(outputs));
+  return {victims, outputs};
+}
+
+// the survivors of the victims are written into a dedicated output file,
+// which is smaller than the victims and survives a reopen.
+static void TestOutputFiles() {
+  auto dir = TempDir("compaction");
+  auto path = dir + "/t.db";
+
+  Model model;
+  Fill(path, &model);
+  auto [victims, outputs] = CompactOnce(dir, model);
+  PEDRODB_CHECK(!victims.empty());
+  PEDRODB_CHECK(!outputs.empty());
+  for (auto& output : outputs) {
+    PEDRODB_CHECK(std::filesystem::file_size(dir + "/" + output) <
+                  kMaxFileBytes / 2);
+  }
+
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(), path, &db));
+  Verify(db.get(), model);
+}
+
+// waits for the tasks scheduled before, such as the index files written
+// after a database is closed.
+static void Drain() {
+  std::promise<void> done;
+  TestOptions().executor->Schedule([&] { done.set_value(); });
+  done.get_future().wait();
+}
+
+// copies the files of `from` into `to`, the others in `to` are kept.
+static void CopyFiles(const std::string& from, const std::string& to,
+                      const std::vector<std::string>& names) {
+  for (auto& name : names) {
+    WriteFile(to + "/" + name, ReadFile(from + "/" + name));
+  }
+}
+
+// A crash before the compaction commits keeps the victims and ignores the
+// outputs, a crash after it ignores the victims.
+static void TestCrashAroundCommit() {
+  auto dir = TempDir("compaction_crash");
+  auto snapshot = TempDir("compaction_snapshot");
+  auto path = dir + "/t.db";
+
+  Model model;
+  Fill(path, &model);
+  Drain();
+  auto before = FileNames(dir);
+  CopyFiles(dir, snapshot, before);
+  auto [victims, outputs] = CompactOnce(dir, model);
+  PEDRODB_CHECK(!victims.empty());
+
+  // crashed after the commit but before the victims are removed.
+  DB::Ptr db;
+  CopyFiles(snapshot, dir, victims);
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(), path, &db));
+  PEDRODB_CHECK(Property(db.get(), "pedrodb.num-files") == 2);
+  Verify(db.get(), model);
+  db = nullptr;
+
+  // crashed before the commit, the outputs are left in the directory.
+  CopyFiles(snapshot, dir, before);
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(), path, &db));
+  PEDRODB_CHECK(Property(db.get(), "pedrodb.num-files") == 2);
+  Verify(db.get(), model);
+
+  // the ids of the outputs are taken again.
+  PEDRODB_CHECK_OK(db->Compact());
+  PEDRODB_CHECK(Property(db.get(), "pedrodb.compactions") == 1);
+  Verify(db.get(), model);
+  db = nullptr;
+
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(), path, &db));
+  Verify(db.get(), model);
+}
+
+// the counts of a corrupted entry may wrap if they are summed in 32 bits,
+// then it would pass the length check and allocate 4G ids.
+static void TestCorruptedCounts() {
+  metadata::CompactionEntry entry;
+  entry.rank = 1;
+  entry.victims = {2};
+
+  ArrayBuffer buffer(entry.SizeOf());
+  entry.Pack(&buffer);
+  std::string bytes(buffer.ReadIndex(), buffer.ReadableBytes());
+  {
+    ReadableView view(bytes.data(), bytes.size());
+    metadata::CompactionEntry unpacked;
+    PEDRODB_CHECK(unpacked.UnPack(&view));
+    PEDRODB_CHECK(unpacked.victims == entry.victims);
+  }
+
+  // n_outputs follows the type and the rank.
+  bytes.replace(sizeof(uint8_t) + sizeof(file_id_t), sizeof(uint32_t),
+                sizeof(uint32_t), '\xff');
+  ReadableView view(bytes.data(), bytes.size());
+  metadata::CompactionEntry unpacked;
+  PEDRODB_CHECK(!unpacked.UnPack(&view));
+}
+
+int main() {
+  return RunTests({
+      {"Compaction.OutputFiles", TestOutputFiles},
+      {"Compaction.CrashAroundCommit", TestCrashAroundCommit},
+      {"Compaction.CorruptedCounts", TestCorruptedCounts},
+  });
+}
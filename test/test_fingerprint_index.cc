@@ -0,0 +1,205 @@
+#include <pedrodb/index/segment_index.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+using namespace std::chrono_literals;
+
+// the records of the index, the matcher reads the keys from them.
+class Records {
+  mutable std::mutex mu_;
+  std::map<record::Location, std::string> keys_;
+  uint32_t offset_{};
+
+ public:
+  record::Dir Append(std::string_view key) {
+    std::unique_lock lock{mu_};
+    record::Dir dir;
+    dir.loc = record::Location(1, offset_++);
+    dir.entry_size = 1;
+    keys_[dir.loc] = key;
+    return dir;
+  }
+
+  bool Match(const record::Dir& dir, std::string_view key) const {
+    std::unique_lock lock{mu_};
+    auto it = keys_.find(dir.loc);
+    return it != keys_.end() && it->second == key;
+  }
+};
+
+// the keys "key{i}" collide by fours.
+static uint64_t CollidingHash(std::string_view key) {
+  return std::stoul(std::string(key.substr(3))) / 4 + 2;
+}
+
+static std::string KeyOf(size_t i) { return "key" + std::to_string(i); }
+
+// the colliding keys are told apart by their records, in single and batch
+// updates.
+static void TestCollisions() {
+  Records records;
+  SegmentIndex index(
+      4, [&](auto& dir, auto key) { return records.Match(dir, key); }, 0,
+      CollidingHash);
+
+  const size_t n = 1000;
+  std::vector<record::Dir> dirs(n);
+  for (size_t i = 0; i < n; ++i) {
+    dirs[i] = records.Append(KeyOf(i));
+    index.Compute(KeyOf(i), [&](auto& dir) {
+      PEDRODB_CHECK(!dir.has_value());
+      dir = dirs[i];
+    });
+  }
+
+  for (size_t i = 0; i < n; i += 2) {
+    if (i % 4 == 0) {
+      index.Compute(KeyOf(i), [&](auto& dir) { dir.reset(); });
+      continue;
+    }
+    dirs[i] = records.Append(KeyOf(i));
+    index.Compute(KeyOf(i), [&](auto& dir) {
+      PEDRODB_CHECK(dir.has_value());
+      dir = dirs[i];
+    });
+  }
+
+  // a batch updates a key twice and its colliding keys.
+  std::vector<std::string> batch = {KeyOf(1), KeyOf(0), KeyOf(1), KeyOf(3)};
+  std::vector<std::string_view> keys(batch.begin(), batch.end());
+  std::vector<record::Dir> updates;
+  for (auto& key : batch) {
+    updates.emplace_back(records.Append(key));
+  }
+  std::vector<bool> existed;
+  index.Compute(keys, [&](size_t i, auto& dir) {
+    existed.emplace_back(dir.has_value());
+    dir = updates[i];
+  });
+  PEDRODB_CHECK((existed == std::vector<bool>{true, false, true, true}));
+  dirs[1] = updates[2];
+  dirs[0] = updates[1];
+  dirs[3] = updates[3];
+
+  for (size_t i = 0; i < n; ++i) {
+    record::Dir dir;
+    bool found = index.Get(KeyOf(i), &dir);
+    if (i % 4 == 0 && i != 0) {
+      PEDRODB_CHECK(!found);
+      continue;
+    }
+    PEDRODB_CHECK(found && dir.loc == dirs[i].loc);
+  }
+  PEDRODB_CHECK(index.Size() == n - (n / 4 - 1));
+}
+
+// a slow match never blocks the writers of its segment.
+static void TestMatchWithoutLock() {
+  Records records;
+  std::atomic<bool> slow{};
+  std::atomic<bool> matching{};
+  std::atomic<bool> written{};
+  std::atomic<bool> unblocked{};
+  SegmentIndex index(
+      1,
+      [&](auto& dir, auto key) {
+        if (slow.load() && key == KeyOf(0)) {
+          matching = true;
+          for (int i = 0; i < 500 && !written.load(); ++i) {
+            std::this_thread::sleep_for(10ms);
+          }
+          unblocked = written.load();
+        }
+        return records.Match(dir, key);
+      },
+      0, CollidingHash);
+
+  auto dir = records.Append(KeyOf(0));
+  index.Compute(KeyOf(0), [&](auto& d) { d = dir; });
+
+  slow = true;
+  std::thread matcher([&] {
+    auto update = records.Append(KeyOf(0));
+    index.Compute(KeyOf(0), [&](auto& d) { d = update; });
+  });
+  while (!matching.load()) {
+    std::this_thread::sleep_for(1ms);
+  }
+
+  // a colliding key, which is written while the other is matched.
+  auto other = records.Append(KeyOf(1));
+  index.Compute(KeyOf(1), [&](auto& d) { d = other; });
+  written = true;
+  matcher.join();
+  PEDRODB_CHECK(unblocked.load());
+
+  record::Dir found;
+  PEDRODB_CHECK(index.Get(KeyOf(1), &found) && found.loc == other.loc);
+  PEDRODB_CHECK(index.Get(KeyOf(0), &found) && found.loc != dir.loc);
+  PEDRODB_CHECK(index.Size() == 2);
+}
+
+// the writers of colliding keys race with each other and the readers.
+static void TestConcurrentCollisions() {
+  Records records;
+  SegmentIndex index(
+      2, [&](auto& dir, auto key) { return records.Match(dir, key); }, 0,
+      CollidingHash);
+
+  const size_t n = 64;
+  std::atomic<bool> done{};
+  std::vector<std::thread> writers;
+  for (size_t w = 0; w < 4; ++w) {
+    writers.emplace_back([&, w] {
+      for (size_t round = 0; round < 2000; ++round) {
+        auto key = KeyOf((round * 7 + w) % n);
+        auto dir = records.Append(key);
+        index.Compute(key, [&](auto& d) {
+          if (round % 5 == 0) {
+            d.reset();
+          } else {
+            d = dir;
+          }
+        });
+      }
+    });
+  }
+
+  std::thread reader([&] {
+    for (size_t i = 0; !done.load(); ++i) {
+      record::Dir dir;
+      auto key = KeyOf(i % n);
+      if (index.Get(key, &dir)) {
+        PEDRODB_CHECK(records.Match(dir, key));
+      }
+    }
+  });
+
+  for (auto& writer : writers) {
+    writer.join();
+  }
+  done = true;
+  reader.join();
+
+  // every key has at most one dir.
+  size_t size = 0;
+  for (size_t i = 0; i < n; ++i) {
+    record::Dir dir;
+    size += index.Get(KeyOf(i), &dir);
+  }
+  PEDRODB_CHECK(index.Size() == size);
+}
+
+int main() {
+  return RunTests({
+      {"FingerprintIndex.Collisions", TestCollisions},
+      {"FingerprintIndex.MatchWithoutLock", TestMatchWithoutLock},
+      {"FingerprintIndex.ConcurrentCollisions", TestConcurrentCollisions},
+  });
+}
@@ -0,0 +1,137 @@
+#include <pedrodb/group_commit.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+using namespace std::chrono_literals;
+
+// every request returns after a sync which started after it was issued, and
+// the concurrent requests share the syncs.
+static void TestLeaderFollower() {
+  GroupCommit group;
+  std::atomic<uint64_t> started{};
+  std::atomic<uint64_t> completed{};
+
+  auto sync = [&] {
+    uint64_t id = started.fetch_add(1) + 1;
+    std::this_thread::sleep_for(10ms);
+    uint64_t last = completed.load();
+    while (last < id && !completed.compare_exchange_weak(last, id)) {
+    }
+    return Status::kOk;
+  };
+
+  const int n = 32;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < n; ++i) {
+    threads.emplace_back([&] {
+      for (int k = 0; k < 10; ++k) {
+        uint64_t before = started.load();
+        PEDRODB_CHECK_OK(group.Commit(sync));
+        PEDRODB_CHECK(completed.load() > before);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  PEDRODB_CHECK(started.load() < n * 10);
+}
+
+// the requests covered by a failed sync all fail, the later ones are synced
+// again.
+static void TestFailure() {
+  GroupCommit group;
+  std::atomic<int> calls{};
+  std::atomic<bool> release{};
+
+  std::thread leader([&] {
+    auto status = group.Commit([&] {
+      calls++;
+      while (!release.load()) {
+        std::this_thread::sleep_for(1ms);
+      }
+      return Status::kOk;
+    });
+    PEDRODB_CHECK_OK(status);
+  });
+  while (calls.load() == 0) {
+    std::this_thread::sleep_for(1ms);
+  }
+
+  // issued while the first sync is running, so they share the second one.
+  std::vector<std::thread> followers;
+  std::atomic<int> failed{};
+  for (int i = 0; i < 4; ++i) {
+    followers.emplace_back([&] {
+      auto status = group.Commit([&] {
+        calls++;
+        return Status::kIOError;
+      });
+      if (status == Status::kIOError) {
+        failed++;
+      }
+    });
+  }
+  std::this_thread::sleep_for(100ms);
+  release = true;
+
+  leader.join();
+  for (auto& follower : followers) {
+    follower.join();
+  }
+  PEDRODB_CHECK(calls.load() == 2);
+  PEDRODB_CHECK(failed.load() == 4);
+
+  PEDRODB_CHECK_OK(group.Commit([&] {
+    calls++;
+    return Status::kOk;
+  }));
+  PEDRODB_CHECK(calls.load() == 3);
+}
+
+// the sync writes of databases are all acknowledged.
+static void TestSyncWrites() {
+  auto path = TempDir("group_commit_db") + "/t.db";
+  Options options;
+  options.checkpoint.enable = false;
+
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(DB::Open(options, path, &db));
+
+  WriteOptions sync;
+  sync.sync = true;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&, i] {
+      for (int k = 0; k < 100; ++k) {
+        auto key = std::to_string(i) + "-" + std::to_string(k);
+        PEDRODB_CHECK_OK(db->Put(sync, key, key));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  db = nullptr;
+  PEDRODB_CHECK_OK(DB::Open(options, path, &db));
+  for (int i = 0; i < 8; ++i) {
+    for (int k = 0; k < 100; ++k) {
+      auto key = std::to_string(i) + "-" + std::to_string(k);
+      PEDRODB_CHECK(Get(db.get(), key) == key);
+    }
+  }
+}
+
+int main() {
+  return RunTests({
+      {"GroupCommit.LeaderFollower", TestLeaderFollower},
+      {"GroupCommit.Failure", TestFailure},
+      {"GroupCommit.SyncWrites", TestSyncWrites},
+  });
+}
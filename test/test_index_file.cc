@@ -0,0 +1,91 @@
+#include <pedrodb/db.h>
+#include <chrono>
+#include <map>
+#include <thread>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+using namespace std::chrono_literals;
+
+using Model = std::map<std::string, std::string>;
+
+static Options TestOptions() {
+  // outlives the databases, the index files are written in background.
+  static auto executor = std::make_shared<DefaultExecutor>(1);
+
+  Options options;
+  options.executor = executor;
+  options.checkpoint.enable = false;
+  options.compress_value = false;
+  options.compaction.interval = Duration::Seconds(3600);
+  return options;
+}
+
+static void Verify(const std::string& path, const Model& model,
+                   size_t deleted) {
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(), path, &db));
+  for (auto& [key, value] : model) {
+    PEDRODB_CHECK(Get(db.get(), key) == value);
+  }
+  for (size_t i = 0; i < deleted; ++i) {
+    PEDRODB_CHECK(Get(db.get(), "deleted" + std::to_string(i)).empty());
+  }
+}
+
+// a corrupted, torn or missing index file is rebuilt from its data file.
+static void TestRebuildCorruptIndex() {
+  auto dir = TempDir("index_file");
+  auto path = dir + "/t.db";
+
+  Model model;
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(), path, &db));
+
+  // the deleted keys are in the first file, their tombstones in the second.
+  const size_t deleted = 1000;
+  for (size_t i = 0; i < deleted; ++i) {
+    PEDRODB_CHECK_OK(db->Put({}, "deleted" + std::to_string(i), "value"));
+  }
+  std::string value(1000, 'v');
+  for (size_t i = 0; i < kMaxFileBytes / value.size(); ++i) {
+    auto key = "key" + std::to_string(i);
+    value[i % value.size()]++;
+    model[key] = value;
+    PEDRODB_CHECK_OK(db->Put({}, key, value));
+  }
+  for (size_t i = 0; i < deleted; ++i) {
+    PEDRODB_CHECK_OK(db->Delete({}, "deleted" + std::to_string(i)));
+    auto key = "key" + std::to_string(i);
+    model[key] = "new" + std::to_string(i);
+    PEDRODB_CHECK_OK(db->Put({}, key, model[key]));
+  }
+  db = nullptr;
+
+  for (int i = 0; i < 1000 && ListFiles(dir, ".index").empty(); ++i) {
+    std::this_thread::sleep_for(10ms);
+  }
+  auto files = ListFiles(dir, ".index");
+  PEDRODB_CHECK(files.size() == 1);
+  auto content = ReadFile(files[0]);
+  Verify(path, model, deleted);
+
+  CorruptFile(files[0], content.size() / 2);
+  Verify(path, model, deleted);
+
+  WriteFile(files[0], content.substr(0, content.size() / 2));
+  Verify(path, model, deleted);
+
+  WriteFile(files[0], content.substr(0, 8));
+  Verify(path, model, deleted);
+
+  std::filesystem::remove(files[0]);
+  Verify(path, model, deleted);
+}
+
+int main() {
+  return RunTests({
+      {"IndexFile.RebuildCorruptIndex", TestRebuildCorruptIndex},
+  });
+}
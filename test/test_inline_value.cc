@@ -0,0 +1,105 @@
+#include <pedrodb/db.h>
+#include <map>
+#include <optional>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+
+using Model = std::map<std::string, std::optional<std::string>>;
+
+constexpr size_t kInlineBytes = 32;
+
+static Options TestOptions(bool compress) {
+  Options options;
+  options.checkpoint.enable = false;
+  options.compress_value = compress;
+  options.inline_value_bytes = kInlineBytes;
+  options.read_cache.enable = false;
+  options.statistics = std::make_shared<Statistics>();
+  return options;
+}
+
+static uint64_t InlineHits(DB* db) {
+  std::string value;
+  PEDRODB_CHECK_OK(db->GetProperty("pedrodb.inline.hits", &value));
+  return std::stoull(value);
+}
+
+// reads every key, returns the number of inline hits.
+static uint64_t Verify(DB* db, const Model& model) {
+  uint64_t before = InlineHits(db);
+  for (auto& [key, value] : model) {
+    PEDRODB_CHECK(Get(db, key) == value.value_or(""));
+  }
+  return InlineHits(db) - before;
+}
+
+static std::string ValueOf(size_t i, size_t size) {
+  std::string value = std::to_string(i) + ":";
+  value.resize(size, static_cast<char>('a' + i % 26));
+  return value;
+}
+
+// the small values written by puts and batches are inlined again by
+// recovery, the overwritten and deleted ones are not.
+static void TestSurviveRecovery() {
+  for (bool compress : {false, true}) {
+    auto path = TempDir("inline_value") + "/t.db";
+    DB::Ptr db;
+    PEDRODB_CHECK_OK(DB::Open(TestOptions(compress), path, &db));
+
+    Model model;
+    const size_t n = 1000;
+    size_t small = 0;
+    for (size_t i = 0; i < n; ++i) {
+      auto key = "key" + std::to_string(i);
+      size_t size = i % 3 == 0 ? kInlineBytes + 100 : i % kInlineBytes + 1;
+      model[key] = ValueOf(i, size);
+      PEDRODB_CHECK_OK(db->Put({}, key, *model[key]));
+    }
+
+    WriteBatch batch;
+    for (size_t i = 0; i < n; i += 5) {
+      auto key = "key" + std::to_string(i);
+      if (i % 2 == 0) {
+        model[key] = std::nullopt;
+        batch.Delete(key);
+      } else {
+        model[key] = ValueOf(i + n, i % 4 == 1 ? kInlineBytes : 200);
+        batch.Put(key, *model[key]);
+      }
+    }
+    PEDRODB_CHECK_OK(db->Write({}, &batch));
+
+    for (auto& [key, value] : model) {
+      small += value.has_value() && value->size() <= kInlineBytes;
+    }
+    PEDRODB_CHECK(Verify(db.get(), model) == small);
+    db = nullptr;
+
+    PEDRODB_CHECK_OK(DB::Open(TestOptions(compress), path, &db));
+    PEDRODB_CHECK(Verify(db.get(), model) == small);
+
+    // an overwrite by a large value drops the inline one.
+    for (size_t i = 1; i < n; i += 7) {
+      auto key = "key" + std::to_string(i);
+      bool inlined =
+          model[key].has_value() && model[key]->size() <= kInlineBytes;
+      model[key] = ValueOf(i, kInlineBytes + 1);
+      PEDRODB_CHECK_OK(db->Put({}, key, *model[key]));
+      small -= inlined;
+    }
+    PEDRODB_CHECK(Verify(db.get(), model) == small);
+    db = nullptr;
+
+    PEDRODB_CHECK_OK(DB::Open(TestOptions(compress), path, &db));
+    PEDRODB_CHECK(Verify(db.get(), model) == small);
+  }
+}
+
+int main() {
+  return RunTests({
+      {"InlineValue.SurviveRecovery", TestSurviveRecovery},
+  });
+}
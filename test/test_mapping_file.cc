@@ -0,0 +1,110 @@
+#include <pedrodb/db.h>
+#include <pedrodb/file/mapping_readwrite_file.h>
+#include <unistd.h>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+
+static const size_t kPage = ::sysconf(_SC_PAGESIZE);
+
+static size_t Append(MappingReadWriteFile& file, size_t n, char c) {
+  auto buffer = file.Allocate(n);
+  PEDRODB_CHECK(buffer.GetOffset() != (size_t)-1);
+  std::string data(n, c);
+  buffer.Append(data.data(), n);
+  return buffer.GetOffset();
+}
+
+// a sync only covers the bytes written since the last one, including the
+// appends across page boundaries and after the write offset is moved back.
+static void TestSyncWatermark() {
+  auto path = TempDir("mapping_file") + "/t.data";
+  MappingReadWriteFile file;
+  PEDRODB_CHECK_OK(file.Open(path, 16 * kPage));
+  PEDRODB_CHECK(file.GetUnsyncedBytes() == 0);
+
+  Append(file, kPage - 50, 'a');
+  PEDRODB_CHECK(file.GetUnsyncedBytes() == kPage - 50);
+  PEDRODB_CHECK(file.Sync() == Error::kOk);
+  PEDRODB_CHECK(file.GetUnsyncedBytes() == 0);
+  PEDRODB_CHECK(file.Sync() == Error::kOk);
+
+  // straddles the first and the second page.
+  PEDRODB_CHECK(Append(file, 100, 'b') == kPage - 50);
+  PEDRODB_CHECK(file.GetUnsyncedBytes() == 100);
+  Append(file, 2 * kPage, 'c');
+  PEDRODB_CHECK(file.GetUnsyncedBytes() == 2 * kPage + 100);
+  PEDRODB_CHECK(file.Sync() == Error::kOk);
+  PEDRODB_CHECK(file.GetUnsyncedBytes() == 0);
+
+  auto content = ReadFile(path);
+  PEDRODB_CHECK(content.size() == 16 * kPage);
+  PEDRODB_CHECK(content[kPage - 51] == 'a');
+  PEDRODB_CHECK(content[kPage - 50] == 'b' && content[kPage + 49] == 'b');
+  PEDRODB_CHECK(content[kPage + 50] == 'c');
+  PEDRODB_CHECK(content[3 * kPage + 50] == '\0');
+
+  // a torn tail is overwritten, the synced mark is moved back with it.
+  file.SetWriteOffset(kPage);
+  PEDRODB_CHECK(file.GetUnsyncedBytes() == 0);
+  PEDRODB_CHECK(Append(file, 10, 'd') == kPage);
+  PEDRODB_CHECK(file.GetUnsyncedBytes() == 10);
+  PEDRODB_CHECK(file.Sync() == Error::kOk);
+  PEDRODB_CHECK(file.GetUnsyncedBytes() == 0);
+  PEDRODB_CHECK(ReadFile(path)[kPage] == 'd');
+}
+
+// the file is shrunk to the written bytes rounded up, it is synced and
+// nothing can be appended after that.
+static void TestTruncate() {
+  auto path = TempDir("mapping_file") + "/t.data";
+  MappingReadWriteFile file;
+  PEDRODB_CHECK_OK(file.Open(path, 16 * kPage));
+  Append(file, 3 * kPage + 10, 'a');
+
+  PEDRODB_CHECK(file.Truncate(kPage) == Error::kOk);
+  PEDRODB_CHECK(file.Size() == 4 * kPage);
+  PEDRODB_CHECK(file.GetUnsyncedBytes() == 0);
+  PEDRODB_CHECK(file.Allocate(1).GetOffset() == (size_t)-1);
+
+  auto content = ReadFile(path);
+  PEDRODB_CHECK(content.size() == 4 * kPage);
+  PEDRODB_CHECK(content[3 * kPage + 9] == 'a');
+  PEDRODB_CHECK(content[3 * kPage + 10] == '\0');
+  PEDRODB_CHECK(file.Sync() == Error::kOk);
+
+  // an alignment of 1 keeps the written size.
+  path = TempDir("mapping_file") + "/u.data";
+  MappingReadWriteFile other;
+  PEDRODB_CHECK_OK(other.Open(path, 16 * kPage));
+  Append(other, 100, 'b');
+  PEDRODB_CHECK(other.Truncate(1) == Error::kOk);
+  PEDRODB_CHECK(other.Size() == 100);
+  PEDRODB_CHECK(ReadFile(path).size() == 100);
+}
+
+// the write back never moves the synced mark.
+static void TestWriteBack() {
+  auto path = TempDir("mapping_file") + "/t.data";
+  MappingReadWriteFile file(kPage);
+  PEDRODB_CHECK_OK(file.Open(path, 16 * kPage));
+
+  Append(file, kPage / 2, 'a');
+  file.WriteBack();
+  Append(file, 2 * kPage, 'b');
+  file.WriteBack();
+  file.WriteBack();
+  PEDRODB_CHECK(file.GetUnsyncedBytes() == 2 * kPage + kPage / 2);
+  PEDRODB_CHECK(file.Sync() == Error::kOk);
+  PEDRODB_CHECK(file.GetUnsyncedBytes() == 0);
+  PEDRODB_CHECK(ReadFile(path)[2 * kPage] == 'b');
+}
+
+int main() {
+  return RunTests({
+      {"MappingFile.SyncWatermark", TestSyncWatermark},
+      {"MappingFile.Truncate", TestTruncate},
+      {"MappingFile.WriteBack", TestWriteBack},
+  });
+}
@@ -0,0 +1,165 @@
+#include <pedrodb/db.h>
+#include <algorithm>
+#include <optional>
+#include <random>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+
+constexpr size_t kValueBytes = 64 << 10;
+
+static std::string ValueOf(size_t i, size_t size) {
+  std::string value(size, '\0');
+  std::mt19937 rng(i);
+  for (auto& c : value) {
+    c = static_cast<char>(rng());
+  }
+  return value;
+}
+
+// the keys are spread over a full file and the active one, some of them
+// deleted, and read by MultiGet with and without the read cache.
+static void TestMixedFiles() {
+  auto path = TempDir("multi_get") + "/t.db";
+  Options options;
+  options.checkpoint.enable = false;
+  options.statistics = std::make_shared<Statistics>();
+
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(DB::Open(options, path, &db));
+
+  // the small records of the first file share blocks with each other.
+  const size_t small = 1000;
+  for (size_t i = 0; i < small; ++i) {
+    PEDRODB_CHECK_OK(db->Put({}, "small" + std::to_string(i), ValueOf(i, 100)));
+  }
+
+  // rolls over to the next file.
+  const size_t large = kMaxFileBytes / kValueBytes + 16;
+  for (size_t i = 0; i < large; ++i) {
+    PEDRODB_CHECK_OK(
+        db->Put({}, "large" + std::to_string(i), ValueOf(i, kValueBytes)));
+  }
+  std::string rollovers;
+  PEDRODB_CHECK_OK(db->GetProperty("pedrodb.file.rollovers", &rollovers));
+  PEDRODB_CHECK(std::stoul(rollovers) >= 1);
+
+  // the newest versions are in the active file, some deleted keys are put
+  // again.
+  for (size_t i = 0; i < small; i += 3) {
+    PEDRODB_CHECK_OK(db->Delete({}, "small" + std::to_string(i)));
+  }
+  for (size_t i = 1; i < small; i += 5) {
+    PEDRODB_CHECK_OK(
+        db->Put({}, "small" + std::to_string(i), ValueOf(i + small, 100)));
+  }
+
+  auto expected = [&](const std::string& key) -> std::optional<std::string> {
+    if (key.rfind("large", 0) == 0) {
+      size_t i = std::stoul(key.substr(5));
+      return i < large ? std::optional(ValueOf(i, kValueBytes)) : std::nullopt;
+    }
+    if (key.rfind("small", 0) != 0) {
+      return std::nullopt;
+    }
+    size_t i = std::stoul(key.substr(5));
+    if (i >= small) {
+      return std::nullopt;
+    }
+    if (i % 5 == 1) {
+      return ValueOf(i + small, 100);
+    }
+    return i % 3 == 0 ? std::nullopt : std::optional(ValueOf(i, 100));
+  };
+
+  std::vector<std::string> keys;
+  for (size_t i = small + 10; i-- > 0;) {
+    keys.emplace_back("small" + std::to_string(i));
+  }
+  for (size_t i = 0; i < large + 10; i += 7) {
+    keys.emplace_back("large" + std::to_string(i));
+  }
+  keys.emplace_back("missing");
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+
+  std::vector<std::string_view> views(keys.begin(), keys.end());
+  for (bool use_read_cache : {false, true, true}) {
+    ReadOptions read_options;
+    read_options.use_read_cache = use_read_cache;
+
+    std::vector<std::string> values;
+    std::vector<Status> status;
+    PEDRODB_CHECK_OK(db->MultiGet(read_options, views, &values, &status));
+    PEDRODB_CHECK(values.size() == keys.size());
+    PEDRODB_CHECK(status.size() == keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      auto value = expected(keys[i]);
+      if (!value.has_value()) {
+        PEDRODB_CHECK(status[i] == Status::kNotFound);
+        continue;
+      }
+      PEDRODB_CHECK_OK(status[i]);
+      PEDRODB_CHECK(values[i] == *value);
+    }
+  }
+}
+
+// the records straddle the blocks of the smallest and a large block size,
+// they are read by Get and MultiGet from a full file and the active one.
+static void TestBlockSizes() {
+  for (size_t block_size : {512, 65536}) {
+    auto path = TempDir("multi_get_block") + "/t.db";
+    Options options;
+    options.checkpoint.enable = false;
+    options.read_cache.block_size = block_size;
+
+    DB::Ptr db;
+    PEDRODB_CHECK_OK(DB::Open(options, path, &db));
+
+    auto size_of = [](size_t i) {
+      return i % 50 == 0 ? 150 << 10 : 1 + (i * 7919) % 3000;
+    };
+    std::vector<std::string> keys;
+    auto put = [&](size_t n) {
+      for (size_t i = 0; i < n; ++i) {
+        auto& key = keys.emplace_back("key" + std::to_string(keys.size()));
+        PEDRODB_CHECK_OK(db->Put({}, key, ValueOf(keys.size(), size_of(i))));
+      }
+    };
+
+    put(1000);
+    for (size_t i = 0; i < kMaxFileBytes / kValueBytes + 16; ++i) {
+      PEDRODB_CHECK_OK(db->Put({}, "filler", ValueOf(i, kValueBytes)));
+    }
+    size_t old_keys = keys.size();
+    put(1000);
+
+    std::vector<std::string_view> views(keys.begin(), keys.end());
+    for (bool use_read_cache : {false, true, true}) {
+      ReadOptions read_options;
+      read_options.use_read_cache = use_read_cache;
+
+      std::vector<std::string> values;
+      std::vector<Status> status;
+      PEDRODB_CHECK_OK(db->MultiGet(read_options, views, &values, &status));
+      for (size_t i = 0; i < keys.size(); ++i) {
+        size_t k = i < old_keys ? i : i - old_keys;
+        auto expected = ValueOf(i + 1, size_of(k));
+        PEDRODB_CHECK_OK(status[i]);
+        PEDRODB_CHECK(values[i] == expected);
+
+        std::string value;
+        PEDRODB_CHECK_OK(db->Get(read_options, keys[i], &value));
+        PEDRODB_CHECK(value == expected);
+      }
+    }
+  }
+}
+
+int main() {
+  return RunTests({
+      {"MultiGet.MixedFiles", TestMixedFiles},
+      {"MultiGet.BlockSizes", TestBlockSizes},
+  });
+}
@@ -0,0 +1,176 @@
+#include <pedrodb/db.h>
+#include <random>
+#include <thread>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+
+static Options TestOptions() {
+  // outlives the databases, the background tasks of a closed one may still
+  // hold its files.
+  static auto executor = std::make_shared<DefaultExecutor>(1);
+
+  Options options;
+  options.executor = executor;
+  options.checkpoint.enable = false;
+  options.compress_value = true;
+  options.read_cache.segments = 2;
+  options.statistics = std::make_shared<Statistics>();
+  return options;
+}
+
+// restores the level of the calling thread.
+class PerfLevelGuard {
+  PerfLevel level_;
+
+ public:
+  explicit PerfLevelGuard(PerfLevel level) : level_(GetPerfLevel()) {
+    SetPerfLevel(level);
+  }
+
+  ~PerfLevelGuard() { SetPerfLevel(level_); }
+};
+
+static std::string ValueOf(size_t i) {
+  return std::to_string(i) + std::string(1000, static_cast<char>('a' + i % 26));
+}
+
+// the active file is read without the cache, the records written before
+// are read by it once the file rolls over.
+static void RollOver(DB* db) {
+  std::string value(1 << 20, '\0');
+  std::mt19937 rng(0);
+  for (auto& c : value) {
+    c = static_cast<char>(rng());
+  }
+  for (size_t i = 0; i < kMaxFileBytes / value.size() + 2; ++i) {
+    PEDRODB_CHECK_OK(db->Put({}, "fill" + std::to_string(i), value));
+  }
+
+  std::string rollovers;
+  PEDRODB_CHECK_OK(db->GetProperty("pedrodb.file.rollovers", &rollovers));
+  PEDRODB_CHECK(std::stoul(rollovers) >= 1);
+}
+
+// nothing is counted by default.
+static void TestDisabled() {
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(), TempDir("perf_disabled") + "/t.db",
+                            &db));
+  GetPerfContext()->Reset();
+  PEDRODB_CHECK_OK(db->Put({}, "key", ValueOf(0)));
+  PEDRODB_CHECK(Get(db.get(), "key") == ValueOf(0));
+  PEDRODB_CHECK(GetPerfContext()->ToString().empty());
+}
+
+// the stages of a put and of a get are counted, without the time, and each
+// request starts from zero after a reset.
+static void TestCount() {
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(
+      DB::Open(TestOptions(), TempDir("perf_count") + "/t.db", &db));
+  PerfLevelGuard guard(PerfLevel::kEnableCount);
+  auto* perf = GetPerfContext();
+
+  perf->Reset();
+  PEDRODB_CHECK_OK(db->Put({}, "key", ValueOf(0)));
+  PEDRODB_CHECK(perf->index_update_count == 1);
+  PEDRODB_CHECK(perf->append_bytes > 0);
+  PEDRODB_CHECK(perf->index_lookup_count == 0);
+  PEDRODB_CHECK(perf->compress_nanos == 0);
+  PEDRODB_CHECK(perf->append_copy_nanos == 0);
+
+  perf->Reset();
+  PEDRODB_CHECK_OK(db->Put({}, "key2", ValueOf(1)));
+  PEDRODB_CHECK(perf->index_update_count == 1);
+
+  // the active file is read directly.
+  perf->Reset();
+  PEDRODB_CHECK(Get(db.get(), "key2") == ValueOf(1));
+  PEDRODB_CHECK(perf->index_lookup_count == 1);
+  PEDRODB_CHECK(perf->acquire_file_count == 1);
+  PEDRODB_CHECK(perf->block_cache_miss_count == 0);
+  PEDRODB_CHECK(perf->block_read_count == 0);
+  RollOver(db.get());
+
+  // the first get misses the block, the second hits it.
+  perf->Reset();
+  PEDRODB_CHECK(Get(db.get(), "key") == ValueOf(0));
+  PEDRODB_CHECK(perf->index_lookup_count == 1);
+  PEDRODB_CHECK(perf->acquire_file_count == 1);
+  PEDRODB_CHECK(perf->block_cache_miss_count > 0);
+  PEDRODB_CHECK(perf->block_cache_hit_count == 0);
+  PEDRODB_CHECK(perf->block_read_count > 0);
+  PEDRODB_CHECK(perf->block_read_bytes > 0);
+  PEDRODB_CHECK(perf->index_update_count == 0);
+  PEDRODB_CHECK(perf->index_lookup_nanos == 0);
+  PEDRODB_CHECK(perf->block_read_nanos == 0);
+
+  perf->Reset();
+  PEDRODB_CHECK(Get(db.get(), "key") == ValueOf(0));
+  PEDRODB_CHECK(perf->index_lookup_count == 1);
+  PEDRODB_CHECK(perf->block_cache_hit_count > 0);
+  PEDRODB_CHECK(perf->block_cache_miss_count == 0);
+  PEDRODB_CHECK(perf->block_read_count == 0);
+  PEDRODB_CHECK(perf->ToString().find("index_lookup_count = 1") !=
+                std::string::npos);
+
+  // a missing key looks up the index only.
+  perf->Reset();
+  std::string value;
+  PEDRODB_CHECK(db->Get({}, "missing", &value) == Status::kNotFound);
+  PEDRODB_CHECK(perf->index_lookup_count == 1);
+  PEDRODB_CHECK(perf->acquire_file_count == 0);
+}
+
+// the time of the stages is measured as well.
+static void TestTime() {
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(
+      DB::Open(TestOptions(), TempDir("perf_time") + "/t.db", &db));
+  PerfLevelGuard guard(PerfLevel::kEnableTime);
+  auto* perf = GetPerfContext();
+
+  perf->Reset();
+  PEDRODB_CHECK_OK(db->Put({}, "key", ValueOf(0)));
+  PEDRODB_CHECK(perf->compress_nanos > 0);
+  PEDRODB_CHECK(perf->index_update_nanos > 0);
+  PEDRODB_CHECK(perf->index_update_count == 1);
+
+  perf->Reset();
+  PEDRODB_CHECK(Get(db.get(), "key") == ValueOf(0));
+  PEDRODB_CHECK(perf->index_lookup_nanos > 0);
+  PEDRODB_CHECK(perf->acquire_file_nanos > 0);
+  PEDRODB_CHECK(perf->uncompress_nanos > 0);
+  PEDRODB_CHECK(perf->compress_nanos == 0);
+}
+
+// the context is per thread, the requests of other threads are not counted.
+static void TestThreadLocal() {
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(
+      DB::Open(TestOptions(), TempDir("perf_thread") + "/t.db", &db));
+  PerfLevelGuard guard(PerfLevel::kEnableCount);
+  GetPerfContext()->Reset();
+
+  std::thread other([&] {
+    PerfLevelGuard other_guard(PerfLevel::kEnableCount);
+    GetPerfContext()->Reset();
+    PEDRODB_CHECK_OK(db->Put({}, "key", ValueOf(0)));
+    PEDRODB_CHECK(Get(db.get(), "key") == ValueOf(0));
+    PEDRODB_CHECK(GetPerfContext()->index_update_count == 1);
+    PEDRODB_CHECK(GetPerfContext()->index_lookup_count == 1);
+  });
+  other.join();
+  PEDRODB_CHECK(GetPerfContext()->ToString().empty());
+}
+
+int main() {
+  return RunTests({
+      {"PerfContext.Disabled", TestDisabled},
+      {"PerfContext.Count", TestCount},
+      {"PerfContext.Time", TestTime},
+      {"PerfContext.ThreadLocal", TestThreadLocal},
+  });
+}
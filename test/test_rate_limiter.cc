@@ -0,0 +1,87 @@
+#include <pedrodb/rate_limiter.h>
+#include <thread>
+#include <vector>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+using namespace std::chrono_literals;
+
+// 1000 bytes per second, a burst is 100 bytes.
+constexpr size_t kBytesPerSecond = 1000;
+constexpr size_t kBurst = 100;
+
+static RateLimiter::Clock::duration Elapsed(RateLimiter::Clock::time_point t) {
+  return RateLimiter::Clock::now() - t;
+}
+
+// the flush request queued behind a long compaction is granted before the
+// rest of it.
+static void TestPriority() {
+  RateLimiter limiter(kBytesPerSecond);
+  std::mutex mu;
+  std::vector<IOPriority> done;
+  auto request = [&](size_t bytes, IOPriority priority) {
+    limiter.Request(bytes, priority);
+    std::unique_lock lock{mu};
+    done.emplace_back(priority);
+  };
+
+  // the compaction takes a second, the flush comes while it waits.
+  std::thread compaction(request, 10 * kBurst, IOPriority::kCompaction);
+  std::this_thread::sleep_for(20ms);
+  std::thread flush(request, kBurst, IOPriority::kFlush);
+  flush.join();
+  compaction.join();
+
+  PEDRODB_CHECK(done.size() == 2);
+  PEDRODB_CHECK(done[0] == IOPriority::kFlush);
+}
+
+// foreground io never waits, and its debt is capped at one burst, so the
+// background waits for two bursts rather than for all of it.
+static void TestForegroundDebt() {
+  RateLimiter limiter(kBytesPerSecond);
+  auto start = RateLimiter::Clock::now();
+  limiter.Request(1 << 30, IOPriority::kForeground);
+  PEDRODB_CHECK(Elapsed(start) < 100ms);
+
+  limiter.Request(kBurst, IOPriority::kFlush);
+  auto elapsed = Elapsed(start);
+  PEDRODB_CHECK(elapsed >= 150ms);
+  PEDRODB_CHECK(elapsed < 2s);
+}
+
+// the compaction ratio is halved while the foreground latency is twice as
+// the baseline, down to 1/16, and grows back once it drops.
+static void TestAutoTune() {
+  RateLimiter limiter(1 << 30, true);
+  PEDRODB_CHECK(limiter.IsAutoTuned());
+  PEDRODB_CHECK(limiter.GetCompactionRatio() == 1.0);
+
+  // a request refills the budget, which tunes once per 100ms.
+  auto tune = [&](std::chrono::milliseconds latency) {
+    for (int i = 0; i < 10; ++i) {
+      limiter.RecordLatency(latency);
+    }
+    std::this_thread::sleep_for(110ms);
+    limiter.Request(1, IOPriority::kFlush);
+    return limiter.GetCompactionRatio();
+  };
+
+  PEDRODB_CHECK(tune(1ms) == 1.0);
+  PEDRODB_CHECK(tune(10ms) == 0.5);
+  PEDRODB_CHECK(tune(10ms) == 0.25);
+  PEDRODB_CHECK(tune(10ms) == 0.125);
+  PEDRODB_CHECK(tune(10ms) == 1.0 / 16);
+  PEDRODB_CHECK(tune(10ms) == 1.0 / 16);
+  PEDRODB_CHECK(tune(1ms) == 1.0 / 16 * 1.25);
+}
+
+int main() {
+  return RunTests({
+      {"RateLimiter.Priority", TestPriority},
+      {"RateLimiter.ForegroundDebt", TestForegroundDebt},
+      {"RateLimiter.AutoTune", TestAutoTune},
+  });
+}
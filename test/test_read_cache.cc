@@ -0,0 +1,167 @@
+#include <pedrodb/cache/read_cache.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+using namespace std::chrono_literals;
+
+constexpr size_t kTestBlockSize = 512;
+
+// a file in memory, which reads slowly and counts the bytes read.
+class SlowFile final : public ReadableFile {
+ public:
+  explicit SlowFile(std::string data) : data_(std::move(data)) {}
+
+  [[nodiscard]] uint64_t Size() const noexcept override {
+    return data_.size();
+  }
+
+  [[nodiscard]] Error GetError() const noexcept override { return Error::kOk; }
+
+  ssize_t Read(uint64_t offset, char* buf, size_t n) override {
+    std::this_thread::sleep_for(20ms);
+    if (offset >= data_.size()) {
+      return 0;
+    }
+    n = std::min<size_t>(n, data_.size() - offset);
+    memcpy(buf, data_.data() + offset, n);
+    bytes_ += n;
+    return static_cast<ssize_t>(n);
+  }
+
+  Status Open(const std::string&) override { return Status::kOk; }
+
+  [[nodiscard]] size_t GetBytesRead() const noexcept { return bytes_; }
+
+ private:
+  std::string data_;
+  std::atomic<size_t> bytes_{};
+};
+
+struct Record {
+  std::string key;
+  std::string value;
+  record::Location loc;
+  size_t length;
+};
+
+static Record Append(std::string* data, std::string key, std::string value) {
+  record::EntryView entry;
+  entry.type = record::Type::kSet;
+  entry.key = key;
+  entry.value = value;
+  entry.checksum = record::EntryView::Checksum(entry.key, entry.value);
+
+  ArrayBuffer buffer(entry.SizeOf());
+  entry.Pack(&buffer);
+  Record r{std::move(key), std::move(value),
+           record::Location(0, static_cast<uint32_t>(data->size())),
+           buffer.ReadableBytes()};
+  data->append(buffer.ReadIndex(), buffer.ReadableBytes());
+  return r;
+}
+
+struct Fixture {
+  std::string data;
+  Record large;  // blocks [0, 3]
+  Record tail;   // blocks [3, 5], the last block is short
+  std::shared_ptr<SlowFile> file;
+  ReadCache cache;
+
+  static ReadCacheOptions CacheOptions() {
+    ReadCacheOptions options;
+    options.block_size = kTestBlockSize;
+    options.read_cache_bytes = 1 << 20;
+    options.segments = 2;
+    return options;
+  }
+
+  Fixture() : cache(CacheOptions()) {
+    large = Append(&data, "large", std::string(1900, 'L'));
+    tail = Append(&data, "tail", std::string(1000, 'T'));
+    PEDRODB_CHECK(data.size() > 5 * kTestBlockSize && data.size() < 6 * kTestBlockSize);
+
+    file = std::make_shared<SlowFile>(data);
+    cache.SetFileOpener([this](file_id_t, ReadableFile::Ptr* f) {
+      *f = file;
+      return Status::kOk;
+    });
+  }
+};
+
+static void CheckEntry(const ReadCache::Context& ctx, const Record& r) {
+  auto entry = ctx.GetEntry();
+  PEDRODB_CHECK(entry.key == r.key);
+  PEDRODB_CHECK(entry.value == r.value);
+}
+
+// a record around a cached block reads only the blocks it misses.
+static void TestSkipCached() {
+  Fixture f;
+
+  // block 2 alone, the bytes are not a record.
+  ReadCache::Context middle(record::Location(0, 2 * kTestBlockSize), 16);
+  PEDRODB_CHECK(f.cache.Get(middle) != Status::kOk);
+  PEDRODB_CHECK(f.file->GetBytesRead() == kTestBlockSize);
+
+  ReadCache::Context ctx(f.large.loc, f.large.length);
+  PEDRODB_CHECK_OK(f.cache.Get(ctx));
+  CheckEntry(ctx, f.large);
+  PEDRODB_CHECK(f.file->GetBytesRead() == 4 * kTestBlockSize);
+
+  ReadCache::Context again(f.large.loc, f.large.length);
+  PEDRODB_CHECK_OK(f.cache.Get(again));
+  CheckEntry(again, f.large);
+  PEDRODB_CHECK(f.file->GetBytesRead() == 4 * kTestBlockSize);
+}
+
+// the concurrent readers of the overlapping records, one by one or batched,
+// read each block once.
+static void TestSingleFlight() {
+  Fixture f;
+  const int n = 16;
+  std::atomic<int> arrived{};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < n; ++t) {
+    threads.emplace_back([&, t] {
+      arrived++;
+      while (arrived.load() < n) {
+        std::this_thread::yield();
+      }
+
+      if (t % 4 == 3) {
+        std::vector<ReadCache::Context> ctxs;
+        ctxs.emplace_back(f.large.loc, f.large.length);
+        ctxs.emplace_back(f.tail.loc, f.tail.length);
+        std::vector<Status> stats;
+        f.cache.Get(ctxs, &stats);
+        PEDRODB_CHECK_OK(stats[0]);
+        PEDRODB_CHECK_OK(stats[1]);
+        CheckEntry(ctxs[0], f.large);
+        CheckEntry(ctxs[1], f.tail);
+        return;
+      }
+
+      auto& r = t % 2 == 0 ? f.large : f.tail;
+      ReadCache::Context ctx(r.loc, r.length);
+      PEDRODB_CHECK_OK(f.cache.Get(ctx));
+      CheckEntry(ctx, r);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  PEDRODB_CHECK(f.file->GetBytesRead() == f.data.size());
+}
+
+int main() {
+  return RunTests({
+      {"ReadCache.SkipCached", TestSkipCached},
+      {"ReadCache.SingleFlight", TestSingleFlight},
+  });
+}
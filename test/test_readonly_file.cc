@@ -0,0 +1,90 @@
+#include <pedrodb/db.h>
+#include <pedrodb/file/posix_readonly_file.h>
+#include <pedrodb/file/uring_readonly_file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <random>
+#include <thread>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+
+constexpr size_t kFileBytes = (1 << 20) + 123;
+
+static std::string WriteData(const std::string& name) {
+  auto path = TempDir(name) + "/t.data";
+  std::string data(kFileBytes, '\0');
+  std::mt19937 rng(7);
+  for (auto& c : data) {
+    c = static_cast<char>(rng());
+  }
+  WriteFile(path, data);
+  return path;
+}
+
+// more ranges than a ring holds, some of them cross or pass the end of the
+// file, and the results match those of pread.
+static void CheckMultiRead(ReadableFile* file, const std::string& path,
+                           unsigned seed) {
+  constexpr size_t kRequests = 200;
+  std::mt19937 rng(seed);
+  std::vector<ReadRequest> requests(kRequests);
+  std::vector<std::string> bufs(kRequests);
+  for (size_t i = 0; i < kRequests; ++i) {
+    auto& r = requests[i];
+    r.offset = rng() % (kFileBytes + 4096);
+    r.n = i % 10 == 0 ? 0 : rng() % 65536;
+    bufs[i].assign(r.n, '\0');
+    r.buf = bufs[i].data();
+  }
+  file->MultiRead(requests.data(), requests.size());
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  PEDRODB_CHECK(fd >= 0);
+  for (size_t i = 0; i < kRequests; ++i) {
+    auto& r = requests[i];
+    std::string expected(r.n, '\0');
+    ssize_t n = ::pread(fd, expected.data(), r.n, r.offset);
+    PEDRODB_CHECK(r.result == n);
+    PEDRODB_CHECK(bufs[i].compare(0, n, expected, 0, n) == 0);
+  }
+  ::close(fd);
+}
+
+template <class File>
+static void TestMultiRead(const std::string& name) {
+  auto path = WriteData(name);
+  File file;
+  PEDRODB_CHECK_OK(file.Open(path));
+  PEDRODB_CHECK(file.Size() == kFileBytes);
+  CheckMultiRead(&file, path, 1);
+
+  // a single range and the ranges of several threads at once.
+  ReadRequest r;
+  std::string buf(100, '\0');
+  r.offset = kFileBytes - 10;
+  r.buf = buf.data();
+  r.n = buf.size();
+  file.MultiRead(&r, 1);
+  PEDRODB_CHECK(r.result == 10);
+
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < 4; ++i) {
+    threads.emplace_back([&, i] { CheckMultiRead(&file, path, i + 2); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+int main() {
+  return RunTests({
+      {"ReadonlyFile.PosixMultiRead",
+       [] { TestMultiRead<PosixReadonlyFile>("posix_readonly_file"); }},
+#ifdef PEDRODB_WITH_IO_URING
+      {"ReadonlyFile.UringMultiRead",
+       [] { TestMultiRead<UringReadonlyFile>("uring_readonly_file"); }},
+#endif
+  });
+}
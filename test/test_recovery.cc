@@ -0,0 +1,141 @@
+#include <pedrodb/db.h>
+#include <chrono>
+#include <future>
+#include <map>
+#include <optional>
+#include <random>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+
+constexpr size_t kValueBytes = 64 << 10;
+
+using Model = std::map<std::string, std::optional<std::string>>;
+
+static Options TestOptions(size_t io_threads) {
+  // outlives the databases, the background tasks of a closed one may still
+  // hold its files.
+  static auto executor = std::make_shared<DefaultExecutor>(1);
+
+  Options options;
+  options.executor = executor;
+  options.io_executor = std::make_shared<DefaultExecutor>(io_threads);
+  options.checkpoint.enable = false;
+  options.compaction.interval = Duration::Seconds(3600);
+  return options;
+}
+
+// the keys and values seen by the iterator, with the free bytes of files.
+static std::pair<std::map<std::string, std::string>, std::string> Dump(
+    DB* db) {
+  std::map<std::string, std::string> entries;
+  EntryIterator::Ptr iterator;
+  PEDRODB_CHECK_OK(db->GetIterator(&iterator));
+  while (iterator->Valid()) {
+    auto entry = iterator->Next();
+    std::string key(entry.key);
+    PEDRODB_CHECK(entries.emplace(key, Get(db, key)).second);
+  }
+
+  std::string free_bytes;
+  PEDRODB_CHECK_OK(db->GetProperty("pedrodb.free-bytes", &free_bytes));
+  return {entries, free_bytes};
+}
+
+// the keys are overwritten and deleted across several files, recovering them
+// by one io thread and by many gives the same index.
+static void TestParallelMatchesSerial() {
+  auto path = TempDir("recovery") + "/t.db";
+
+  Model model;
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(1), path, &db));
+
+  std::string filler(kValueBytes, '\0');
+  std::mt19937 rng(42);
+  for (auto& c : filler) {
+    c = static_cast<char>(rng());
+  }
+
+  // about 2.5 files, the small keys have versions in all of them.
+  const size_t n = 5 * kMaxFileBytes / kValueBytes / 2;
+  for (size_t i = 0; i < n; ++i) {
+    auto filler_key = "filler" + std::to_string(i % 50);
+    filler[i % kValueBytes] ^= 1;
+    model[filler_key] = filler;
+    PEDRODB_CHECK_OK(db->Put({}, filler_key, filler));
+
+    auto key = "key" + std::to_string(rng() % 1000);
+    if (rng() % 4 == 0) {
+      Status status = db->Delete({}, key);
+      PEDRODB_CHECK(status == (model[key] ? Status::kOk : Status::kNotFound));
+      model[key] = std::nullopt;
+    } else {
+      model[key] = key + "-" + std::to_string(i);
+      PEDRODB_CHECK_OK(db->Put({}, key, *model[key]));
+    }
+  }
+
+  std::string files;
+  PEDRODB_CHECK_OK(db->GetProperty("pedrodb.num-files", &files));
+  PEDRODB_CHECK(std::stoul(files) >= 3);
+  db = nullptr;
+
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(1), path, &db));
+  auto serial = Dump(db.get());
+  db = nullptr;
+
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(8), path, &db));
+  auto parallel = Dump(db.get());
+  db = nullptr;
+
+  PEDRODB_CHECK(serial == parallel);
+  for (auto& [key, value] : model) {
+    auto it = parallel.first.find(key);
+    if (value.has_value()) {
+      PEDRODB_CHECK(it != parallel.first.end() && it->second == *value);
+    } else {
+      PEDRODB_CHECK(it == parallel.first.end());
+    }
+  }
+}
+
+// a database is opened by the only thread of its io executor, as in an async
+// callback. Recovery must not wait for tasks queued behind itself.
+static void TestOpenOnIOThread() {
+  for (bool checkpoint : {false, true}) {
+    auto path = TempDir("recovery_io_thread") + "/t.db";
+    auto options = TestOptions(1);
+    options.checkpoint.enable = checkpoint;
+    options.inline_value_bytes = 16;
+
+    DB::Ptr db;
+    PEDRODB_CHECK_OK(DB::Open(options, path, &db));
+    for (size_t i = 0; i < 1000; ++i) {
+      auto key = "key" + std::to_string(i);
+      PEDRODB_CHECK_OK(db->Put({}, key, key));
+    }
+    db = nullptr;
+
+    std::promise<Status> opened;
+    options.io_executor->Schedule(
+        [&] { opened.set_value(DB::Open(options, path, &db)); });
+    auto future = opened.get_future();
+    PEDRODB_CHECK(future.wait_for(std::chrono::seconds(60)) ==
+                  std::future_status::ready);
+    PEDRODB_CHECK_OK(future.get());
+    for (size_t i = 0; i < 1000; ++i) {
+      auto key = "key" + std::to_string(i);
+      PEDRODB_CHECK(Get(db.get(), key) == key);
+    }
+    db = nullptr;
+  }
+}
+
+int main() {
+  return RunTests({
+      {"Recovery.ParallelMatchesSerial", TestParallelMatchesSerial},
+      {"Recovery.OpenOnIOThread", TestOpenOnIOThread},
+  });
+}
@@ -0,0 +1,97 @@
+#include <pedrodb/db.h>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+
+constexpr size_t kValueBytes = 64 << 10;
+constexpr size_t kPoolBytes = 1 << 20;
+
+// the values are incompressible slices of a random pool.
+static std::string_view ValueOf(const std::string& pool, size_t i) {
+  return std::string_view(pool).substr(i * 7919 % (kPoolBytes - kValueBytes),
+                                       kValueBytes);
+}
+
+// the readers never see a torn record while the writers roll over the
+// active file.
+static void TestConcurrentPutGet() {
+  auto path = TempDir("rollover") + "/t.db";
+  Options options;
+  options.checkpoint.enable = false;
+  options.statistics = std::make_shared<Statistics>();
+
+  // keeps every block, so a torn one is still cached when verified.
+  options.read_cache.read_cache_bytes = 1 << 30;
+
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(DB::Open(options, path, &db));
+
+  std::string pool(kPoolBytes, 0);
+  std::mt19937 rng(42);
+  for (auto& c : pool) {
+    c = static_cast<char>(rng());
+  }
+
+  // about 3.5 data files.
+  const size_t n = 7 * kMaxFileBytes / kValueBytes / 2;
+  const size_t writers = 4;
+  std::atomic<size_t> published{};
+  std::atomic<bool> done{};
+
+  std::vector<std::thread> threads;
+  for (size_t w = 0; w < writers; ++w) {
+    threads.emplace_back([&, w] {
+      for (size_t i = w; i < n; i += writers) {
+        PEDRODB_CHECK_OK(db->Put({}, std::to_string(i), ValueOf(pool, i)));
+        size_t last = published.load();
+        while (last < i + 1 && !published.compare_exchange_weak(last, i + 1)) {
+        }
+      }
+    });
+  }
+
+  std::vector<std::thread> readers;
+  for (size_t r = 0; r < 4; ++r) {
+    readers.emplace_back([&, r] {
+      std::mt19937 rng(r);
+      std::string value;
+      while (!done.load()) {
+        // the keys being written, which may be published at any time.
+        size_t i = published.load() + rng() % (writers * 2);
+        Status status = db->Get({}, std::to_string(i), &value);
+        if (status == Status::kNotFound) {
+          continue;
+        }
+        PEDRODB_CHECK_OK(status);
+        PEDRODB_CHECK(value == ValueOf(pool, i));
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  std::string rollovers;
+  PEDRODB_CHECK_OK(db->GetProperty("pedrodb.file.rollovers", &rollovers));
+  PEDRODB_CHECK(std::stoul(rollovers) >= 2);
+
+  for (size_t i = 0; i < n; ++i) {
+    PEDRODB_CHECK(Get(db.get(), std::to_string(i)) == ValueOf(pool, i));
+  }
+}
+
+int main() {
+  return RunTests({
+      {"Rollover.ConcurrentPutGet", TestConcurrentPutGet},
+  });
+}
@@ -0,0 +1,114 @@
+#include <pedrodb/cache/lru_cache.h>
+#include <pedrodb/cache/row_cache.h>
+#include <pedrodb/db.h>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+
+// an entry larger than the cache drops the old value of its key.
+static void TestLRUOversizedPut() {
+  LRUCache<int, int> cache(10);
+  cache.Put(1, 1);
+  cache.Put(2, 2);
+  cache.Put(1, 3, 11);
+
+  int value = 0;
+  PEDRODB_CHECK(!cache.Get(1, value));
+  PEDRODB_CHECK(cache.Get(2, value) && value == 2);
+}
+
+// a row is a hit only at its location, an overwrite by a row too large to
+// be cached removes the old one.
+static void TestRowOverwrite() {
+  RowCache cache(1, 8 << 10);
+  record::Location loc1(1, 0);
+  record::Location loc2(1, 100);
+  std::string value;
+
+  cache.Put("key", loc1, "v1");
+  PEDRODB_CHECK(cache.Get("key", loc1, &value) && value == "v1");
+  PEDRODB_CHECK(!cache.Get("key", loc2, &value));
+  PEDRODB_CHECK(!cache.Get("other", loc1, &value));
+
+  cache.Put("key", loc2, std::string(8 << 10, 'x'));
+  PEDRODB_CHECK(!cache.Get("key", loc1, &value));
+  PEDRODB_CHECK(!cache.Get("key", loc2, &value));
+
+  cache.Put("key", loc2, "v2");
+  cache.Remove("key");
+  PEDRODB_CHECK(!cache.Get("key", loc2, &value));
+}
+
+// the reads after overwrites, deletes and batches never see the old rows.
+static void TestInvalidateOnOverwrite() {
+  auto path = TempDir("row_cache") + "/t.db";
+  Options options;
+  options.checkpoint.enable = false;
+  options.read_cache.row_cache_bytes = 1 << 20;
+  options.read_cache.segments = 2;
+  options.statistics = std::make_shared<Statistics>();
+
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(DB::Open(options, path, &db));
+  const size_t n = 100;
+  for (size_t round = 0; round < 4; ++round) {
+    auto value = [&](size_t i) {
+      if (round == 2) {
+        // too large for the row cache.
+        return std::string(128 << 10, static_cast<char>('a' + i % 26));
+      }
+      return std::to_string(i) + "-" + std::to_string(round);
+    };
+
+    WriteBatch batch;
+    for (size_t i = 0; i < n; ++i) {
+      auto key = "key" + std::to_string(i);
+      if (i % 2 == 0) {
+        PEDRODB_CHECK_OK(db->Put({}, key, value(i)));
+      } else {
+        batch.Put(key, value(i));
+      }
+    }
+    PEDRODB_CHECK_OK(db->Write({}, &batch));
+
+    // twice, the second reads hit the rows.
+    for (int k = 0; k < 2; ++k) {
+      for (size_t i = 0; i < n; ++i) {
+        PEDRODB_CHECK(Get(db.get(), "key" + std::to_string(i)) == value(i));
+      }
+    }
+  }
+
+  for (size_t i = 0; i < n; i += 3) {
+    PEDRODB_CHECK_OK(db->Delete({}, "key" + std::to_string(i)));
+  }
+  std::vector<std::string> keys;
+  for (size_t i = 0; i < n; ++i) {
+    keys.emplace_back("key" + std::to_string(i));
+  }
+  std::vector<std::string_view> views(keys.begin(), keys.end());
+  std::vector<std::string> values;
+  std::vector<Status> status;
+  PEDRODB_CHECK_OK(db->MultiGet({}, views, &values, &status));
+  for (size_t i = 0; i < n; ++i) {
+    if (i % 3 == 0) {
+      PEDRODB_CHECK(status[i] == Status::kNotFound);
+    } else {
+      PEDRODB_CHECK_OK(status[i]);
+      PEDRODB_CHECK(values[i] == std::to_string(i) + "-3");
+    }
+  }
+
+  std::string hits;
+  PEDRODB_CHECK_OK(db->GetProperty("pedrodb.row.cache.hits", &hits));
+  PEDRODB_CHECK(std::stoul(hits) > 0);
+}
+
+int main() {
+  return RunTests({
+      {"RowCache.LRUOversizedPut", TestLRUOversizedPut},
+      {"RowCache.RowOverwrite", TestRowOverwrite},
+      {"RowCache.InvalidateOnOverwrite", TestInvalidateOnOverwrite},
+  });
+}
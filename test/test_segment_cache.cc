@@ -0,0 +1,176 @@
+#include <pedrodb/cache/policy_cache.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+using namespace std::chrono_literals;
+
+constexpr CachePolicy kPolicies[] = {CachePolicy::kLRU, CachePolicy::kClock,
+                                     CachePolicy::kS3FIFO};
+
+// the caches are not movable.
+static void AddSegments(PolicyCache<int, int>& cache, size_t capacity) {
+  cache.SegmentAdd(capacity);
+  cache.SegmentAdd(capacity);
+}
+
+struct Result {
+  Status status{};
+  int value{};
+  CacheSource source{};
+};
+
+// the threads miss `key` together, the supplier returns after all of them
+// have called GetOrCompute.
+static std::vector<Result> MissTogether(PolicyCache<int, int>& cache, int key,
+                                        Status status, int value,
+                                        std::atomic<int>& calls) {
+  const int n = 8;
+  std::atomic<int> arrived{};
+  std::vector<Result> results(n);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < n; ++t) {
+    threads.emplace_back([&, t] {
+      auto& result = results[t];
+      arrived++;
+      result.status = cache.GetOrCompute(
+          key, result.value,
+          [&] {
+            calls++;
+            while (arrived.load() < n) {
+              std::this_thread::sleep_for(1ms);
+            }
+            std::this_thread::sleep_for(50ms);
+            return std::pair{status, value};
+          },
+          &result.source);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return results;
+}
+
+// the concurrent misses of a key are computed once, the followers get the
+// result of the leader.
+static void TestSingleFlight() {
+  for (auto policy : kPolicies) {
+    PolicyCache<int, int> cache(policy, 2);
+    AddSegments(cache, 100);
+    std::atomic<int> calls{};
+    auto results = MissTogether(cache, 1, Status::kOk, 10, calls);
+    PEDRODB_CHECK(calls.load() == 1);
+
+    size_t loaded = 0;
+    for (auto& result : results) {
+      PEDRODB_CHECK_OK(result.status);
+      PEDRODB_CHECK(result.value == 10);
+      PEDRODB_CHECK(result.source != CacheSource::kHit);
+      loaded += result.source == CacheSource::kLoaded;
+    }
+    PEDRODB_CHECK(loaded == 1);
+
+    int value = 0;
+    CacheSource source{};
+    PEDRODB_CHECK_OK(cache.GetOrCompute(
+        1, value, [] { return std::pair{Status::kOk, 0}; }, &source));
+    PEDRODB_CHECK(value == 10 && source == CacheSource::kHit);
+  }
+}
+
+// the followers of a failed computation fail too, and the failure is not
+// cached.
+static void TestSingleFlightError() {
+  for (auto policy : kPolicies) {
+    PolicyCache<int, int> cache(policy, 2);
+    AddSegments(cache, 100);
+    std::atomic<int> calls{};
+    auto results = MissTogether(cache, 2, Status::kIOError, 20, calls);
+    PEDRODB_CHECK(calls.load() == 1);
+    for (auto& result : results) {
+      PEDRODB_CHECK(result.status == Status::kIOError);
+      PEDRODB_CHECK(result.value == 20);
+    }
+
+    int value = 0;
+    PEDRODB_CHECK(!cache.Get(2, value));
+    results = MissTogether(cache, 2, Status::kOk, 21, calls);
+    PEDRODB_CHECK(calls.load() == 2);
+    for (auto& result : results) {
+      PEDRODB_CHECK_OK(result.status);
+      PEDRODB_CHECK(result.value == 21);
+    }
+  }
+}
+
+// a hit still makes the entry the most recently used when the segment is
+// free.
+static void TestLRUHitTouches() {
+  PolicyCache<int, int> cache(CachePolicy::kLRU, 1);
+  cache.SegmentAdd(3);
+  cache.Put(1, 1);
+  cache.Put(2, 2);
+  cache.Put(3, 3);
+
+  int value = 0;
+  PEDRODB_CHECK(cache.Get(1, value));
+  cache.Put(4, 4);
+  PEDRODB_CHECK(cache.Get(1, value) && value == 1);
+  PEDRODB_CHECK(!cache.Get(2, value));
+}
+
+// the readers hit the keys while a writer puts and removes them, a hit
+// returns one of the values put.
+static void TestConcurrentHits() {
+  for (auto policy : kPolicies) {
+    PolicyCache<int, int> cache(policy, 2);
+    AddSegments(cache, 64);
+    const int n = 100;
+    std::atomic<bool> done{};
+    std::thread writer([&] {
+      for (int round = 0; round < 200; ++round) {
+        for (int key = 0; key < n; ++key) {
+          int value = 0;
+          if (round % 7 == 0) {
+            cache.Remove(key, value);
+          } else {
+            cache.Put(key, key * 10 + round % 2);
+          }
+        }
+      }
+      done = true;
+    });
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+      readers.emplace_back([&] {
+        while (!done.load()) {
+          for (int key = 0; key < n; ++key) {
+            int value = 0;
+            if (cache.Get(key, value)) {
+              PEDRODB_CHECK(value / 10 == key);
+            }
+          }
+        }
+      });
+    }
+    writer.join();
+    for (auto& reader : readers) {
+      reader.join();
+    }
+  }
+}
+
+int main() {
+  return RunTests({
+      {"SegmentCache.SingleFlight", TestSingleFlight},
+      {"SegmentCache.SingleFlightError", TestSingleFlightError},
+      {"SegmentCache.LRUHitTouches", TestLRUHitTouches},
+      {"SegmentCache.ConcurrentHits", TestConcurrentHits},
+  });
+}
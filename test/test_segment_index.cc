@@ -0,0 +1,93 @@
+#include <pedrodb/index/segment_index.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+
+// the dir of a key in the given round, its fields agree with each other so a
+// torn read is detected.
+static record::Dir DirOf(uint32_t i, uint32_t round) {
+  record::Dir dir;
+  dir.entry_size = i + round;
+  dir.loc = record::Location(i % 7 + 1, i + round);
+  return dir;
+}
+
+static bool Consistent(uint32_t i, const record::Dir& dir) {
+  return dir.loc.id == i % 7 + 1 && dir.entry_size == dir.loc.offset &&
+         dir.entry_size >= i;
+}
+
+// the lock-free readers see the stable keys with a consistent dir, while a
+// writer updates them and inserts and erases other keys to resize the
+// tables.
+static void TestConcurrentResizeErase() {
+  SegmentIndex index(4);
+  const uint32_t stable = 1000;
+  const uint32_t churn = 100000;
+  for (uint32_t i = 0; i < stable; ++i) {
+    index.Compute("stable" + std::to_string(i),
+                  [&](auto& dir) { dir = DirOf(i, 0); });
+  }
+
+  std::atomic<bool> done{};
+  std::thread writer([&] {
+    for (uint32_t round = 1; round <= 4; ++round) {
+      for (uint32_t i = 0; i < churn; ++i) {
+        index.Compute("churn" + std::to_string(i),
+                      [&](auto& dir) { dir = DirOf(i, round); });
+        if (i % 100 == 0) {
+          uint32_t k = i / 100 % stable;
+          index.Compute("stable" + std::to_string(k),
+                        [&](auto& dir) { dir = DirOf(k, round); });
+        }
+      }
+      for (uint32_t i = 0; i < churn; ++i) {
+        index.Compute("churn" + std::to_string(i),
+                      [&](auto& dir) { dir.reset(); });
+      }
+    }
+    done = true;
+  });
+
+  std::vector<std::thread> readers;
+  std::atomic<uint64_t> hits{};
+  for (uint32_t r = 0; r < 4; ++r) {
+    readers.emplace_back([&, r] {
+      uint32_t i = r;
+      while (!done.load()) {
+        record::Dir dir;
+        uint32_t k = i % stable;
+        PEDRODB_CHECK(index.Get("stable" + std::to_string(k), &dir));
+        PEDRODB_CHECK(Consistent(k, dir));
+
+        k = i % churn;
+        if (index.Get("churn" + std::to_string(k), &dir)) {
+          PEDRODB_CHECK(Consistent(k, dir));
+          hits++;
+        }
+        i += 7;
+      }
+    });
+  }
+
+  writer.join();
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  PEDRODB_CHECK(hits.load() > 0);
+  PEDRODB_CHECK(index.Size() == stable);
+  for (uint32_t i = 0; i < churn; ++i) {
+    record::Dir dir;
+    PEDRODB_CHECK(!index.Get("churn" + std::to_string(i), &dir));
+  }
+}
+
+int main() {
+  return RunTests({
+      {"SegmentIndex.ConcurrentResizeErase", TestConcurrentResizeErase},
+  });
+}
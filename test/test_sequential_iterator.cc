@@ -0,0 +1,181 @@
+#include <pedrodb/db.h>
+#include <pedrodb/iterator/sequential_iterator.h>
+#include <cstring>
+#include <map>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+
+constexpr size_t kChunkSize = SequentialIterator::kChunkSize;
+
+// a file in memory, which counts the reads.
+class StringFile final : public ReadableFile {
+ public:
+  explicit StringFile(std::string data) : data_(std::move(data)) {}
+
+  [[nodiscard]] uint64_t Size() const noexcept override {
+    return data_.size();
+  }
+
+  [[nodiscard]] Error GetError() const noexcept override { return Error::kOk; }
+
+  ssize_t Read(uint64_t offset, char* buf, size_t n) override {
+    reads_++;
+    if (offset >= data_.size()) {
+      return 0;
+    }
+    n = std::min<size_t>(n, data_.size() - offset);
+    memcpy(buf, data_.data() + offset, n);
+    return static_cast<ssize_t>(n);
+  }
+
+  Status Open(const std::string&) override { return Status::kOk; }
+
+  [[nodiscard]] size_t GetReads() const noexcept { return reads_; }
+
+ private:
+  std::string data_;
+  size_t reads_{};
+};
+
+struct Record {
+  std::string key;
+  std::string value;
+  uint32_t offset;
+};
+
+static void Append(std::string* data, std::vector<Record>* records,
+                   std::string key, std::string value) {
+  record::EntryView entry;
+  entry.type = record::Type::kSet;
+  entry.key = key;
+  entry.value = value;
+  entry.checksum = record::EntryView::Checksum(entry.key, entry.value);
+
+  ArrayBuffer buffer(entry.SizeOf());
+  entry.Pack(&buffer);
+  records->push_back({std::move(key), std::move(value),
+                      static_cast<uint32_t>(data->size())});
+  data->append(buffer.ReadIndex(), buffer.ReadableBytes());
+}
+
+// small records around the chunk boundaries, and one record larger than a
+// chunk in the middle.
+static std::string MakeFile(std::vector<Record>* records) {
+  std::string data;
+  size_t i = 0;
+  while (data.size() < 2 * kChunkSize) {
+    Append(&data, records, "key" + std::to_string(i),
+           std::string(1000 + i % 7, static_cast<char>('a' + i % 26)));
+    i++;
+  }
+  Append(&data, records, "large", std::string(3 * kChunkSize, 'L'));
+  while (data.size() < 6 * kChunkSize) {
+    Append(&data, records, "key" + std::to_string(i),
+           std::string(1000 + i % 7, static_cast<char>('a' + i % 26)));
+    i++;
+  }
+  return data;
+}
+
+static void CheckRecord(SequentialIterator* iter, const Record& r) {
+  PEDRODB_CHECK(iter->Valid());
+  PEDRODB_CHECK(iter->GetOffset() == r.offset);
+  auto entry = iter->Next();
+  PEDRODB_CHECK(entry.Validate());
+  PEDRODB_CHECK(entry.key == r.key);
+  PEDRODB_CHECK(entry.value == r.value);
+}
+
+// the records split by a chunk boundary and the one larger than a chunk are
+// parsed whole, and the file is read by chunks.
+static void TestScan() {
+  std::vector<Record> records;
+  auto data = MakeFile(&records);
+  bool split = false;
+  for (auto& r : records) {
+    size_t end = r.offset + record::Header::SizeOf() + r.key.size() +
+                 r.value.size();
+    split |= r.offset / kChunkSize != (end - 1) / kChunkSize &&
+             r.value.size() < kChunkSize;
+  }
+  PEDRODB_CHECK(split);
+
+  auto file = std::make_shared<StringFile>(data);
+  SequentialIterator iter(file);
+  for (auto& r : records) {
+    CheckRecord(&iter, r);
+  }
+  PEDRODB_CHECK(!iter.Valid());
+  PEDRODB_CHECK(file->GetReads() <= data.size() / kChunkSize + 3);
+
+  // a torn record at the end is not returned.
+  data.resize(data.size() - 10);
+  SequentialIterator torn(std::make_shared<StringFile>(data));
+  for (size_t i = 0; i + 1 < records.size(); ++i) {
+    CheckRecord(&torn, records[i]);
+  }
+  PEDRODB_CHECK(!torn.Valid());
+}
+
+// seeks forward and back, into the loaded chunk and out of it.
+static void TestSeek() {
+  std::vector<Record> records;
+  auto data = MakeFile(&records);
+  SequentialIterator iter(std::make_shared<StringFile>(data));
+
+  size_t large = 0;
+  while (records[large].key != "large") {
+    large++;
+  }
+
+  for (size_t i : {size_t{1}, size_t{0}, large + 1, large, size_t{5},
+                   records.size() - 1, large - 1}) {
+    iter.Seek(records[i].offset);
+    CheckRecord(&iter, records[i]);
+    if (i + 1 < records.size()) {
+      CheckRecord(&iter, records[i + 1]);
+    }
+  }
+
+  iter.Seek(data.size());
+  PEDRODB_CHECK(!iter.Valid());
+}
+
+// the database iterator returns the values larger than a chunk as well.
+static void TestGetIterator() {
+  auto path = TempDir("sequential_iterator") + "/t.db";
+  Options options;
+  options.checkpoint.enable = false;
+
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(DB::Open(options, path, &db));
+  std::map<std::string, std::string> model;
+  for (size_t i = 0; i < 3000; ++i) {
+    auto key = "key" + std::to_string(i);
+    size_t size = i % 1000 == 7 ? 2 * kChunkSize + i : 1000 + i % 13;
+    model[key] = std::string(size, static_cast<char>('a' + i % 26));
+    PEDRODB_CHECK_OK(db->Put({}, key, model[key]));
+  }
+
+  EntryIterator::Ptr iterator;
+  PEDRODB_CHECK_OK(db->GetIterator(&iterator));
+  size_t count = 0;
+  while (iterator->Valid()) {
+    auto entry = iterator->Next();
+    auto it = model.find(std::string(entry.key));
+    PEDRODB_CHECK(it != model.end());
+    PEDRODB_CHECK(entry.value == it->second);
+    count++;
+  }
+  PEDRODB_CHECK(count == model.size());
+}
+
+int main() {
+  return RunTests({
+      {"SequentialIterator.Scan", TestScan},
+      {"SequentialIterator.Seek", TestSeek},
+      {"SequentialIterator.GetIterator", TestGetIterator},
+  });
+}
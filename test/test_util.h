@@ -0,0 +1,96 @@
+#ifndef PEDRODB_TEST_TEST_UTIL_H
+#define PEDRODB_TEST_TEST_UTIL_H
+
+#include <pedrodb/db.h>
+#include <pedrodb/logger/logger.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define PEDRODB_CHECK(cond)                                             \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__,      \
+                   __LINE__, #cond);                                    \
+      std::abort();                                                     \
+    }                                                                   \
+  } while (0)
+
+#define PEDRODB_CHECK_OK(expr) PEDRODB_CHECK((expr) == pedrodb::Status::kOk)
+
+namespace pedrodb::test {
+
+using TestCase = std::pair<const char*, std::function<void()>>;
+
+// runs the cases in order, a failed check aborts the process.
+inline int RunTests(std::initializer_list<TestCase> cases) {
+  pedrodb::logger::SetLevel(pedrodb::logger::Level::kError);
+  for (auto& [name, test] : cases) {
+    std::fprintf(stderr, "[ RUN  ] %s\n", name);
+    test();
+    std::fprintf(stderr, "[  OK  ] %s\n", name);
+  }
+  return 0;
+}
+
+// an empty directory for the databases of a test.
+inline std::string TempDir(const std::string& name) {
+  auto dir = std::filesystem::temp_directory_path() / "pedrodb_test" / name;
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+  return dir.string();
+}
+
+// the files in `dir` whose name ends with `suffix`, sorted by name.
+inline std::vector<std::string> ListFiles(const std::string& dir,
+                                          const std::string& suffix) {
+  std::vector<std::string> files;
+  for (auto& entry : std::filesystem::directory_iterator(dir)) {
+    auto path = entry.path().string();
+    if (path.size() >= suffix.size() &&
+        path.compare(path.size() - suffix.size(), suffix.size(), suffix) ==
+            0) {
+      files.emplace_back(path);
+    }
+  }
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+inline std::string ReadFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+inline void WriteFile(const std::string& path, const std::string& content) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(content.data(), static_cast<std::streamsize>(content.size()));
+}
+
+// flips a byte of the file at `offset`.
+inline void CorruptFile(const std::string& path, size_t offset) {
+  auto content = ReadFile(path);
+  PEDRODB_CHECK(offset < content.size());
+  content[offset] ^= 0x5a;
+  WriteFile(path, content);
+}
+
+// the value of a key, or an empty string if it is not found.
+inline std::string Get(DB* db, std::string_view key,
+                       const ReadOptions& options = {}) {
+  std::string value;
+  Status status = db->Get(options, key, &value);
+  PEDRODB_CHECK(status == Status::kOk || status == Status::kNotFound);
+  return status == Status::kOk ? value : "";
+}
+}  // namespace pedrodb::test
+
+#endif  // PEDRODB_TEST_TEST_UTIL_H
@@ -0,0 +1,104 @@
+#include <pedrodb/db.h>
+#include "test_util.h"
+
+using namespace pedrodb;
+using namespace pedrodb::test;
+
+static Options TestOptions() {
+  Options options;
+  options.checkpoint.enable = false;
+  return options;
+}
+
+static void TestApplyInOrder() {
+  auto path = TempDir("write_batch_order") + "/t.db";
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(), path, &db));
+  PEDRODB_CHECK_OK(db->Put({}, "gone", "v0"));
+
+  WriteBatch batch;
+  batch.Put("a", "1");
+  batch.Put("b", "1");
+  batch.Put("a", "2");
+  batch.Delete("b");
+  batch.Delete("gone");
+  batch.Put("c", "3");
+  PEDRODB_CHECK_OK(db->Write({}, &batch));
+
+  PEDRODB_CHECK(Get(db.get(), "a") == "2");
+  PEDRODB_CHECK(Get(db.get(), "b").empty());
+  PEDRODB_CHECK(Get(db.get(), "gone").empty());
+  PEDRODB_CHECK(Get(db.get(), "c") == "3");
+
+  db = nullptr;
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(), path, &db));
+  PEDRODB_CHECK(Get(db.get(), "a") == "2");
+  PEDRODB_CHECK(Get(db.get(), "b").empty());
+  PEDRODB_CHECK(Get(db.get(), "gone").empty());
+  PEDRODB_CHECK(Get(db.get(), "c") == "3");
+}
+
+// a batch whose record is torn is dropped as a whole by recovery, and the
+// records appended after the torn tail survive the next reopen.
+static void TestTornBatch() {
+  auto dir = TempDir("write_batch_torn");
+  auto path = dir + "/t.db";
+  const int n = 10;
+
+  DB::Ptr db;
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(), path, &db));
+  for (int i = 0; i < n; ++i) {
+    PEDRODB_CHECK_OK(
+        db->Put({}, "key" + std::to_string(i), "value" + std::to_string(i)));
+  }
+
+  WriteBatch batch;
+  for (int i = 0; i < n; ++i) {
+    batch.Put("batch" + std::to_string(i), "batch-value" + std::to_string(i));
+  }
+  batch.Delete("key0");
+  PEDRODB_CHECK_OK(db->Write({}, &batch));
+  db = nullptr;
+
+  // tear the batch by flipping a byte of a key inside it.
+  auto files = ListFiles(dir, ".data");
+  PEDRODB_CHECK(files.size() == 1);
+  auto content = ReadFile(files[0]);
+  size_t pos = content.rfind("batch5");
+  PEDRODB_CHECK(pos != std::string::npos);
+  CorruptFile(files[0], pos);
+
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(), path, &db));
+  for (int i = 0; i < n; ++i) {
+    PEDRODB_CHECK(Get(db.get(), "key" + std::to_string(i)) ==
+                  "value" + std::to_string(i));
+    PEDRODB_CHECK(Get(db.get(), "batch" + std::to_string(i)).empty());
+  }
+
+  PEDRODB_CHECK_OK(db->Put({}, "after", "torn"));
+  db = nullptr;
+
+  PEDRODB_CHECK_OK(DB::Open(TestOptions(), path, &db));
+  PEDRODB_CHECK(Get(db.get(), "after") == "torn");
+  PEDRODB_CHECK(Get(db.get(), "key0") == "value0");
+  for (int i = 0; i < n; ++i) {
+    PEDRODB_CHECK(Get(db.get(), "batch" + std::to_string(i)).empty());
+  }
+
+  size_t count = 0;
+  EntryIterator::Ptr iterator;
+  PEDRODB_CHECK_OK(db->GetIterator(&iterator));
+  while (iterator->Valid()) {
+    auto entry = iterator->Next();
+    PEDRODB_CHECK(entry.key.substr(0, 5) != "batch");
+    count++;
+  }
+  PEDRODB_CHECK(count == n + 1);
+}
+
+int main() {
+  return RunTests({
+      {"WriteBatch.ApplyInOrder", TestApplyInOrder},
+      {"WriteBatch.TornBatch", TestTornBatch},
+  });
+}